@@ -23,7 +23,12 @@ const char kExecutionsBuilderServiceName[] = "executions-builder";
 const char kStacksBuilderServiceName[] = "stacks-builder";
 const char kCriticalGraphServiceName[] = "critical-graph";
 const char kStateHistoryServiceName[] = "state-history";
+const char kPerfCountersHistoryServiceName[] = "perf-counters-history";
+const char kThreadInterestServiceName[] = "thread-interest";
 const char kDiskRequestsServiceName[] = "disk-requests";
+const char kExecutionWindowsServiceName[] = "execution-windows";
+const char kStacksPipelineServiceName[] = "stacks-pipeline";
+const char kStateChangesServiceName[] = "state-changes";
 
 const char kInstructions[] = "instructions";
 const char kCacheReferences[] = "cache-references";
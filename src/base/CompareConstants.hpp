@@ -30,7 +30,12 @@ extern const char kExecutionsBuilderServiceName[];
 extern const char kStacksBuilderServiceName[];
 extern const char kCriticalGraphServiceName[];
 extern const char kStateHistoryServiceName[];
+extern const char kPerfCountersHistoryServiceName[];
+extern const char kThreadInterestServiceName[];
 extern const char kDiskRequestsServiceName[];
+extern const char kExecutionWindowsServiceName[];
+extern const char kStacksPipelineServiceName[];
+extern const char kStateChangesServiceName[];
 
 // Metrics.
 typedef uint32_t MetricId;
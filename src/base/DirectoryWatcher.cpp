@@ -0,0 +1,103 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "base/DirectoryWatcher.hpp"
+
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "base/ex/FatalError.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+namespace
+{
+
+// Size of the buffer that receives inotify events. Fits many events with
+// a name of the maximum length.
+const size_t kEventsBufferSize = 64 * (sizeof(struct inotify_event) + NAME_MAX + 1);
+
+}  // namespace
+
+DirectoryWatcher::DirectoryWatcher(const boost::filesystem::path& directory)
+    : _directory(directory),
+      _fd(-1)
+{
+    _fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (_fd < 0)
+        throw ex::FatalError(std::string("Unable to initialize inotify: ") + strerror(errno));
+
+    // Chunks of a rotated session are moved into the archive directory once
+    // they are complete. A directory created in place would be reported
+    // before its files are written.
+    if (inotify_add_watch(_fd, directory.c_str(),
+                          IN_MOVED_TO | IN_ONLYDIR) < 0)
+    {
+        std::string error = strerror(errno);
+        close(_fd);
+        throw ex::FatalError("Unable to watch " + directory.string() + ": " + error);
+    }
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+    close(_fd);
+}
+
+bool DirectoryWatcher::WaitForDirectories(
+    int timeoutMs, std::vector<boost::filesystem::path>* added)
+{
+    struct pollfd pfd;
+    pfd.fd = _fd;
+    pfd.events = POLLIN;
+
+    int ready = poll(&pfd, 1, timeoutMs);
+    if (ready < 0 && errno != EINTR)
+        throw ex::FatalError(std::string("Unable to poll inotify: ") + strerror(errno));
+    if (ready <= 0)
+        return false;
+
+    size_t numAdded = added->size();
+    std::vector<char> buffer(kEventsBufferSize);
+    for (;;)
+    {
+        ssize_t length = read(_fd, buffer.data(), buffer.size());
+        if (length <= 0)
+            break;
+
+        for (ssize_t pos = 0; pos < length;)
+        {
+            const auto* event =
+                reinterpret_cast<const struct inotify_event*>(&buffer[pos]);
+            if ((event->mask & IN_ISDIR) != 0 && event->len != 0)
+                added->push_back(_directory / event->name);
+            pos += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return added->size() != numAdded;
+}
+
+}  // namespace base
+}  // namespace tibee
@@ -0,0 +1,66 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_DIRECTORYWATCHER_HPP
+#define _TIBEE_BASE_DIRECTORYWATCHER_HPP
+
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <vector>
+
+namespace tibee
+{
+namespace base
+{
+
+// Watches a directory for subdirectories that are moved into it, using
+// inotify. Subdirectories created in place are not reported, since they
+// are usually still being filled.
+class DirectoryWatcher : boost::noncopyable
+{
+public:
+    // Constructor. Throws ex::FatalError if the directory can't be watched.
+    // @param directory Directory to watch.
+    explicit DirectoryWatcher(const boost::filesystem::path& directory);
+
+    // Destructor.
+    ~DirectoryWatcher();
+
+    // Waits until subdirectories are moved into the watched directory.
+    // @param timeoutMs Maximum time to wait, in milliseconds, or -1 to wait
+    //     indefinitely.
+    // @param added Receives the paths of the added subdirectories, in the
+    //     order in which they were added.
+    // @returns false if the timeout expired before a subdirectory was added.
+    bool WaitForDirectories(int timeoutMs,
+                            std::vector<boost::filesystem::path>* added);
+
+    // The watched directory.
+    const boost::filesystem::path& directory() const { return _directory; }
+
+private:
+    // The watched directory.
+    boost::filesystem::path _directory;
+
+    // Inotify file descriptor.
+    int _fd;
+};
+
+}  // namespace base
+}  // namespace tibee
+
+#endif // _TIBEE_BASE_DIRECTORYWATCHER_HPP
@@ -0,0 +1,75 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include "base/DirectoryWatcher.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+namespace bfs = boost::filesystem;
+
+TEST(DirectoryWatcher, WaitForDirectories)
+{
+    bfs::path root = bfs::temp_directory_path() / bfs::unique_path();
+    bfs::create_directories(root / "archives");
+    bfs::create_directories(root / "staging" / "chunk-1");
+    bfs::create_directories(root / "staging" / "chunk-2");
+
+    {
+        DirectoryWatcher watcher(root / "archives");
+        std::vector<bfs::path> added;
+
+        // Nothing was added yet.
+        EXPECT_FALSE(watcher.WaitForDirectories(0, &added));
+        EXPECT_TRUE(added.empty());
+
+        // Files are ignored.
+        bfs::ofstream(root / "archives" / "file");
+        EXPECT_FALSE(watcher.WaitForDirectories(0, &added));
+
+        // Directories created in place are ignored.
+        bfs::create_directory(root / "archives" / "chunk-0");
+        EXPECT_FALSE(watcher.WaitForDirectories(0, &added));
+
+        // Moved directories are reported in order.
+        bfs::rename(root / "staging" / "chunk-1", root / "archives" / "chunk-1");
+        bfs::rename(root / "staging" / "chunk-2", root / "archives" / "chunk-2");
+        EXPECT_TRUE(watcher.WaitForDirectories(1000, &added));
+
+        std::vector<bfs::path> expected {
+            root / "archives" / "chunk-1", root / "archives" / "chunk-2"};
+        EXPECT_EQ(expected, added);
+    }
+
+    bfs::remove_all(root);
+}
+
+TEST(DirectoryWatcher, MissingDirectory)
+{
+    bfs::path missing = bfs::temp_directory_path() / bfs::unique_path();
+    EXPECT_ANY_THROW(DirectoryWatcher watcher(missing));
+}
+
+}  // namespace base
+}  // namespace tibee
@@ -0,0 +1,320 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "base/Instrumentation.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+#include "base/JsonWriter.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+namespace
+{
+
+double NsToUs(uint64_t ns)
+{
+    return static_cast<double>(ns) / 1000.0;
+}
+
+double NsToMs(uint64_t ns)
+{
+    return static_cast<double>(ns) / 1000000.0;
+}
+
+template <typename Probe>
+Probe* GetProbe(const std::string& name,
+                std::deque<std::unique_ptr<Probe>>* probes)
+{
+    for (const auto& probe : *probes)
+    {
+        if (probe->name() == name)
+            return probe.get();
+    }
+    probes->emplace_back(new Probe(name));
+    return probes->back().get();
+}
+
+}  // namespace
+
+std::atomic<bool> Instrumentation::_enabled(false);
+std::atomic<uint32_t> Instrumentation::_nextThread(1);
+
+Instrumentation::Counter::Counter(const std::string& name)
+    : _name(name)
+{
+    for (auto& shard : _shards)
+        shard.value.store(0, std::memory_order_relaxed);
+}
+
+uint64_t Instrumentation::Counter::value() const
+{
+    uint64_t value = 0;
+    for (const auto& shard : _shards)
+        value += shard.value.load(std::memory_order_relaxed);
+    return value;
+}
+
+Instrumentation::Timer::Timer(const std::string& name)
+    : _name(name)
+{
+    for (auto& shard : _shards)
+    {
+        shard.totalNs.store(0, std::memory_order_relaxed);
+        shard.count.store(0, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Instrumentation::Timer::totalNs() const
+{
+    uint64_t totalNs = 0;
+    for (const auto& shard : _shards)
+        totalNs += shard.totalNs.load(std::memory_order_relaxed);
+    return totalNs;
+}
+
+uint64_t Instrumentation::Timer::count() const
+{
+    uint64_t count = 0;
+    for (const auto& shard : _shards)
+        count += shard.count.load(std::memory_order_relaxed);
+    return count;
+}
+
+Instrumentation::Gauge::Gauge(const std::string& name)
+    : _value(0), _name(name)
+{
+}
+
+Instrumentation::Instrumentation()
+    : _recordSpans(false),
+      _start(std::chrono::steady_clock::now()),
+      _droppedSpans(0),
+      _summaryTs(0)
+{
+}
+
+Instrumentation* Instrumentation::Get()
+{
+    static Instrumentation* instrumentation = new Instrumentation;
+    return instrumentation;
+}
+
+void Instrumentation::Enable(bool recordSpans)
+{
+    _recordSpans.store(recordSpans, std::memory_order_relaxed);
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+void Instrumentation::Disable()
+{
+    _enabled.store(false, std::memory_order_relaxed);
+    _recordSpans.store(false, std::memory_order_relaxed);
+}
+
+Instrumentation::Counter* Instrumentation::GetCounter(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return GetProbe(name, &_counters);
+}
+
+Instrumentation::Timer* Instrumentation::GetTimer(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return GetProbe(name, &_timers);
+}
+
+Instrumentation::Gauge* Instrumentation::GetGauge(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return GetProbe(name, &_gauges);
+}
+
+void Instrumentation::RecordSpan(const Timer* timer, uint64_t beginNs,
+                                 uint64_t endNs)
+{
+    if (!_recordSpans.load(std::memory_order_relaxed))
+        return;
+
+    Span span;
+    span.timer = timer;
+    span.thread = CurrentThread();
+    span.beginNs = beginNs;
+    span.endNs = endNs;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_spans.size() >= kMaxSpans)
+    {
+        ++_droppedSpans;
+        return;
+    }
+    _spans.push_back(span);
+}
+
+void Instrumentation::PrintSummary(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint64_t now = Now();
+    uint64_t elapsedNs = std::max<uint64_t>(now - _summaryTs, 1);
+    _summaryCounters.resize(_counters.size(), 0);
+    _summaryTimers.resize(_timers.size(), 0);
+    _summaryTimerCounts.resize(_timers.size(), 0);
+
+    out << std::fixed << std::setprecision(1)
+        << "Instrumentation summary at " << NsToMs(now) / 1000.0
+        << " s, over the last " << NsToMs(elapsedNs) / 1000.0 << " s:"
+        << std::endl;
+
+    Sample sample;
+    sample.ts = now;
+    for (size_t i = 0; i < _counters.size(); ++i)
+    {
+        uint64_t value = _counters[i]->value();
+        uint64_t delta = value - _summaryCounters[i];
+        sample.counters.push_back(value);
+        _summaryCounters[i] = value;
+        if (delta == 0)
+            continue;
+
+        out << "  " << _counters[i]->name() << ": " << value << " (+" << delta
+            << ", " << delta * 1000000000.0 / elapsedNs << "/s)" << std::endl;
+    }
+    _samples.push_back(sample);
+
+    // Show where the time went, from the most expensive scope.
+    std::vector<std::pair<uint64_t, size_t>> timers;
+    std::vector<uint64_t> deltaCounts(_timers.size(), 0);
+    for (size_t i = 0; i < _timers.size(); ++i)
+    {
+        uint64_t totalNs = _timers[i]->totalNs();
+        uint64_t count = _timers[i]->count();
+        uint64_t delta = totalNs - _summaryTimers[i];
+        deltaCounts[i] = count - _summaryTimerCounts[i];
+        _summaryTimers[i] = totalNs;
+        _summaryTimerCounts[i] = count;
+        if (delta != 0)
+            timers.push_back(std::make_pair(delta, i));
+    }
+    std::sort(timers.rbegin(), timers.rend());
+    for (const auto& timer : timers)
+    {
+        const auto& probe = *_timers[timer.second];
+        uint64_t deltaCount = deltaCounts[timer.second];
+        out << "  " << probe.name() << ": " << NsToMs(timer.first) << " ms ("
+            << 100.0 * timer.first / elapsedNs << "% of a thread) in "
+            << deltaCount << " calls (" << deltaCount * 1000000000.0 / elapsedNs
+            << "/s), " << NsToMs(probe.totalNs()) << " ms in " << probe.count()
+            << " calls since the start" << std::endl;
+    }
+
+    for (const auto& gauge : _gauges)
+        out << "  " << gauge->name() << ": " << gauge->value() << std::endl;
+
+    _summaryTs = now;
+}
+
+bool Instrumentation::WriteProfile(const boost::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    JsonWriter writer;
+    if (!writer.Open(path))
+        return false;
+
+    writer.BeginDict();
+    writer.KeyArrayValue("traceEvents");
+
+    for (const auto& span : _spans)
+    {
+        writer.BeginDict();
+        writer.KeyValue("name", span.timer->name());
+        writer.KeyValue("cat", std::string("tibeebuild"));
+        writer.KeyValue("ph", std::string("X"));
+        writer.KeyValue("ts", NsToUs(span.beginNs));
+        writer.KeyValue("dur", NsToUs(span.endNs - span.beginNs));
+        writer.KeyValue("pid", 1);
+        writer.KeyValue("tid", span.thread);
+        writer.EndDict();
+    }
+
+    // Counters sampled by the summaries, followed by their final values.
+    std::vector<Sample> samples(_samples);
+    Sample last;
+    last.ts = Now();
+    for (const auto& counter : _counters)
+        last.counters.push_back(counter->value());
+    samples.push_back(last);
+
+    for (const auto& sample : samples)
+    {
+        for (size_t i = 0; i < sample.counters.size(); ++i)
+        {
+            writer.BeginDict();
+            writer.KeyValue("name", _counters[i]->name());
+            writer.KeyValue("ph", std::string("C"));
+            writer.KeyValue("ts", NsToUs(sample.ts));
+            writer.KeyValue("pid", 1);
+            writer.KeyDictValue("args");
+            writer.KeyValue("value", sample.counters[i]);
+            writer.EndDict();
+            writer.EndDict();
+        }
+    }
+
+    writer.EndArray();
+    writer.KeyValue("displayTimeUnit", std::string("ms"));
+
+    // Totals, for scripts that compare runs.
+    writer.KeyDictValue("timers");
+    for (const auto& timer : _timers)
+    {
+        writer.KeyDictValue(timer->name());
+        writer.KeyValue("totalMs", NsToMs(timer->totalNs()));
+        writer.KeyValue("count", timer->count());
+        writer.EndDict();
+    }
+    writer.EndDict();
+
+    writer.KeyDictValue("counters");
+    for (const auto& counter : _counters)
+        writer.KeyValue(counter->name(), counter->value());
+    writer.EndDict();
+
+    writer.KeyDictValue("gauges");
+    for (const auto& gauge : _gauges)
+        writer.KeyValue(gauge->name(), gauge->value());
+    writer.EndDict();
+
+    writer.KeyValue("droppedSpans", _droppedSpans);
+    writer.EndDict();
+
+    return true;
+}
+
+uint64_t Instrumentation::Now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - _start).count();
+}
+
+}  // namespace base
+}  // namespace tibee
@@ -0,0 +1,289 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_INSTRUMENTATION_HPP
+#define _TIBEE_BASE_INSTRUMENTATION_HPP
+
+#include <atomic>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace tibee
+{
+namespace base
+{
+
+// Counters, timers and gauges that measure where tibeebuild spends its
+// time, shared by all the threads of the process. Nothing is measured
+// until Enable() is called: a disabled probe costs a relaxed load.
+class Instrumentation : boost::noncopyable
+{
+public:
+    // Number of shards of the counters and timers. The pipelines that run
+    // concurrently update different shards, so that the probes of the
+    // event observers don't bounce a cache line between the cores.
+    static const size_t kNumShards = 16;
+
+    // Cache line size.
+    static const size_t kCacheLineSize = 64;
+
+    // Accumulates a quantity, such as a number of events or cache hits.
+    class Counter : boost::noncopyable
+    {
+    public:
+        explicit Counter(const std::string& name);
+
+        void Add(uint64_t value)
+        {
+            _shards[CurrentShard()].value.fetch_add(
+                value, std::memory_order_relaxed);
+        }
+        uint64_t value() const;
+        const std::string& name() const { return _name; }
+
+    private:
+        struct Shard
+        {
+            std::atomic<uint64_t> value;
+            char padding[kCacheLineSize - sizeof(std::atomic<uint64_t>)];
+        };
+
+        Shard _shards[kNumShards];
+        std::string _name;
+    };
+
+    // Accumulates the time spent in a scope and the number of times that
+    // the scope was entered.
+    class Timer : boost::noncopyable
+    {
+    public:
+        explicit Timer(const std::string& name);
+
+        void Add(uint64_t durationNs)
+        {
+            auto& shard = _shards[CurrentShard()];
+            shard.totalNs.fetch_add(durationNs, std::memory_order_relaxed);
+            shard.count.fetch_add(1, std::memory_order_relaxed);
+        }
+        uint64_t totalNs() const;
+        uint64_t count() const;
+        const std::string& name() const { return _name; }
+
+    private:
+        struct Shard
+        {
+            std::atomic<uint64_t> totalNs;
+            std::atomic<uint64_t> count;
+            char padding[kCacheLineSize - 2 * sizeof(std::atomic<uint64_t>)];
+        };
+
+        Shard _shards[kNumShards];
+        std::string _name;
+    };
+
+    // Last value of a quantity, such as the memory used by a structure.
+    class Gauge : boost::noncopyable
+    {
+    public:
+        explicit Gauge(const std::string& name);
+
+        void Set(int64_t value) { _value.store(value, std::memory_order_relaxed); }
+        int64_t value() const { return _value.load(std::memory_order_relaxed); }
+        const std::string& name() const { return _name; }
+
+    private:
+        std::atomic<int64_t> _value;
+        std::string _name;
+    };
+
+    // Instrumentation of the process.
+    static Instrumentation* Get();
+
+    // Indicates whether the probes measure something.
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    // Starts measuring.
+    // @param recordSpans Keep the intervals of the traced scopes, to write
+    //     them with WriteProfile().
+    void Enable(bool recordSpans);
+
+    // Stops measuring. The accumulated values are kept.
+    void Disable();
+
+    // Returns the probe with the given name, creating it on first use. The
+    // probes live as long as the process: callers should keep the pointer.
+    Counter* GetCounter(const std::string& name);
+    Timer* GetTimer(const std::string& name);
+    Gauge* GetGauge(const std::string& name);
+
+    // Records an interval during which the current thread was in a traced
+    // scope. Ignored unless spans are recorded.
+    void RecordSpan(const Timer* timer, uint64_t beginNs, uint64_t endNs);
+
+    // Writes the values accumulated since the previous summary, with the
+    // rate of the counters, and keeps a sample of the counters for the
+    // profile.
+    void PrintSummary(std::ostream& out);
+
+    // Writes the recorded spans, the samples of the counters and the final
+    // values of all the probes in the Chrome trace event format, which
+    // chrome://tracing and Perfetto can open.
+    bool WriteProfile(const boost::filesystem::path& path);
+
+    // Nanoseconds elapsed since the instrumentation was created.
+    uint64_t Now() const;
+
+    // Maximum number of spans kept, to bound the memory of long runs.
+    static const size_t kMaxSpans = 1 << 20;
+
+private:
+    Instrumentation();
+
+    // Small identifier of the current thread, for the profile.
+    static uint32_t CurrentThread()
+    {
+        static thread_local uint32_t thread = _nextThread++;
+        return thread;
+    }
+
+    static size_t CurrentShard() { return CurrentThread() % kNumShards; }
+
+    struct Span
+    {
+        const Timer* timer;
+        uint32_t thread;
+        uint64_t beginNs;
+        uint64_t endNs;
+    };
+
+    struct Sample
+    {
+        uint64_t ts;
+        std::vector<uint64_t> counters;
+    };
+
+    static std::atomic<bool> _enabled;
+    static std::atomic<uint32_t> _nextThread;
+
+    // Indicates that spans are recorded.
+    std::atomic<bool> _recordSpans;
+
+    // Time at which the instrumentation was created.
+    std::chrono::steady_clock::time_point _start;
+
+    // Probes, in creation order. Deques don't move their elements.
+    std::deque<std::unique_ptr<Counter>> _counters;
+    std::deque<std::unique_ptr<Timer>> _timers;
+    std::deque<std::unique_ptr<Gauge>> _gauges;
+
+    // Recorded spans and number of spans dropped past kMaxSpans.
+    std::vector<Span> _spans;
+    uint64_t _droppedSpans;
+
+    // Samples of the counters taken by PrintSummary().
+    std::vector<Sample> _samples;
+
+    // Values of the counters and timers at the previous summary.
+    uint64_t _summaryTs;
+    std::vector<uint64_t> _summaryCounters;
+    std::vector<uint64_t> _summaryTimers;
+    std::vector<uint64_t> _summaryTimerCounts;
+
+    // Protects all the members above, except the values of the probes.
+    std::mutex _mutex;
+};
+
+// Adds the time spent in its scope to a timer. A traced scope also records
+// its interval in the profile: use it for coarse phases, not per event.
+class ScopedTimer : boost::noncopyable
+{
+public:
+    ScopedTimer(Instrumentation::Timer* timer, bool traced)
+        : _timer(Instrumentation::enabled() ? timer : nullptr),
+          _traced(traced),
+          _beginNs(_timer != nullptr ? Instrumentation::Get()->Now() : 0)
+    {
+    }
+
+    ~ScopedTimer()
+    {
+        if (_timer == nullptr)
+            return;
+        auto* instrumentation = Instrumentation::Get();
+        uint64_t endNs = instrumentation->Now();
+        _timer->Add(endNs - _beginNs);
+        if (_traced)
+            instrumentation->RecordSpan(_timer, _beginNs, endNs);
+    }
+
+private:
+    Instrumentation::Timer* _timer;
+    bool _traced;
+    uint64_t _beginNs;
+};
+
+}  // namespace base
+}  // namespace tibee
+
+#define TIBEE_INSTRUMENTATION_CONCAT_INTERNAL(a, b) a##b
+#define TIBEE_INSTRUMENTATION_CONCAT(a, b) TIBEE_INSTRUMENTATION_CONCAT_INTERNAL(a, b)
+
+// Adds |value| to the counter |name|. The counter is looked up once.
+#define TIBEE_COUNTER_ADD(name, value)                                      \
+    do {                                                                    \
+        if (::tibee::base::Instrumentation::enabled()) {                    \
+            static auto* const counter =                                    \
+                ::tibee::base::Instrumentation::Get()->GetCounter(name);    \
+            counter->Add(value);                                            \
+        }                                                                   \
+    } while (0)
+
+// Sets the gauge |name| to |value|.
+#define TIBEE_GAUGE_SET(name, value)                                        \
+    do {                                                                    \
+        if (::tibee::base::Instrumentation::enabled()) {                    \
+            static auto* const gauge =                                      \
+                ::tibee::base::Instrumentation::Get()->GetGauge(name);      \
+            gauge->Set(value);                                              \
+        }                                                                   \
+    } while (0)
+
+// Adds the time spent in the rest of the enclosing scope to the timer |name|.
+#define TIBEE_SCOPED_TIMER(name)                                            \
+    static auto* const TIBEE_INSTRUMENTATION_CONCAT(_timer, __LINE__) =     \
+        ::tibee::base::Instrumentation::Get()->GetTimer(name);              \
+    ::tibee::base::ScopedTimer TIBEE_INSTRUMENTATION_CONCAT(                \
+        _scopedTimer, __LINE__)(                                            \
+        TIBEE_INSTRUMENTATION_CONCAT(_timer, __LINE__), false)
+
+// Same as TIBEE_SCOPED_TIMER, and records the interval in the profile.
+#define TIBEE_TRACED_SCOPE(name)                                            \
+    static auto* const TIBEE_INSTRUMENTATION_CONCAT(_timer, __LINE__) =     \
+        ::tibee::base::Instrumentation::Get()->GetTimer(name);              \
+    ::tibee::base::ScopedTimer TIBEE_INSTRUMENTATION_CONCAT(                \
+        _scopedTimer, __LINE__)(                                            \
+        TIBEE_INSTRUMENTATION_CONCAT(_timer, __LINE__), true)
+
+#endif // _TIBEE_BASE_INSTRUMENTATION_HPP
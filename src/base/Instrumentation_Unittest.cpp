@@ -0,0 +1,126 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <iterator>
+#include <sstream>
+
+#include "base/Instrumentation.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+namespace
+{
+
+namespace bfs = boost::filesystem;
+
+void AddToCounter(uint64_t value)
+{
+    TIBEE_COUNTER_ADD("test.counter", value);
+}
+
+void TimedScope()
+{
+    TIBEE_SCOPED_TIMER("test.timer");
+}
+
+void TracedScope()
+{
+    TIBEE_TRACED_SCOPE("test.phase");
+}
+
+}  // namespace
+
+TEST(Instrumentation, Disabled)
+{
+    auto* instrumentation = Instrumentation::Get();
+    instrumentation->Disable();
+
+    AddToCounter(5);
+    TimedScope();
+
+    EXPECT_EQ(0u, instrumentation->GetCounter("test.counter")->value());
+    EXPECT_EQ(0u, instrumentation->GetTimer("test.timer")->count());
+}
+
+TEST(Instrumentation, CountersAndTimers)
+{
+    auto* instrumentation = Instrumentation::Get();
+    instrumentation->Enable(false);
+
+    auto* counter = instrumentation->GetCounter("test.counter");
+    uint64_t initial = counter->value();
+    AddToCounter(3);
+    AddToCounter(4);
+    EXPECT_EQ(initial + 7, counter->value());
+    EXPECT_EQ(counter, instrumentation->GetCounter("test.counter"));
+
+    auto* timer = instrumentation->GetTimer("test.timer");
+    uint64_t initialCount = timer->count();
+    TimedScope();
+    TimedScope();
+    EXPECT_EQ(initialCount + 2, timer->count());
+
+    TIBEE_GAUGE_SET("test.gauge", -12);
+    EXPECT_EQ(-12, instrumentation->GetGauge("test.gauge")->value());
+
+    std::stringstream summary;
+    instrumentation->PrintSummary(summary);
+    EXPECT_NE(std::string::npos, summary.str().find("test.counter"));
+    EXPECT_NE(std::string::npos, summary.str().find("test.timer"));
+    EXPECT_NE(std::string::npos, summary.str().find("test.gauge: -12"));
+
+    // Only the counters that changed since the previous summary are shown.
+    std::stringstream nextSummary;
+    instrumentation->PrintSummary(nextSummary);
+    EXPECT_EQ(std::string::npos, nextSummary.str().find("test.counter"));
+
+    instrumentation->Disable();
+}
+
+TEST(Instrumentation, WriteProfile)
+{
+    auto* instrumentation = Instrumentation::Get();
+    instrumentation->Enable(true);
+    AddToCounter(1);
+    TracedScope();
+    instrumentation->Disable();
+
+    bfs::path path = bfs::temp_directory_path() / bfs::unique_path();
+    ASSERT_TRUE(instrumentation->WriteProfile(path));
+
+    bfs::ifstream in(path);
+    std::string profile((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+    bfs::remove(path);
+
+    EXPECT_EQ(0u, profile.find("{\"traceEvents\":["));
+    EXPECT_NE(std::string::npos, profile.find(
+        "\"name\":\"test.phase\",\"cat\":\"tibeebuild\",\"ph\":\"X\""));
+    EXPECT_NE(std::string::npos, profile.find(
+        "\"name\":\"test.counter\",\"ph\":\"C\""));
+    EXPECT_NE(std::string::npos, profile.find("\"droppedSpans\":0}"));
+}
+
+}  // namespace base
+}  // namespace tibee
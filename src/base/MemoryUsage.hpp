@@ -0,0 +1,49 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_BASE_MEMORYUSAGE_HPP_
+#define TIBEE_BASE_MEMORYUSAGE_HPP_
+
+#include <stddef.h>
+
+namespace tibee
+{
+namespace base
+{
+
+// Approximate number of bytes allocated by a vector or a string, excluding
+// the memory allocated by its elements.
+template <typename T>
+size_t VectorMemoryUsage(const T& vector)
+{
+    return vector.capacity() * sizeof(typename T::value_type);
+}
+
+// Approximate number of bytes allocated by an unordered map or set,
+// excluding the memory allocated by its elements. Each element is in a
+// node that also holds a next pointer and a cached hash.
+template <typename T>
+size_t HashMapMemoryUsage(const T& map)
+{
+    return map.size() * (sizeof(typename T::value_type) + 2 * sizeof(void*)) +
+           map.bucket_count() * sizeof(void*);
+}
+
+}  // namespace base
+}  // namespace tibee
+
+#endif  // TIBEE_BASE_MEMORYUSAGE_HPP_
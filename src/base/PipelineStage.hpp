@@ -0,0 +1,194 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_PIPELINESTAGE_HPP
+#define _TIBEE_BASE_PIPELINESTAGE_HPP
+
+#include <atomic>
+#include <boost/utility.hpp>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <thread>
+
+#include "base/SpscRing.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+// Stage of a pipeline that handles elements on its own thread, in the order
+// in which they are pushed. Elements are handed off through a lock-free
+// ring: the pushing thread waits when the ring is full.
+template <typename T>
+class PipelineStage : boost::noncopyable
+{
+public:
+    typedef std::function<void (const T&)> Handler;
+
+    // Constructor.
+    // @param capacity Number of elements that can wait to be handled.
+    explicit PipelineStage(size_t capacity);
+
+    // Destructor. Handles the pushed elements, then stops the thread.
+    ~PipelineStage();
+
+    // Starts the thread of the stage. Elements can only be pushed after the
+    // stage is started.
+    void Start(const Handler& handler);
+
+    // Indicates whether the stage is started.
+    bool started() const { return _thread.joinable(); }
+
+    // Pushes an element. Must always be called from the same thread.
+    void Push(const T& element);
+
+    // Waits until all the pushed elements have been handled. Rethrows the
+    // first exception thrown by the handler since the last call.
+    void Drain();
+
+private:
+    void ThreadMain();
+
+    // Waits a little longer at each call.
+    static void Backoff(size_t* attempt);
+
+    // Elements waiting to be handled.
+    SpscRing<T> _ring;
+
+    // Handles the elements.
+    Handler _handler;
+
+    // Thread of the stage.
+    std::thread _thread;
+
+    // Number of elements pushed. Only accessed by the pushing thread.
+    size_t _numPushed;
+
+    // Number of elements handled.
+    std::atomic<size_t> _numHandled;
+
+    // Indicates that the thread must exit.
+    std::atomic<bool> _stop;
+
+    // First exception thrown by the handler. Published by |_numHandled|.
+    std::exception_ptr _exception;
+};
+
+template <typename T>
+PipelineStage<T>::PipelineStage(size_t capacity)
+    : _ring(capacity), _numPushed(0), _numHandled(0), _stop(false)
+{
+}
+
+template <typename T>
+PipelineStage<T>::~PipelineStage()
+{
+    if (!started())
+        return;
+
+    size_t attempt = 0;
+    while (_numHandled.load(std::memory_order_acquire) != _numPushed)
+        Backoff(&attempt);
+    _stop.store(true, std::memory_order_release);
+    _thread.join();
+}
+
+template <typename T>
+void PipelineStage<T>::Start(const Handler& handler)
+{
+    _handler = handler;
+    _thread = std::thread(&PipelineStage<T>::ThreadMain, this);
+}
+
+template <typename T>
+void PipelineStage<T>::Push(const T& element)
+{
+    size_t attempt = 0;
+    while (!_ring.TryPush(element))
+        Backoff(&attempt);
+    ++_numPushed;
+}
+
+template <typename T>
+void PipelineStage<T>::Drain()
+{
+    if (!started())
+        return;
+
+    size_t attempt = 0;
+    while (_numHandled.load(std::memory_order_acquire) != _numPushed)
+        Backoff(&attempt);
+
+    std::exception_ptr exception;
+    std::swap(exception, _exception);
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+template <typename T>
+void PipelineStage<T>::ThreadMain()
+{
+    T element;
+    size_t attempt = 0;
+
+    for (;;)
+    {
+        if (!_ring.TryPop(&element))
+        {
+            if (_stop.load(std::memory_order_acquire))
+                return;
+            Backoff(&attempt);
+            continue;
+        }
+        attempt = 0;
+
+        try
+        {
+            _handler(element);
+        }
+        catch (...)
+        {
+            if (!_exception)
+                _exception = std::current_exception();
+        }
+        _numHandled.fetch_add(1, std::memory_order_release);
+    }
+}
+
+template <typename T>
+void PipelineStage<T>::Backoff(size_t* attempt)
+{
+    // Spin briefly, since the other thread usually catches up quickly, then
+    // release the core.
+    const size_t kNumSpins = 64;
+    const size_t kNumYields = 1024;
+
+    ++*attempt;
+    if (*attempt <= kNumSpins)
+        return;
+    if (*attempt <= kNumYields)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+}  // namespace base
+}  // namespace tibee
+
+#endif  // _TIBEE_BASE_PIPELINESTAGE_HPP
@@ -0,0 +1,93 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/PipelineStage.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+TEST(PipelineStage, HandlesInOrder)
+{
+    std::vector<int> handled;
+    PipelineStage<int> stage(8);
+    EXPECT_FALSE(stage.started());
+
+    stage.Start([&handled](const int& element) {
+        handled.push_back(element);
+    });
+    EXPECT_TRUE(stage.started());
+
+    for (int i = 0; i < 1000; ++i)
+        stage.Push(i);
+    stage.Drain();
+
+    ASSERT_EQ(1000u, handled.size());
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(i, handled[i]);
+
+    // The stage can be used after a drain.
+    stage.Push(1000);
+    stage.Drain();
+    EXPECT_EQ(1001u, handled.size());
+}
+
+TEST(PipelineStage, DrainRethrows)
+{
+    int sum = 0;
+    PipelineStage<int> stage(4);
+    stage.Start([&sum](const int& element) {
+        if (element == 2)
+            throw std::runtime_error("error");
+        sum += element;
+    });
+
+    for (int i = 0; i < 5; ++i)
+        stage.Push(i);
+    EXPECT_THROW(stage.Drain(), std::runtime_error);
+
+    // The other elements are handled.
+    EXPECT_EQ(0 + 1 + 3 + 4, sum);
+    stage.Drain();
+}
+
+TEST(PipelineStage, DestructorHandlesPushedElements)
+{
+    int sum = 0;
+    {
+        PipelineStage<int> stage(2);
+        stage.Start([&sum](const int& element) { sum += element; });
+        for (int i = 1; i <= 100; ++i)
+            stage.Push(i);
+    }
+    EXPECT_EQ(5050, sum);
+}
+
+TEST(PipelineStage, NotStarted)
+{
+    PipelineStage<int> stage(2);
+    stage.Drain();
+}
+
+}  // namespace base
+}  // namespace tibee
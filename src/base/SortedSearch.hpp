@@ -0,0 +1,153 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_SORTEDSEARCH_HPP
+#define _TIBEE_BASE_SORTEDSEARCH_HPP
+
+#include <algorithm>
+#include <stddef.h>
+#include <vector>
+
+namespace tibee
+{
+namespace base
+{
+
+// Returns a pointer to the first element of the sorted array
+// [first, first + length) that is not less than |value|. The loop has no
+// data-dependent branch: the compiler turns the comparison into a
+// conditional move.
+template <typename T>
+const T* BranchlessLowerBound(const T* first, size_t length, T value)
+{
+    if (length == 0)
+        return first;
+
+    while (length > 1)
+    {
+        size_t half = length / 2;
+        first = (first[half] < value) ? first + half : first;
+        length -= half;
+    }
+    return first + (*first < value);
+}
+
+// Returns a pointer to the first element of the sorted array
+// [first, first + length) that is greater than |value|.
+template <typename T>
+const T* BranchlessUpperBound(const T* first, size_t length, T value)
+{
+    if (length == 0)
+        return first;
+
+    while (length > 1)
+    {
+        size_t half = length / 2;
+        first = (first[half] <= value) ? first + half : first;
+        length -= half;
+    }
+    return first + (*first <= value);
+}
+
+// Returns the smallest index in [0, length) for which |isAfter(index)| is
+// true, or |length| if there is none. |isAfter| must be false for a prefix
+// of the indexes and true for the rest. The search gallops from |hint|, so
+// it takes O(log d) steps, where d is the distance between |hint| and the
+// result: queries that move forward in small steps are amortized O(1).
+template <typename IsAfter>
+size_t GallopingPartitionPoint(size_t length, size_t hint,
+                               const IsAfter& isAfter)
+{
+    if (hint > length)
+        hint = length;
+
+    // The result is in [begin, end].
+    size_t begin = 0;
+    size_t end = hint;
+    size_t step = 1;
+
+    if (hint < length && !isAfter(hint))
+    {
+        begin = hint + 1;
+        end = length;
+        while (begin + step - 1 < length)
+        {
+            size_t probe = begin + step - 1;
+            if (isAfter(probe))
+            {
+                end = probe;
+                break;
+            }
+            begin = probe + 1;
+            step *= 2;
+        }
+    }
+    else
+    {
+        while (end >= step)
+        {
+            size_t probe = end - step;
+            if (!isAfter(probe))
+            {
+                begin = probe + 1;
+                break;
+            }
+            end = probe;
+            step *= 2;
+        }
+    }
+
+    while (begin < end)
+    {
+        size_t middle = begin + (end - begin) / 2;
+        if (isAfter(middle))
+            end = middle;
+        else
+            begin = middle + 1;
+    }
+    return begin;
+}
+
+// Fills |order| with the indexes of |queries|, sorted by the group of each
+// query, then by timestamp. |getGroup| and |getTs| return the group and the
+// timestamp of a query. Batched lookups sweep each group of the sorted
+// queries in a single pass.
+template <typename Query, typename GetGroup, typename GetTs>
+void SortQueries(const std::vector<Query>& queries,
+                 const GetGroup& getGroup,
+                 const GetTs& getTs,
+                 std::vector<size_t>* order)
+{
+    order->resize(queries.size());
+    for (size_t i = 0; i < queries.size(); ++i)
+        (*order)[i] = i;
+
+    std::sort(order->begin(), order->end(), [&](size_t left, size_t right) {
+        const auto& leftQuery = queries[left];
+        const auto& rightQuery = queries[right];
+        auto leftGroup = getGroup(leftQuery);
+        auto rightGroup = getGroup(rightQuery);
+        if (leftGroup != rightGroup)
+            return leftGroup < rightGroup;
+        return getTs(leftQuery) < getTs(rightQuery);
+    });
+}
+
+}  // namespace base
+}  // namespace tibee
+
+#endif // _TIBEE_BASE_SORTEDSEARCH_HPP
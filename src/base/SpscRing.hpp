@@ -0,0 +1,140 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_SPSCRING_HPP
+#define _TIBEE_BASE_SPSCRING_HPP
+
+#include <atomic>
+#include <boost/utility.hpp>
+#include <stddef.h>
+#include <vector>
+
+namespace tibee
+{
+namespace base
+{
+
+// Bounded queue shared by exactly one producer thread and one consumer
+// thread. Pushing and popping never lock: they fail when the ring is full
+// or empty. Elements are popped in the order in which they were pushed.
+template <typename T>
+class SpscRing : boost::noncopyable
+{
+public:
+    // Constructor.
+    // @param capacity Maximum number of elements. Rounded up to a power
+    //     of two.
+    explicit SpscRing(size_t capacity);
+
+    // Destructor.
+    ~SpscRing();
+
+    // Pushes an element. Must only be called by the producer.
+    // @returns false if the ring is full.
+    bool TryPush(const T& element);
+
+    // Pops the oldest element. Must only be called by the consumer.
+    // @returns false if the ring is empty.
+    bool TryPop(T* element);
+
+    // Maximum number of elements.
+    size_t capacity() const { return _mask + 1; }
+
+private:
+    // Cache line size. The members written by the producer and by the
+    // consumer are kept on different lines.
+    static const size_t kCacheLineSize = 64;
+
+    // Elements.
+    std::vector<T> _elements;
+
+    // Capacity - 1.
+    size_t _mask;
+
+    char _padding0[kCacheLineSize];
+
+    // Number of elements popped. Written by the consumer.
+    std::atomic<size_t> _head;
+
+    // Last value of |_tail| seen by the consumer.
+    size_t _consumerTail;
+
+    char _padding1[kCacheLineSize];
+
+    // Number of elements pushed. Written by the producer.
+    std::atomic<size_t> _tail;
+
+    // Last value of |_head| seen by the producer.
+    size_t _producerHead;
+};
+
+template <typename T>
+SpscRing<T>::SpscRing(size_t capacity)
+    : _mask(0), _head(0), _consumerTail(0), _tail(0), _producerHead(0)
+{
+    size_t roundedCapacity = 1;
+    while (roundedCapacity < capacity)
+        roundedCapacity *= 2;
+    _elements.resize(roundedCapacity);
+    _mask = roundedCapacity - 1;
+}
+
+template <typename T>
+SpscRing<T>::~SpscRing()
+{
+}
+
+template <typename T>
+bool SpscRing<T>::TryPush(const T& element)
+{
+    size_t tail = _tail.load(std::memory_order_relaxed);
+
+    // Only read the index of the consumer when the ring looks full.
+    if (tail - _producerHead > _mask)
+    {
+        _producerHead = _head.load(std::memory_order_acquire);
+        if (tail - _producerHead > _mask)
+            return false;
+    }
+
+    _elements[tail & _mask] = element;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T>
+bool SpscRing<T>::TryPop(T* element)
+{
+    size_t head = _head.load(std::memory_order_relaxed);
+
+    // Only read the index of the producer when the ring looks empty.
+    if (head == _consumerTail)
+    {
+        _consumerTail = _tail.load(std::memory_order_acquire);
+        if (head == _consumerTail)
+            return false;
+    }
+
+    *element = _elements[head & _mask];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+}  // namespace base
+}  // namespace tibee
+
+#endif  // _TIBEE_BASE_SPSCRING_HPP
@@ -0,0 +1,83 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#include "base/SpscRing.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+TEST(SpscRing, FullAndEmpty)
+{
+    SpscRing<int> ring(3);
+    EXPECT_EQ(4u, ring.capacity());
+
+    int element = 0;
+    EXPECT_FALSE(ring.TryPop(&element));
+
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.TryPush(i));
+    EXPECT_FALSE(ring.TryPush(4));
+
+    EXPECT_TRUE(ring.TryPop(&element));
+    EXPECT_EQ(0, element);
+    EXPECT_TRUE(ring.TryPush(4));
+
+    for (int i = 1; i <= 4; ++i)
+    {
+        EXPECT_TRUE(ring.TryPop(&element));
+        EXPECT_EQ(i, element);
+    }
+    EXPECT_FALSE(ring.TryPop(&element));
+}
+
+TEST(SpscRing, TwoThreadsKeepOrder)
+{
+    const size_t kNumElements = 10000;
+    SpscRing<size_t> ring(16);
+
+    std::thread producer([&ring] {
+        for (size_t i = 0; i < kNumElements; ++i)
+        {
+            while (!ring.TryPush(i))
+                std::this_thread::yield();
+        }
+    });
+
+    size_t expected = 0;
+    while (expected < kNumElements)
+    {
+        size_t element = 0;
+        if (!ring.TryPop(&element))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        ASSERT_EQ(expected, element);
+        ++expected;
+    }
+
+    producer.join();
+}
+
+}  // namespace base
+}  // namespace tibee
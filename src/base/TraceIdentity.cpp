@@ -0,0 +1,122 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "base/TraceIdentity.hpp"
+
+#include <boost/filesystem/fstream.hpp>
+#include <iterator>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace tibee
+{
+namespace base
+{
+
+namespace
+{
+
+namespace bfs = boost::filesystem;
+
+// Magic number of a packetized metadata file, in both byte orders.
+const uint32_t kMetadataPacketMagic = 0x75D11D57;
+const uint32_t kMetadataPacketMagicSwapped = 0x571DD175;
+
+const size_t kUuidLength = 16;
+const size_t kUuidStringLength = 36;
+
+// Directory that contains the chunks of a rotated session.
+const char kArchivesDirectory[] = "archives";
+
+std::string FormatUuid(const unsigned char* uuid)
+{
+    char str[kUuidStringLength + 1];
+    snprintf(str, sizeof(str),
+             "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-"
+             "%02x%02x%02x%02x%02x%02x",
+             uuid[0], uuid[1], uuid[2], uuid[3], uuid[4], uuid[5],
+             uuid[6], uuid[7], uuid[8], uuid[9], uuid[10], uuid[11],
+             uuid[12], uuid[13], uuid[14], uuid[15]);
+    return str;
+}
+
+// Finds the uuid of the trace block of a plain text metadata.
+bool FindTextUuid(const std::string& text, std::string* uuid)
+{
+    size_t pos = text.find("trace {");
+    if (pos == std::string::npos)
+        return false;
+    pos = text.find("uuid", pos);
+    if (pos == std::string::npos)
+        return false;
+    pos = text.find('"', pos);
+    if (pos == std::string::npos || pos + kUuidStringLength >= text.size())
+        return false;
+    if (text[pos + kUuidStringLength + 1] != '"')
+        return false;
+
+    *uuid = text.substr(pos + 1, kUuidStringLength);
+    return true;
+}
+
+}  // namespace
+
+bool ReadTraceUuid(const bfs::path& tracePath, std::string* uuid)
+{
+    bfs::ifstream file(tracePath / "metadata", std::ios::binary);
+    if (!file)
+        return false;
+
+    // A packetized metadata file starts with a header that contains the
+    // uuid of the trace.
+    uint32_t magic = 0;
+    unsigned char bytes[kUuidLength];
+    if (file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) &&
+        (magic == kMetadataPacketMagic || magic == kMetadataPacketMagicSwapped))
+    {
+        if (!file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)))
+            return false;
+        *uuid = FormatUuid(bytes);
+        return true;
+    }
+
+    file.clear();
+    file.seekg(0);
+    std::string text((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+    return FindTextUuid(text, uuid);
+}
+
+std::string TraceIdentity(const bfs::path& tracePath)
+{
+    std::string uuid;
+    if (!ReadTraceUuid(tracePath, &uuid))
+        return std::string();
+
+    // The chunks of a rotated session share the uuid of the session.
+    for (bfs::path path = tracePath; path.has_parent_path();
+         path = path.parent_path())
+    {
+        if (path.parent_path().filename() == kArchivesDirectory)
+            return uuid + "/" + path.filename().string();
+    }
+    return uuid;
+}
+
+}  // namespace base
+}  // namespace tibee
@@ -0,0 +1,43 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_TRACEIDENTITY_HPP
+#define _TIBEE_BASE_TRACEIDENTITY_HPP
+
+#include <boost/filesystem.hpp>
+#include <string>
+
+namespace tibee
+{
+namespace base
+{
+
+// Reads the uuid of a CTF trace from its metadata file, which can be
+// packetized or plain text.
+// @returns false if the metadata file can't be read or has no uuid.
+bool ReadTraceUuid(const boost::filesystem::path& tracePath, std::string* uuid);
+
+// Identity of a trace that doesn't depend on where it is stored: the uuid
+// of its metadata and, for a chunk of a rotated session, the name of the
+// chunk.
+// @returns an empty string if the trace has no uuid.
+std::string TraceIdentity(const boost::filesystem::path& tracePath);
+
+}  // namespace base
+}  // namespace tibee
+
+#endif // _TIBEE_BASE_TRACEIDENTITY_HPP
@@ -0,0 +1,131 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <stdint.h>
+
+#include "base/TraceIdentity.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+namespace
+{
+
+namespace bfs = boost::filesystem;
+
+const char kUuid[] = "9f8a3c1e-4b2d-4e6f-8a1b-0c2d3e4f5a6b";
+
+const char kTextMetadata[] =
+    "/* CTF 1.8 */\n"
+    "trace {\n"
+    "\tmajor = 1;\n"
+    "\tminor = 8;\n"
+    "\tuuid = \"9f8a3c1e-4b2d-4e6f-8a1b-0c2d3e4f5a6b\";\n"
+    "\tbyte_order = le;\n"
+    "};\n"
+    "clock {\n"
+    "\tname = monotonic;\n"
+    "\tuuid = \"00000000-0000-0000-0000-000000000000\";\n"
+    "};\n";
+
+class TraceIdentityTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        _root = bfs::temp_directory_path() / bfs::unique_path();
+        bfs::create_directories(_root);
+    }
+
+    void TearDown() override
+    {
+        bfs::remove_all(_root);
+    }
+
+    bfs::path MakeTrace(const bfs::path& relative, const std::string& metadata)
+    {
+        bfs::path trace = _root / relative;
+        bfs::create_directories(trace);
+        bfs::ofstream file(trace / "metadata", std::ios::binary);
+        file << metadata;
+        return trace;
+    }
+
+    bfs::path _root;
+};
+
+}  // namespace
+
+TEST_F(TraceIdentityTest, TextMetadata)
+{
+    auto trace = MakeTrace("session/kernel", kTextMetadata);
+
+    std::string uuid;
+    EXPECT_TRUE(ReadTraceUuid(trace, &uuid));
+    EXPECT_EQ(kUuid, uuid);
+    EXPECT_EQ(kUuid, TraceIdentity(trace));
+}
+
+TEST_F(TraceIdentityTest, PacketizedMetadata)
+{
+    std::string metadata;
+    uint32_t magic = 0x75D11D57;
+    metadata.append(reinterpret_cast<const char*>(&magic), sizeof(magic));
+    const unsigned char bytes[] = {
+        0x9f, 0x8a, 0x3c, 0x1e, 0x4b, 0x2d, 0x4e, 0x6f,
+        0x8a, 0x1b, 0x0c, 0x2d, 0x3e, 0x4f, 0x5a, 0x6b};
+    metadata.append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    metadata.append(17, '\0');
+    metadata.append(kTextMetadata);
+
+    auto trace = MakeTrace("session/kernel", metadata);
+    std::string uuid;
+    EXPECT_TRUE(ReadTraceUuid(trace, &uuid));
+    EXPECT_EQ(kUuid, uuid);
+}
+
+TEST_F(TraceIdentityTest, RotationChunks)
+{
+    auto first = MakeTrace("session/archives/20150101T000000-20150101T000010-0/kernel",
+                           kTextMetadata);
+    auto second = MakeTrace("session/archives/20150101T000010-20150101T000020-1/kernel",
+                            kTextMetadata);
+
+    EXPECT_EQ(std::string(kUuid) + "/20150101T000000-20150101T000010-0",
+              TraceIdentity(first));
+    EXPECT_EQ(std::string(kUuid) + "/20150101T000010-20150101T000020-1",
+              TraceIdentity(second));
+}
+
+TEST_F(TraceIdentityTest, NoUuid)
+{
+    auto trace = MakeTrace("session/kernel", "/* CTF 1.8 */\ntrace {\n};\n");
+    std::string uuid;
+    EXPECT_FALSE(ReadTraceUuid(trace, &uuid));
+    EXPECT_EQ("", TraceIdentity(trace));
+
+    EXPECT_FALSE(ReadTraceUuid(_root / "missing", &uuid));
+}
+
+}  // namespace base
+}  // namespace tibee
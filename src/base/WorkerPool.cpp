@@ -0,0 +1,106 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "base/WorkerPool.hpp"
+
+#include <algorithm>
+
+namespace tibee
+{
+namespace base
+{
+
+WorkerPool::WorkerPool(size_t numWorkers)
+    : _numPending(0), _stop(false)
+{
+    if (numWorkers == 0)
+        numWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (size_t i = 0; i < numWorkers; ++i)
+        _workers.push_back(std::thread(&WorkerPool::WorkerMain, this));
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _tasksCompleted.wait(lock, [this] { return _numPending == 0; });
+        _stop = true;
+    }
+    _taskPosted.notify_all();
+
+    for (auto& worker : _workers)
+        worker.join();
+}
+
+void WorkerPool::Post(const Task& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(task);
+        ++_numPending;
+    }
+    _taskPosted.notify_one();
+}
+
+void WorkerPool::Wait()
+{
+    std::exception_ptr exception;
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _tasksCompleted.wait(lock, [this] { return _numPending == 0; });
+        std::swap(exception, _exception);
+    }
+
+    if (exception)
+        std::rethrow_exception(exception);
+}
+
+void WorkerPool::WorkerMain()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    for (;;)
+    {
+        _taskPosted.wait(lock, [this] { return _stop || !_tasks.empty(); });
+        if (_tasks.empty())
+            return;
+
+        Task task(std::move(_tasks.front()));
+        _tasks.pop_front();
+
+        lock.unlock();
+        std::exception_ptr exception;
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        lock.lock();
+
+        if (exception && !_exception)
+            _exception = exception;
+        if (--_numPending == 0)
+            _tasksCompleted.notify_all();
+    }
+}
+
+}  // namespace base
+}  // namespace tibee
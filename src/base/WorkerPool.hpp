@@ -0,0 +1,90 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_BASE_WORKERPOOL_HPP
+#define _TIBEE_BASE_WORKERPOOL_HPP
+
+#include <boost/utility.hpp>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tibee
+{
+namespace base
+{
+
+// Runs tasks on a fixed number of background threads.
+class WorkerPool : boost::noncopyable
+{
+public:
+    typedef std::function<void ()> Task;
+
+    // Constructor.
+    // @param numWorkers Number of threads. Uses the number of hardware
+    //     threads when zero.
+    explicit WorkerPool(size_t numWorkers);
+
+    // Destructor. Waits for the posted tasks to complete.
+    ~WorkerPool();
+
+    // Posts a task. Tasks start in the order in which they are posted.
+    void Post(const Task& task);
+
+    // Waits until all the posted tasks have completed. Rethrows the first
+    // exception thrown by a task since the last call.
+    void Wait();
+
+    // Number of threads of the pool.
+    size_t size() const { return _workers.size(); }
+
+private:
+    void WorkerMain();
+
+    // Worker threads.
+    std::vector<std::thread> _workers;
+
+    // Tasks that are waiting for a worker.
+    std::deque<Task> _tasks;
+
+    // Number of tasks posted and not completed.
+    size_t _numPending;
+
+    // Indicates that the workers must exit.
+    bool _stop;
+
+    // First exception thrown by a task.
+    std::exception_ptr _exception;
+
+    // Protects all the members above, except |_workers|.
+    std::mutex _mutex;
+
+    // Signaled when a task is posted or when the pool stops.
+    std::condition_variable _taskPosted;
+
+    // Signaled when the last pending task completes.
+    std::condition_variable _tasksCompleted;
+};
+
+}  // namespace base
+}  // namespace tibee
+
+#endif // _TIBEE_BASE_WORKERPOOL_HPP
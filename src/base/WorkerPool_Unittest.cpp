@@ -0,0 +1,90 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "base/WorkerPool.hpp"
+
+namespace tibee
+{
+namespace base
+{
+
+TEST(WorkerPool, RunsAllTasks)
+{
+    WorkerPool pool(4);
+    EXPECT_EQ(4u, pool.size());
+
+    std::atomic<size_t> sum(0);
+    for (size_t i = 1; i <= 1000; ++i)
+        pool.Post([&sum, i] { sum += i; });
+    pool.Wait();
+    EXPECT_EQ(500500u, sum.load());
+
+    // The pool can be reused after a wait.
+    pool.Post([&sum] { sum = 0; });
+    pool.Wait();
+    EXPECT_EQ(0u, sum.load());
+}
+
+TEST(WorkerPool, SingleWorkerKeepsOrder)
+{
+    WorkerPool pool(1);
+
+    std::vector<int> order;
+    for (int i = 0; i < 100; ++i)
+        pool.Post([&order, i] { order.push_back(i); });
+    pool.Wait();
+
+    ASSERT_EQ(100u, order.size());
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(i, order[i]);
+}
+
+TEST(WorkerPool, RethrowsException)
+{
+    WorkerPool pool(2);
+
+    std::atomic<size_t> count(0);
+    pool.Post([] { throw std::runtime_error("task failed"); });
+    for (size_t i = 0; i < 10; ++i)
+        pool.Post([&count] { ++count; });
+
+    EXPECT_THROW(pool.Wait(), std::runtime_error);
+    EXPECT_EQ(10u, count.load());
+
+    // The exception is only reported once.
+    pool.Wait();
+}
+
+TEST(WorkerPool, DestructorWaitsForTasks)
+{
+    std::atomic<size_t> count(0);
+    {
+        WorkerPool pool(2);
+        for (size_t i = 0; i < 100; ++i)
+            pool.Post([&count] { ++count; });
+    }
+    EXPECT_EQ(100u, count.load());
+}
+
+}  // namespace base
+}  // namespace tibee
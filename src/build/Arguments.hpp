@@ -18,6 +18,7 @@
 #ifndef _TIBEE_BUILD_ARGUMENTS_HPP
 #define _TIBEE_BUILD_ARGUMENTS_HPP
 
+#include <stdint.h>
 #include <vector>
 #include <string>
 
@@ -27,11 +28,11 @@ namespace build
 {
 
 /**
- * Program arguments.
+ * Definition of a kind of execution.
  *
  * @author Francois Doray
  */
-struct Arguments
+struct ExecutionDefinition
 {
     // Name of the executions.
     std::string name;
@@ -44,6 +45,17 @@ struct Arguments
 
     // Executable to analyze (optional).
     std::string exec;
+};
+
+/**
+ * Program arguments.
+ *
+ * @author Francois Doray
+ */
+struct Arguments
+{
+    // Definitions of the executions, all extracted in a single pass.
+    std::vector<ExecutionDefinition> definitions;
 
     // Traces to analyze.
     std::vector<std::string> traces;
@@ -57,7 +69,58 @@ struct Arguments
     // Execute the special block!
     bool special;
 
-    // Verbose flag.
+    // Only record the state history of the threads reachable from
+    // analyzed executions.
+    bool selectiveHistory;
+
+    // Only record the analyzed threads and the threads that wake them up
+    // in detail in the critical graph.
+    bool pruneGraph;
+
+    // Symbolize stacks on a separate pipeline stage.
+    bool pipeline;
+
+    // Save executions as soon as the trace passes their end, using
+    // background workers.
+    bool streaming;
+
+    // Maximum age of the history kept for executions that are still
+    // active, in seconds. Only used without a memory budget.
+    uint64_t maxRetention;
+
+    // Memory that the histories should not exceed, in MB. The interval at
+    // which executions are saved and the history kept for the active
+    // executions adapt to it. 0 to save at fixed intervals.
+    uint64_t memoryBudget;
+
+    // Find the execution windows in a first pass over the trace, then only
+    // run the expensive analyses inside them.
+    bool twoPass;
+
+    // History analyzed before each execution window, in milliseconds.
+    uint64_t windowMargin;
+
+    // Number of time slices of a trace analyzed concurrently. The slices
+    // are found by a first pass over the trace.
+    size_t timeSlices;
+
+    // Restart from the last checkpoint written by a previous run on the
+    // same traces, without saving its executions again.
+    bool resume;
+
+    // Archive directory of a rotating tracing session to watch. Each chunk
+    // is ingested once it is closed. Empty to analyze |traces|.
+    std::string follow;
+
+    // Number of tracing sessions analyzed concurrently. The traces of a
+    // session are always analyzed together.
+    size_t parallelTraces;
+
+    // File to which a profile of the run is written, in the Chrome trace
+    // event format. Empty to not write a profile.
+    std::string profileOutput;
+
+    // Verbose flag. Also prints a periodic summary of the instrumentation.
     bool verbose;
 };
 
@@ -17,12 +17,27 @@
  */
 #include "build/TibeeBuild.hpp"
 
+#include <algorithm>
+#include <boost/algorithm/string/join.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
 #include <sstream>
+#include <thread>
 
+#include "base/DirectoryWatcher.hpp"
+#include "base/Instrumentation.hpp"
+#include "base/TraceIdentity.hpp"
+#include "base/WorkerPool.hpp"
 #include "base/print.hpp"
 #include "base/ex/InvalidArgument.hpp"
 #include "block/BlockRunner.hpp"
+#include "db/Database.hpp"
 #include "value/MakeValue.hpp"
 #include "value/Value.hpp"
 
@@ -31,6 +46,7 @@
 #include "critical_blocks/CriticalBlock.hpp"
 #include "execution_blocks/PunchBlock.hpp"
 #include "execution_blocks/SpecialBlock.hpp"
+#include "execution_blocks/WindowsBlock.hpp"
 #include "stacks_blocks/ProfilerBlock.hpp"
 #include "state_blocks/CurrentStateBlock.hpp"
 #include "state_blocks/LinuxSchedStateBlock.hpp"
@@ -76,6 +92,172 @@ void FindTraces(const bfs::path& parent,
     }
 }
 
+// Directory of the tracing session of a trace. The kernel trace and the
+// user space traces of a session are in the "kernel" and "ust"
+// subdirectories of the session.
+bfs::path SessionForTrace(const bfs::path& tracePath)
+{
+    for (bfs::path path = tracePath; path.has_parent_path();
+         path = path.parent_path())
+    {
+        if (path.filename() == "kernel" || path.filename() == "ust")
+            return path.parent_path();
+    }
+    return tracePath;
+}
+
+value::StructValue::UP MakeTraceParams(const std::vector<bfs::path>& tracePaths)
+{
+    value::ArrayValue::UP traces {new value::ArrayValue};
+    for (const auto& tracePath : tracePaths)
+        traces->Append(value::MakeValue(tracePath.string()));
+    value::StructValue::UP traceParams {new value::StructValue};
+    traceParams->AddField("traces", std::move(traces));
+    return traceParams;
+}
+
+value::ArrayValue::UP MakeDefinitions(
+    const std::vector<ExecutionDefinition>& definitions)
+{
+    value::ArrayValue::UP definitionsValue {new value::ArrayValue};
+    for (const auto& definition : definitions)
+    {
+        value::StructValue::UP definitionValue {new value::StructValue};
+        definitionValue->AddField("name", value::MakeValue(definition.name));
+        definitionValue->AddField("exec", value::MakeValue(definition.exec));
+        definitionValue->AddField("begin", value::MakeValue(definition.beginEvent));
+        definitionValue->AddField("end", value::MakeValue(definition.endEvent));
+        definitionsValue->Append(std::move(definitionValue));
+    }
+    return definitionsValue;
+}
+
+// Key of a trace in the database: its identity when its metadata has a
+// uuid, its absolute path otherwise.
+std::string TraceKey(const bfs::path& tracePath)
+{
+    std::string identity = base::TraceIdentity(tracePath);
+    if (!identity.empty())
+        return identity;
+    return bfs::absolute(tracePath).string();
+}
+
+// Key of a group of traces analyzed together.
+std::string TracesKey(const std::vector<bfs::path>& tracePaths)
+{
+    std::vector<std::string> traces;
+    for (const auto& tracePath : tracePaths)
+        traces.push_back(TraceKey(tracePath));
+    std::sort(traces.begin(), traces.end());
+    return boost::algorithm::join(traces, ";");
+}
+
+// Key of the extraction of some executions from a trace. A trace can be
+// ingested again to extract other executions.
+std::string IngestKey(const bfs::path& tracePath,
+                      const std::vector<ExecutionDefinition>& definitions)
+{
+    std::vector<std::string> names;
+    for (const auto& definition : definitions)
+        names.push_back(definition.name);
+    return TraceKey(tracePath) + "#" + boost::algorithm::join(names, ",");
+}
+
+// Interval between the summaries of the instrumentation.
+const std::chrono::seconds kSummaryInterval(10);
+
+// Prints a summary of the instrumentation periodically on a background
+// thread, and a last one when it is destroyed.
+class SummaryReporter : boost::noncopyable
+{
+public:
+    explicit SummaryReporter(bool enabled)
+        : _stop(false)
+    {
+        if (enabled)
+            _thread = std::thread(&SummaryReporter::Main, this);
+    }
+
+    ~SummaryReporter()
+    {
+        if (!_thread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _stopRequested.notify_one();
+        _thread.join();
+
+        PrintSummary();
+    }
+
+private:
+    void Main()
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        while (!_stopRequested.wait_for(lock, kSummaryInterval,
+                                        [this] { return _stop; }))
+        {
+            PrintSummary();
+        }
+    }
+
+    void PrintSummary()
+    {
+        std::stringstream ss;
+        base::Instrumentation::Get()->PrintSummary(ss);
+        tbmsg(THIS_MODULE) << ss.str() << tbendl();
+    }
+
+    std::thread _thread;
+    bool _stop;
+    std::mutex _mutex;
+    std::condition_variable _stopRequested;
+};
+
+// Indicates whether a previous run ingested a trace.
+bool IsTraceIngested(const db::Database& db, const bfs::path& tracePath,
+                     const std::vector<ExecutionDefinition>& definitions)
+{
+    return !base::TraceIdentity(tracePath).empty() &&
+           db.IsTraceIngested(IngestKey(tracePath, definitions));
+}
+
+// Records that traces were ingested. Traces without identity are not
+// recorded, since they can't be recognized later.
+void SetTracesIngested(const std::vector<bfs::path>& tracePaths,
+                       const std::vector<ExecutionDefinition>& definitions,
+                       db::Database* db)
+{
+    for (const auto& tracePath : tracePaths)
+    {
+        if (!base::TraceIdentity(tracePath).empty())
+            db->SetTraceIngested(IngestKey(tracePath, definitions));
+    }
+}
+
+// Name of the checkpoints of an analysis: the traces it reads, the
+// executions it extracts and, for a time slice, where its windows begin.
+std::string CheckpointName(const std::vector<bfs::path>& tracePaths,
+                           const std::vector<ExecutionDefinition>& definitions,
+                           const execution::ExecutionWindows* executionWindows)
+{
+    std::vector<std::string> names;
+    for (const auto& definition : definitions)
+        names.push_back(definition.name);
+
+    std::string name = TracesKey(tracePaths) + "#" +
+                       boost::algorithm::join(names, ",");
+    if (executionWindows != nullptr && executionWindows->selective() &&
+        !executionWindows->windows().empty())
+    {
+        name += "@" + std::to_string(executionWindows->windows().front().first);
+    }
+    return name;
+}
+
 }  // namespace
 
 TibeeBuild::TibeeBuild(const Arguments& args)
@@ -112,19 +294,269 @@ void TibeeBuild::validateSaveArguments(const Arguments& args)
     }
 }
 
+void TibeeBuild::findExecutionWindows(const std::vector<bfs::path>& traces,
+                                      execution::ExecutionWindows* executionWindows)
+{
+    TIBEE_TRACED_SCOPE("find-execution-windows");
+
+    block::BlockRunner runner;
+
+    // Trace block.
+    value::StructValue::UP traceParams = MakeTraceParams(traces);
+    block::BlockInterface::UP traceBlock(new trace_blocks::TraceBlock);
+    runner.AddBlock(traceBlock.get(), traceParams.get());
+
+    // Windows block.
+    value::StructValue::UP windowsParams {new value::StructValue};
+    windowsParams->AddField("definitions", MakeDefinitions(_args.definitions));
+    block::BlockInterface::UP windowsBlock(
+        new execution_blocks::WindowsBlock(executionWindows));
+    runner.AddBlock(windowsBlock.get(), windowsParams.get());
+
+    runner.Run();
+
+    executionWindows->Merge(_args.windowMargin * 1000000);
+    executionWindows->SetSelective(true);
+}
+
 bool TibeeBuild::run()
 {
     if (_args.verbose)
         tbmsg(THIS_MODULE) << "starting" << tbendl();
 
+    // The instrumentation is enabled before the blocks add their observers,
+    // which are only wrapped with timers when it is.
+    if (_args.verbose || !_args.profileOutput.empty())
+        base::Instrumentation::Get()->Enable(!_args.profileOutput.empty());
+    SummaryReporter reporter(_args.verbose);
+
+    if (!_args.follow.empty())
+        return follow();
+
+    // All the pipelines intern their strings and stacks in the same database.
+    db::Database db;
+
+    // The traces of a session are analyzed together. With a rotating
+    // session, each chunk is a session of its own.
+    std::map<bfs::path, std::vector<bfs::path>> sessions;
+    for (const auto& tracePath : _traces)
+        sessions[SessionForTrace(tracePath)].push_back(tracePath);
+
+    // Skip the sessions whose traces were all ingested by a previous run.
+    bool incremental = !_args.dumpStacks && !_args.stats && !_args.special;
+    if (incremental)
+    {
+        for (auto it = sessions.begin(); it != sessions.end();)
+        {
+            bool ingested = std::all_of(
+                it->second.begin(), it->second.end(),
+                [&](const bfs::path& tracePath) {
+                    return IsTraceIngested(db, tracePath, _args.definitions);
+                });
+            if (!ingested)
+            {
+                ++it;
+                continue;
+            }
+
+            if (_args.verbose)
+            {
+                tbmsg(THIS_MODULE) << "skipping " << it->first
+                                   << ", already ingested" << tbendl();
+            }
+            it = sessions.erase(it);
+        }
+    }
+
+    auto markIngested = [&](const std::vector<bfs::path>& traces) {
+        if (incremental)
+            SetTracesIngested(traces, _args.definitions, &db);
+    };
+
+    if (_args.parallelTraces <= 1)
+    {
+        std::vector<bfs::path> traces;
+        for (const auto& session : sessions)
+            traces.insert(traces.end(), session.second.begin(), session.second.end());
+
+        if (!traces.empty())
+        {
+            runTraces(traces, &db);
+            markIngested(traces);
+        }
+    }
+    else
+    {
+        // The sessions are analyzed independently.
+        if (_args.verbose)
+        {
+            tbmsg(THIS_MODULE) << "analyzing " << sessions.size()
+                               << " sessions with " << _args.parallelTraces
+                               << " workers" << tbendl();
+        }
+
+        base::WorkerPool workers(_args.parallelTraces);
+        for (const auto& session : sessions)
+        {
+            const auto* traces = &session.second;
+            workers.Post([this, traces, &db, &markIngested] {
+                runTraces(*traces, &db);
+                markIngested(*traces);
+            });
+        }
+        workers.Wait();
+    }
+
+    writeProfile();
+
+    if (_args.verbose)
+        tbmsg(THIS_MODULE) << "ending" << tbendl();
+
+    return true;
+}
+
+void TibeeBuild::writeProfile()
+{
+    if (_args.profileOutput.empty())
+        return;
+
+    if (!base::Instrumentation::Get()->WriteProfile(_args.profileOutput))
+    {
+        tberror() << "Unable to write the profile to "
+                  << _args.profileOutput << "." << tbendl();
+    }
+}
+
+bool TibeeBuild::follow()
+{
+    bfs::path archives(_args.follow);
+
+    // Watch the directory before listing it, so that no chunk is missed.
+    base::DirectoryWatcher watcher(archives);
+
+    std::vector<bfs::path> chunks;
+    bfs::directory_iterator end;
+    for (bfs::directory_iterator it(archives); it != end; ++it)
+    {
+        if (bfs::is_directory(it->status()))
+            chunks.push_back(it->path());
+    }
+
+    // Chunk names start with the time at which they begin.
+    std::sort(chunks.begin(), chunks.end());
+
+    db::Database db;
+    std::set<bfs::path> analyzedChunks;
+    std::vector<bfs::path> previousTraces;
+    std::string previousCheckpoint;
+
+    for (;;)
+    {
+        for (const auto& chunk : chunks)
+        {
+            // A chunk can be both listed and reported by the watcher.
+            if (analyzedChunks.count(chunk) != 0)
+                continue;
+
+            std::vector<bfs::path> chunkTraces;
+            FindTraces(chunk, &chunkTraces);
+            if (chunkTraces.empty())
+            {
+                tberror() << "No trace in chunk " << chunk << "." << tbendl();
+                continue;
+            }
+
+            // The previous chunk is read again to rebuild the current state,
+            // but its analyses resume from its last checkpoint.
+            std::vector<bfs::path> traces(previousTraces);
+            traces.insert(traces.end(), chunkTraces.begin(), chunkTraces.end());
+            std::string checkpointName =
+                CheckpointName(traces, _args.definitions, nullptr);
+
+            bool ingested = std::all_of(
+                chunkTraces.begin(), chunkTraces.end(),
+                [&](const bfs::path& tracePath) {
+                    return IsTraceIngested(db, tracePath, _args.definitions);
+                });
+            if (!ingested)
+            {
+                if (_args.verbose)
+                    tbmsg(THIS_MODULE) << "ingesting " << chunk << tbendl();
+
+                runPipeline(traces, &db, nullptr, previousCheckpoint, true);
+                SetTracesIngested(chunkTraces, _args.definitions, &db);
+
+                // Follow mode only ends when it is interrupted.
+                writeProfile();
+            }
+
+            analyzedChunks.insert(chunk);
+            previousTraces.swap(chunkTraces);
+            previousCheckpoint = checkpointName;
+        }
+
+        chunks.clear();
+        watcher.WaitForDirectories(-1, &chunks);
+    }
+
+    return true;
+}
+
+void TibeeBuild::runTraces(const std::vector<bfs::path>& traces,
+                           db::Database* db)
+{
+    bool findWindows = _args.twoPass || _args.timeSlices > 1;
+    if (!findWindows || _args.dumpStacks || _args.stats || _args.special)
+    {
+        runPipeline(traces, db, nullptr, std::string(), false);
+        return;
+    }
+
+    // First pass: find the execution windows.
+    execution::ExecutionWindows executionWindows;
+    findExecutionWindows(traces, &executionWindows);
+
+    if (_args.verbose)
+    {
+        tbmsg(THIS_MODULE) << executionWindows.windows().size()
+                           << " execution windows cover "
+                           << (executionWindows.Coverage() / 1000000)
+                           << " ms of the traces" << tbendl();
+    }
+
+    if (_args.timeSlices <= 1)
+    {
+        runPipeline(traces, db, &executionWindows, std::string(), false);
+        return;
+    }
+
+    // Analyze each time slice concurrently. Slices are cut between the
+    // execution windows, so every execution is analyzed by a single slice.
+    // Each slice has its own pipeline, with its own histories and stack
+    // concatenation cache: the slices only share the database.
+    std::vector<execution::ExecutionWindows> slices;
+    executionWindows.Split(_args.timeSlices, &slices);
+
+    base::WorkerPool workers(slices.size());
+    for (const auto& slice : slices)
+    {
+        const auto* sliceWindows = &slice;
+        workers.Post([this, &traces, db, sliceWindows] {
+            runPipeline(traces, db, sliceWindows, std::string(), false);
+        });
+    }
+    workers.Wait();
+}
+
+void TibeeBuild::runPipeline(const std::vector<bfs::path>& traces,
+                             db::Database* db,
+                             const execution::ExecutionWindows* executionWindows,
+                             const std::string& resumeName, bool openEnded)
+{
     block::BlockRunner runner;
 
     // Trace block.
-    value::ArrayValue::UP traces {new value::ArrayValue};
-    for (const auto& tracePath : _traces)
-        traces->Append(value::MakeValue(tracePath.string()));
-    value::StructValue::UP traceParams {new value::StructValue};
-    traceParams->AddField("traces", std::move(traces));
+    value::StructValue::UP traceParams = MakeTraceParams(traces);
     block::BlockInterface::UP traceBlock(new trace_blocks::TraceBlock);
     runner.AddBlock(traceBlock.get(), traceParams.get());
 
@@ -134,10 +566,7 @@ bool TibeeBuild::run()
     if (!_args.dumpStacks && !_args.special)
     {
         punchParams.reset(new value::StructValue);
-        punchParams->AddField("name", value::MakeValue(_args.name));
-        punchParams->AddField("exec", value::MakeValue(_args.exec));
-        punchParams->AddField("begin", value::MakeValue(_args.beginEvent));
-        punchParams->AddField("end", value::MakeValue(_args.endEvent));
+        punchParams->AddField("definitions", MakeDefinitions(_args.definitions));
         punchParams->AddField("stats", value::MakeValue(_args.stats));
         punchBlock.reset(new execution_blocks::PunchBlock);
         runner.AddBlock(punchBlock.get(), punchParams.get());
@@ -150,15 +579,18 @@ bool TibeeBuild::run()
     // Profiler block.
     value::StructValue::UP profilerParams {new value::StructValue};
     profilerParams->AddField("dump", value::MakeValue(_args.dumpStacks));
+    profilerParams->AddField("pipeline", value::MakeValue(_args.pipeline));
     block::BlockInterface::UP profilerBlock(new stacks_blocks::ProfilerBlock);
     runner.AddBlock(profilerBlock.get(), profilerParams.get());
 
     // Critical block.
+    value::StructValue::UP criticalParams {new value::StructValue};
+    criticalParams->AddField("prune", value::MakeValue(_args.pruneGraph));
     block::BlockInterface::UP criticalBlock;
     if (!_args.dumpStacks && !_args.stats && !_args.special)
     {
         criticalBlock.reset(new critical_blocks::CriticalBlock);
-        runner.AddBlock(criticalBlock.get(), nullptr);
+        runner.AddBlock(criticalBlock.get(), criticalParams.get());
     }
 
     // Linux sched state block.
@@ -189,18 +621,39 @@ bool TibeeBuild::run()
         runner.AddBlock(specialBlock.get(), nullptr);
     }
 
-    // Build block.
+    // Build block. The state history can only be selective if executions
+    // are filtered by executable.
+    bool selectiveHistory = _args.selectiveHistory;
+    bool allFiltered = std::all_of(
+        _args.definitions.begin(), _args.definitions.end(),
+        [](const ExecutionDefinition& definition) {
+            return !definition.exec.empty();
+        });
+    if (selectiveHistory && !allFiltered)
+    {
+        tberror() << "Selective history requires an executable, "
+                     "recording the full history." << tbendl();
+        selectiveHistory = false;
+    }
+    bool noExecutions = _args.dumpStacks || _args.stats || _args.special;
+    std::string checkpointName;
+    if (!noExecutions)
+        checkpointName = CheckpointName(traces, _args.definitions, executionWindows);
+    std::string resumeFrom = resumeName;
+    if (resumeFrom.empty() && _args.resume)
+        resumeFrom = checkpointName;
+
+    // Chunks of a live session are saved as soon as their executions end.
     block::BlockInterface::UP buildBlock(new build_blocks::BuildBlock(
-        _args.dumpStacks || _args.stats || _args.special));
+        db, noExecutions, selectiveHistory,
+        _args.streaming || openEnded, _args.maxRetention * 1000000000,
+        _args.memoryBudget * 1024 * 1024, executionWindows,
+        TracesKey(traces), checkpointName, resumeFrom, openEnded));
     runner.AddBlock(buildBlock.get(), nullptr);
 
     // Run the blocks.
+    TIBEE_TRACED_SCOPE("run-pipeline");
     runner.Run();
-
-    if (_args.verbose)
-        tbmsg(THIS_MODULE) << "ending" << tbendl();
-
-    return true;
 }
 
 }  // namespace build
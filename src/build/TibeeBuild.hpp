@@ -23,6 +23,8 @@
 #include <vector>
 
 #include "build/Arguments.hpp"
+#include "db/Database.hpp"
+#include "execution/ExecutionWindows.hpp"
 
 namespace tibee
 {
@@ -54,6 +56,36 @@ public:
 private:
     void validateSaveArguments(const Arguments& args);
 
+    // Writes the profile of the run to the file given with
+    // --profile-output, if any.
+    void writeProfile();
+
+    // Watches the archive directory of a rotating tracing session and
+    // ingests each chunk once it is closed. Each chunk is analyzed after
+    // the previous one, which is read again to rebuild the current state.
+    // Only returns on error.
+    bool follow();
+
+    // Analyzes traces, saving the executions in |db|. Traces can be
+    // analyzed concurrently.
+    void runTraces(const std::vector<boost::filesystem::path>& traces,
+                   db::Database* db);
+
+    // Analyzes traces with a pipeline of blocks. Expensive analyses are
+    // restricted to |executionWindows| when it isn't nullptr.
+    // @param resumeName Checkpoint from which to resume, or an empty string
+    //     to resume from the checkpoint of the same analysis with --resume.
+    // @param openEnded Indicates that the traces continue in a next chunk.
+    void runPipeline(const std::vector<boost::filesystem::path>& traces,
+                     db::Database* db,
+                     const execution::ExecutionWindows* executionWindows,
+                     const std::string& resumeName, bool openEnded);
+
+    // Finds the time windows of the executions with a first pass over the
+    // traces, decoding only their begin and end events.
+    void findExecutionWindows(const std::vector<boost::filesystem::path>& traces,
+                              execution::ExecutionWindows* executionWindows);
+
     // Arguments.
     Arguments _args;
     std::vector<boost::filesystem::path> _traces;
@@ -15,6 +15,7 @@
  * You should have received a copy of the GNU General Public License
  * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <boost/algorithm/string.hpp>
 #include <boost/program_options.hpp>
 #include <execinfo.h>
 #include <iostream>
@@ -53,9 +54,23 @@ int parseOptions(int argc, char* argv[], tibee::build::Arguments& args)
         ("end,e", bpo::value<std::string>())
         ("exec,x", bpo::value<std::string>())
         ("trace,t", bpo::value<std::vector<std::string>>())
+        ("definition", bpo::value<std::vector<std::string>>())
         ("dump,d", bpo::bool_switch()->default_value(false))
         ("stats,s", bpo::bool_switch()->default_value(false))
         ("special,z", bpo::bool_switch()->default_value(false))
+        ("selective-history", bpo::bool_switch()->default_value(false))
+        ("prune-graph", bpo::bool_switch()->default_value(false))
+        ("streaming", bpo::bool_switch()->default_value(false))
+        ("pipeline", bpo::bool_switch()->default_value(false))
+        ("max-retention", bpo::value<uint64_t>()->default_value(60))
+        ("memory-budget", bpo::value<uint64_t>()->default_value(0))
+        ("two-pass", bpo::bool_switch()->default_value(false))
+        ("parallel-traces", bpo::value<size_t>()->default_value(1))
+        ("time-slices", bpo::value<size_t>()->default_value(1))
+        ("window-margin", bpo::value<uint64_t>()->default_value(1000))
+        ("resume", bpo::bool_switch()->default_value(false))
+        ("follow", bpo::value<std::string>())
+        ("profile-output", bpo::value<std::string>())
         ("verbose,v", bpo::bool_switch()->default_value(false))
     ;
 
@@ -83,7 +98,26 @@ int parseOptions(int argc, char* argv[], tibee::build::Arguments& args)
             "  -e, --end           end event, prepend with ust/ or kernel/" << std::endl <<
             "  -x, --exec          executable to analyze (optional)" << std::endl <<
             "  -t, --trace         path(s) of the trace(s)" << std::endl <<
+            "  --definition        name,begin,end[,exec] of executions to extract in the" << std::endl <<
+            "                      same pass as the other definitions (repeatable)" << std::endl <<
             "  -d, --dump          just dump stacks found in the trace" << std::endl <<
+            "  --selective-history only keep the state history of analyzed threads" << std::endl <<
+            "  --prune-graph       only detail the analyzed threads and their wakers" << std::endl <<
+            "                      (transitively with --two-pass)" << std::endl <<
+            "  --streaming         save executions in the background as the trace is read" << std::endl <<
+            "  --pipeline          symbolize stacks on a separate thread" << std::endl <<
+            "  --max-retention     maximum age of the history kept for active executions," << std::endl <<
+            "                      without a memory budget (s)" << std::endl <<
+            "  --memory-budget     adapt the save interval and the history kept for active" << std::endl <<
+            "                      executions to this memory budget (MB)" << std::endl <<
+            "  --two-pass          find the execution windows first, then only analyze them" << std::endl <<
+            "  --window-margin     history analyzed before each execution window (ms)" << std::endl <<
+            "  --parallel-traces   number of tracing sessions analyzed concurrently" << std::endl <<
+            "  --time-slices       number of time slices of a trace analyzed concurrently" << std::endl <<
+            "  --resume            restart from the last checkpoint of a previous run" << std::endl <<
+            "  --follow            ingest the chunks of this rotation archive directory as" << std::endl <<
+            "                      they are closed (replaces --trace)" << std::endl <<
+            "  --profile-output    write a profile of the run to this file (Chrome trace JSON)" << std::endl <<
             "  -v, --verbose       verbose" << std::endl;
 
         return -1;
@@ -105,19 +139,89 @@ int parseOptions(int argc, char* argv[], tibee::build::Arguments& args)
     // special
     args.special = vm["special"].as<bool>();
 
+    // selective history
+    args.selectiveHistory = vm["selective-history"].as<bool>();
+
+    // prune graph
+    args.pruneGraph = vm["prune-graph"].as<bool>();
+
+    // streaming
+    args.streaming = vm["streaming"].as<bool>();
+
+    // pipeline
+    args.pipeline = vm["pipeline"].as<bool>();
+
+    // max retention
+    args.maxRetention = vm["max-retention"].as<uint64_t>();
+
+    // memory budget
+    args.memoryBudget = vm["memory-budget"].as<uint64_t>();
+
+    // two pass
+    args.twoPass = vm["two-pass"].as<bool>();
+
+    // window margin
+    args.windowMargin = vm["window-margin"].as<uint64_t>();
+
+    // parallel traces
+    args.parallelTraces = vm["parallel-traces"].as<size_t>();
+
+    // time slices
+    args.timeSlices = vm["time-slices"].as<size_t>();
+
+    // resume
+    args.resume = vm["resume"].as<bool>();
+
     // verbose
     args.verbose = vm["verbose"].as<bool>();
 
+    // profile output
+    if (!vm["profile-output"].empty())
+        args.profileOutput = vm["profile-output"].as<std::string>();
+
+    // follow
+    if (!vm["follow"].empty())
+        args.follow = vm["follow"].as<std::string>();
+
     // trace
-    if (vm["trace"].empty()) {
+    if (vm["trace"].empty() && args.follow.empty()) {
         tberror() << "No trace specified." << tbendl();
         return 1;
     }
-    args.traces = vm["trace"].as<std::vector<std::string>>();
+    if (!vm["trace"].empty())
+        args.traces = vm["trace"].as<std::vector<std::string>>();
 
     if (args.dumpStacks || args.special)
         return 0;
 
+    // definitions
+    if (!vm["definition"].empty()) {
+        for (const auto& str : vm["definition"].as<std::vector<std::string>>()) {
+            std::vector<std::string> fields;
+            boost::split(fields, str, boost::is_any_of(","));
+            if (fields.size() < 3 || fields.size() > 4 || fields[0].empty() ||
+                fields[1].empty() || fields[2].empty()) {
+                tberror() << "Invalid execution definition: " << str << tbendl();
+                return 1;
+            }
+
+            tibee::build::ExecutionDefinition definition;
+            definition.name = fields[0];
+            definition.beginEvent = fields[1];
+            definition.endEvent = fields[2];
+            if (fields.size() == 4)
+                definition.exec = fields[3];
+            args.definitions.push_back(definition);
+        }
+    }
+
+    if (vm["name"].empty() && vm["begin"].empty() && vm["end"].empty() &&
+        !args.definitions.empty()) {
+        return 0;
+    }
+
+    tibee::build::ExecutionDefinition definition;
+
     // name
     if (!args.stats)
     {
@@ -125,7 +229,7 @@ int parseOptions(int argc, char* argv[], tibee::build::Arguments& args)
             tberror() << "No name specified." << tbendl();
             return 1;
         }
-        args.name = vm["name"].as<std::string>();
+        definition.name = vm["name"].as<std::string>();
     }
 
     // begin
@@ -133,20 +237,22 @@ int parseOptions(int argc, char* argv[], tibee::build::Arguments& args)
         tberror() << "No begin event specified." << tbendl();
         return 1;
     }
-    args.beginEvent = vm["begin"].as<std::string>();
+    definition.beginEvent = vm["begin"].as<std::string>();
 
     // end
     if (vm["end"].empty()) {
         tberror() << "No end event specified." << tbendl();
         return 1;
     }
-    args.endEvent = vm["end"].as<std::string>();
+    definition.endEvent = vm["end"].as<std::string>();
 
     // exec
     if (!vm["exec"].empty()) {
-        args.exec = vm["exec"].as<std::string>();
+        definition.exec = vm["exec"].as<std::string>();
     }
 
+    args.definitions.push_back(definition);
+
     return 0;
 }
 
@@ -17,21 +17,173 @@
  */
 #include "build_blocks/AbstractBuildBlock.hpp"
 
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <typeinfo>
+#include <vector>
+
 #include "base/CompareConstants.hpp"
 #include "base/Constants.hpp"
+#include "base/Instrumentation.hpp"
 #include "block/ServiceList.hpp"
+#include "notification/NotificationCenter.hpp"
+#include "notification/Token.hpp"
 
 namespace tibee {
 namespace build_blocks {
 
+namespace
+{
+
+// The pointer of the name of an event identifies its class. The name must
+// be owned by the trace reader: a temporary string can't identify anything.
+const char* InternedName(const char* name)
+{
+    return name;
+}
+
+const char* InternedName(const std::string& name)
+{
+    return name.c_str();
+}
+
+const char* InternedName(std::string&& name) = delete;
+
+// Measures the time spent in an event observer, with a timer per event
+// name. Event ids are only unique within a stream class of a trace: the
+// timers of an id are kept with the name of their event, which the trace
+// reader interns.
+class TimedEventObserver
+{
+public:
+    typedef std::function<void (const trace::EventValue& event)> Observer;
+
+    TimedEventObserver(const std::string& name, const Observer& observer)
+        : _name(name), _observer(observer) {}
+
+    void operator()(const trace::EventValue& event)
+    {
+        if (!base::Instrumentation::enabled())
+        {
+            _observer(event);
+            return;
+        }
+
+        base::ScopedTimer timer(GetTimer(event), false);
+        _observer(event);
+    }
+
+private:
+    typedef std::pair<const char*, base::Instrumentation::Timer*> EventTimer;
+
+    base::Instrumentation::Timer* GetTimer(const trace::EventValue& event)
+    {
+        size_t id = event.getId();
+        if (id >= _eventTimers.size())
+            _eventTimers.resize(id + 1);
+
+        auto& timers = _eventTimers[id];
+        const char* eventName = InternedName(event.getName());
+        for (const auto& timer : timers)
+        {
+            if (timer.first == eventName)
+                return timer.second;
+        }
+
+        std::string name(eventName);
+        timers.push_back(EventTimer(
+            eventName, base::Instrumentation::Get()->GetTimer(_name + "/" + name)));
+        return timers.back().second;
+    }
+
+    std::string _name;
+    Observer _observer;
+    std::vector<std::vector<EventTimer>> _eventTimers;
+};
+
+// Unboxes the notifications of an attribute of the current state and
+// dispatches them to the observers of its channel.
+class StateChangeAdapter
+{
+public:
+    StateChangeAdapter(state::StateChanges* stateChanges,
+                       state::StateChanges::Channel channel)
+        : _stateChanges(stateChanges), _channel(channel) {}
+
+    void Notify(thread_t thread, const value::Value* value)
+    {
+        const auto& layout = GetLayout(value);
+
+        state::StateChange change;
+        change.thread = thread;
+        change.key = state::AttributeKey(
+            value->GetField(layout.keyIndex)->AsUInteger());
+        if (layout.valueIndex != kNoField)
+        {
+            change.hasValue = true;
+            change.value = value->GetField(layout.valueIndex)->AsUInteger();
+        }
+        _stateChanges->Notify(_channel, change);
+    }
+
+private:
+    static const size_t kNoField = -1;
+
+    // Index of the fields of a notification. The value field is missing
+    // when the attribute is nulled, so there is a layout per number of
+    // fields.
+    struct Layout
+    {
+        size_t numFields;
+        size_t keyIndex;
+        size_t valueIndex;
+    };
+
+    const Layout& GetLayout(const value::Value* value)
+    {
+        size_t numFields = value->Length();
+        for (const auto& layout : _layouts)
+        {
+            if (layout.numFields == numFields)
+                return layout;
+        }
+
+        Layout layout;
+        layout.numFields = numFields;
+        layout.keyIndex = kNoField;
+        layout.valueIndex = kNoField;
+        for (size_t index = 0; index < numFields; ++index)
+        {
+            const auto& name = value->GetFieldName(index);
+            if (name == kCurrentStateAttributeKeyField)
+                layout.keyIndex = index;
+            else if (name == kCurrentStateAttributeValueField)
+                layout.valueIndex = index;
+        }
+        _layouts.push_back(layout);
+        return _layouts.back();
+    }
+
+    state::StateChanges* _stateChanges;
+    state::StateChanges::Channel _channel;
+    std::vector<Layout> _layouts;
+};
+
+}  // namespace
+
 AbstractBuildBlock::AbstractBuildBlock()
     : _currentState(nullptr),
       _quarks(nullptr),
       _executionsBuilder(nullptr),
       _stacksBuilder(nullptr),
+      _stacksPipeline(nullptr),
       _criticalGraph(nullptr),
       _diskRequests(nullptr),
-      _stateHistory(nullptr)
+      _stateHistory(nullptr),
+      _perfCountersHistory(nullptr),
+      _threadInterest(nullptr),
+      _stateChanges(nullptr),
+      _executionWindows(nullptr)
 {
 }
 
@@ -49,14 +201,129 @@ void AbstractBuildBlock::LoadServices(const block::ServiceList& serviceList)
     serviceList.QueryService(kStacksBuilderServiceName,
                              reinterpret_cast<void**>(&_stacksBuilder));
 
+    serviceList.QueryService(kStacksPipelineServiceName,
+                             reinterpret_cast<void**>(&_stacksPipeline));
+
     serviceList.QueryService(kCriticalGraphServiceName,
                              reinterpret_cast<void**>(&_criticalGraph));
 
     serviceList.QueryService(kStateHistoryServiceName,
                              reinterpret_cast<void**>(&_stateHistory));
 
+    serviceList.QueryService(kPerfCountersHistoryServiceName,
+                             reinterpret_cast<void**>(&_perfCountersHistory));
+
+    serviceList.QueryService(kThreadInterestServiceName,
+                             reinterpret_cast<void**>(&_threadInterest));
+
     serviceList.QueryService(kDiskRequestsServiceName,
                              reinterpret_cast<void**>(&_diskRequests));
+
+    serviceList.QueryService(kExecutionWindowsServiceName,
+                             reinterpret_cast<void**>(&_executionWindows));
+
+    serviceList.QueryService(kStateChangesServiceName,
+                             reinterpret_cast<void**>(&_stateChanges));
+}
+
+void AbstractBuildBlock::AddKernelObserver(
+    notification::NotificationCenter* notificationCenter,
+    const notification::Token& token,
+    const EventObserver& observer)
+{
+    // The observers of an uninstrumented run are registered unwrapped.
+    if (!base::Instrumentation::enabled())
+    {
+        block::AbstractBlock::AddKernelObserver(notificationCenter, token, observer);
+        return;
+    }
+
+    block::AbstractBlock::AddKernelObserver(
+        notificationCenter, token,
+        TimedEventObserver(InstrumentationName() + "/kernel", observer));
+}
+
+void AbstractBuildBlock::AddUstObserver(
+    notification::NotificationCenter* notificationCenter,
+    const notification::Token& token,
+    const EventObserver& observer)
+{
+    if (!base::Instrumentation::enabled())
+    {
+        block::AbstractBlock::AddUstObserver(notificationCenter, token, observer);
+        return;
+    }
+
+    block::AbstractBlock::AddUstObserver(
+        notificationCenter, token,
+        TimedEventObserver(InstrumentationName() + "/ust", observer));
+}
+
+void AbstractBuildBlock::AddThreadStateChangeObserver(
+    notification::NotificationCenter* notificationCenter,
+    const std::string& attribute,
+    const state::StateChanges::Observer& observer)
+{
+    bool isNew = false;
+    auto channel = _stateChanges->GetChannel(kStateThreads, attribute, &isNew);
+    _stateChanges->AddObserver(channel, observer);
+    if (!isNew)
+        return;
+
+    // A single boxed observer feeds all the observers of the attribute.
+    StateChangeAdapter adapter(_stateChanges, channel);
+    AddThreadStateObserver(
+        notificationCenter, notification::Token(attribute),
+        [adapter](uint32_t tid, const notification::Path& path,
+                  const value::Value* value) mutable {
+            adapter.Notify(tid, value);
+        });
+}
+
+void AbstractBuildBlock::AddCpuStateChangeObserver(
+    notification::NotificationCenter* notificationCenter,
+    const std::string& attribute,
+    const state::StateChanges::Observer& observer)
+{
+    bool isNew = false;
+    auto channel = _stateChanges->GetChannel(kStateCpus, attribute, &isNew);
+    _stateChanges->AddObserver(channel, observer);
+    if (!isNew)
+        return;
+
+    notification::Path path {
+        notification::Token(kCurrentStateNotificationPrefix),
+        notification::Token(kStateLinux),
+        notification::Token(kStateCpus),
+        notification::AnyToken(),
+        notification::Token(attribute)};
+    StateChangeAdapter adapter(_stateChanges, channel);
+    notificationCenter->AddObserver(
+        path,
+        [adapter](const notification::Path& path,
+                  const value::Value* value) mutable {
+            adapter.Notify(kInvalidThread, value);
+        });
+}
+
+std::string AbstractBuildBlock::InstrumentationName() const
+{
+    const char* mangled = typeid(*this).name();
+    int status = 0;
+    char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    std::string name(status == 0 ? demangled : mangled);
+    free(demangled);
+
+    // Keep the name of the class, without its namespaces.
+    auto pos = name.rfind("::");
+    if (pos != std::string::npos)
+        name = name.substr(pos + 2);
+    return name;
+}
+
+bool AbstractBuildBlock::InExecutionWindow() const
+{
+    return _executionWindows->Contains(State()->timestamp());
 }
 
 uint32_t AbstractBuildBlock::CpuForEvent(const trace::EventValue& event) const
@@ -74,6 +341,11 @@ thread_t AbstractBuildBlock::ThreadForEvent(const trace::EventValue& event) cons
     return thread;
 }
 
+const char* AbstractBuildBlock::EventNamePointer(const trace::EventValue& event)
+{
+    return InternedName(event.getName());
+}
+
 thread_t AbstractBuildBlock::ProcessForEvent(const trace::EventValue& event) const
 {
     auto process_context_value = event.getStreamEventContext()->GetField("vpid");
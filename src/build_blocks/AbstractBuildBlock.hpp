@@ -21,10 +21,15 @@
 #include "block/AbstractBlock.hpp"
 #include "critical/CriticalGraph.hpp"
 #include "disk/DiskRequests.hpp"
+#include "execution/ExecutionWindows.hpp"
 #include "execution/ExecutionsBuilder.hpp"
+#include "stacks/StackRecord.hpp"
 #include "stacks/StacksBuilder.hpp"
 #include "state/CurrentState.hpp"
+#include "state/PerfCountersHistory.hpp"
+#include "state/StateChanges.hpp"
 #include "state/StateHistory.hpp"
+#include "state/ThreadInterest.hpp"
 
 namespace tibee {
 namespace build_blocks {
@@ -54,15 +59,50 @@ protected:
     // Stacks builder.
     stacks::StacksBuilder* Stacks() const { return _stacksBuilder; }
 
+    // Stage that updates the stacks builder on another thread.
+    stacks::StacksPipeline* StacksPipeline() const { return _stacksPipeline; }
+
     // Critical graph.
     critical::CriticalGraph* CriticalGraph() const { return _criticalGraph; }
 
     // State history.
     state::StateHistory* StateHistory() const { return _stateHistory; }
 
+    // Performance counters history.
+    state::PerfCountersHistory* PerfCountersHistory() const { return _perfCountersHistory; }
+
+    // Interesting threads.
+    state::ThreadInterest* ThreadInterest() const { return _threadInterest; }
+
     // Disk requests.
     disk::DiskRequests* DiskRequests() const { return _diskRequests; }
 
+    // Observe kernel or UST events. When the instrumentation is enabled, the
+    // time spent in the observers of the block is measured for each event
+    // name.
+    typedef std::function<void (const trace::EventValue& event)> EventObserver;
+    void AddKernelObserver(notification::NotificationCenter* notificationCenter,
+                           const notification::Token& token,
+                           const EventObserver& observer);
+    void AddUstObserver(notification::NotificationCenter* notificationCenter,
+                        const notification::Token& token,
+                        const EventObserver& observer);
+
+    // Observe the changes of an integer attribute of the threads or of the
+    // CPUs of the current state, unboxed into plain integers.
+    void AddThreadStateChangeObserver(
+        notification::NotificationCenter* notificationCenter,
+        const std::string& attribute,
+        const state::StateChanges::Observer& observer);
+    void AddCpuStateChangeObserver(
+        notification::NotificationCenter* notificationCenter,
+        const std::string& attribute,
+        const state::StateChanges::Observer& observer);
+
+    // Indicates whether the current timestamp is inside an execution window.
+    // Expensive analyses skip the events that are outside all windows.
+    bool InExecutionWindow() const;
+
     // CPU for an event.
     uint32_t CpuForEvent(const trace::EventValue& event) const;
 
@@ -72,7 +112,14 @@ protected:
     // Process for an event.
     process_t ProcessForEvent(const trace::EventValue& event) const;
 
+    // Name of an event, as interned by the trace reader: the events with
+    // the same name have the same pointer, which identifies their class.
+    static const char* EventNamePointer(const trace::EventValue& event);
+
 private:
+    // Name of the block, used to name the timers of its observers.
+    std::string InstrumentationName() const;
+
     // Current state.
     state::CurrentState* _currentState;
 
@@ -85,6 +132,9 @@ private:
     // Stacks builder.
     stacks::StacksBuilder* _stacksBuilder;
 
+    // Stacks pipeline.
+    stacks::StacksPipeline* _stacksPipeline;
+
     // Critical graph.
     critical::CriticalGraph* _criticalGraph;
 
@@ -93,6 +143,18 @@ private:
 
     // State history.
     state::StateHistory* _stateHistory;
+
+    // Performance counters history.
+    state::PerfCountersHistory* _perfCountersHistory;
+
+    // Interesting threads.
+    state::ThreadInterest* _threadInterest;
+
+    // Typed changes of the current state.
+    state::StateChanges* _stateChanges;
+
+    // Execution windows.
+    execution::ExecutionWindows* _executionWindows;
 };
 
 }  // namespace build_blocks
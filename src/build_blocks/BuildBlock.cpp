@@ -17,6 +17,7 @@
  */
 #include "build_blocks/BuildBlock.hpp"
 
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/uuid/uuid.hpp>
@@ -26,6 +27,7 @@
 #include "base/BindObject.hpp"
 #include "base/CompareConstants.hpp"
 #include "base/Constants.hpp"
+#include "base/Instrumentation.hpp"
 #include "base/print.hpp"
 #include "block/ServiceList.hpp"
 #include "critical/ComputeCriticalPath.hpp"
@@ -50,16 +52,74 @@ using notification::Token;
 // Intervals at which executions are saved (ns).
 const timestamp_t kSaveInterval = 12000000000;  // 12 seconds
 
+// Bounds of the save interval when it adapts to a memory budget (ns).
+const timestamp_t kMinSaveInterval = 1000000000;  // 1 second
+const timestamp_t kMaxSaveInterval = 120000000000;  // 2 minutes
+
+// Intervals at which the memory usage is checked against the budget (ns).
+const timestamp_t kMemoryCheckInterval = 1000000000;  // 1 second
+
+// Intervals at which completed executions are finalized in streaming
+// mode (ns).
+const timestamp_t kFinalizeInterval = 100000000;  // 100 ms
+
+// Time that the trace must pass the end of an execution before it is
+// finalized in streaming mode (ns).
+const timestamp_t kFinalizeMargin = 1000000000;  // 1 second
+
+// Number of stack records that can wait for the stacks pipeline.
+const size_t kStacksPipelineCapacity = 4096;
+
 }  // namespace
 
-BuildBlock::BuildBlock(bool stats)
-    : _quarks(nullptr), _currentState(nullptr), _stats(stats),
-	  _saveTs(0), _lastCleanupTs(0), _numExecutions(0)
+BuildBlock::BuildBlock(db::Database* db, bool stats, bool selectiveHistory,
+                       bool streaming, timestamp_t maxRetention,
+                       size_t memoryBudget,
+                       const execution::ExecutionWindows* executionWindows,
+                       const std::string& traceId,
+                       const std::string& checkpointName,
+                       const std::string& resumeName, bool openEnded)
+    : _db(db), _stackConcatenator(db), _stacksPipeline(kStacksPipelineCapacity), _quarks(nullptr), _currentState(nullptr), _stats(stats),
+      _streaming(streaming), _finalizeTs(0), _finalizedWatermark(0),
+      _checkpointName(checkpointName), _openEnded(openEnded), _ts(0),
+	  _saveTs(0), _lastCleanupTs(0), _saveInterval(kSaveInterval),
+      _memoryBudget(memoryBudget), _memoryCheckTs(0),
+      _maxRetention(std::max(maxRetention, kSaveInterval)),
+      _numExecutions(0), _numPartialExecutions(0)
 {
-    _traceId = boost::lexical_cast<std::string>(
-        boost::uuids::uuid(boost::uuids::random_generator()()));
+    if (_streaming && !_stats)
+    {
+        _workers.reset(new base::WorkerPool(0));
+        _writer.reset(new base::WorkerPool(1));
+    }
 
-    _stacksBuilder.SetDatabase(&_db);
+    _traceId = traceId;
+    if (_traceId.empty())
+    {
+        _traceId = boost::lexical_cast<std::string>(
+            boost::uuids::uuid(boost::uuids::random_generator()()));
+    }
+
+    _stacksBuilder.SetDatabase(_db);
+    _threadInterest.SetSelective(selectiveHistory);
+    if (executionWindows != nullptr)
+    {
+        _executionWindows = *executionWindows;
+
+        // Threads that the first pass found the executions depend on.
+        for (thread_t thread : _executionWindows.threads())
+            _threadInterest.AddThread(thread);
+    }
+
+    // The trace is read from the beginning to rebuild the current state,
+    // but the analyses only resume where the active executions started.
+    if (!resumeName.empty() &&
+        _db->GetCheckpoint(resumeName, &_resumeCheckpoint))
+    {
+        tbinfo() << "Resuming from the checkpoint at "
+                 << _resumeCheckpoint.savedTs << "." << tbendl();
+        _executionWindows.ClipBefore(_resumeCheckpoint.replayTs);
+    }
 }
 
 BuildBlock::~BuildBlock()
@@ -70,9 +130,14 @@ void BuildBlock::RegisterServices(block::ServiceList* serviceList)
 {
     serviceList->AddService(kExecutionsBuilderServiceName, &_executionsBuilder);
     serviceList->AddService(kStacksBuilderServiceName, &_stacksBuilder);
+    serviceList->AddService(kStacksPipelineServiceName, &_stacksPipeline);
     serviceList->AddService(kCriticalGraphServiceName, &_criticalGraph);
     serviceList->AddService(kStateHistoryServiceName, &_stateHistory);
+    serviceList->AddService(kPerfCountersHistoryServiceName, &_perfCountersHistory);
+    serviceList->AddService(kThreadInterestServiceName, &_threadInterest);
     serviceList->AddService(kDiskRequestsServiceName, &_diskRequests);
+    serviceList->AddService(kExecutionWindowsServiceName, &_executionWindows);
+    serviceList->AddService(kStateChangesServiceName, &_stateChanges);
 }
 
 void BuildBlock::LoadServices(const block::ServiceList& serviceList)
@@ -98,33 +163,67 @@ void BuildBlock::onTimestamp(const notification::Path& path, const value::Value*
     if (_stats)
         return;
 
+    TIBEE_COUNTER_ADD("build.timestamps", 1);
+
     auto ts = value->AsULong();
+    _ts = ts;
     _executionsBuilder.SetTimestamp(ts);
-    _stacksBuilder.SetTimestamp(ts);
+    if (!_stacksPipeline.started())
+        _stacksBuilder.SetTimestamp(ts);
     _criticalGraph.SetTimestamp(ts);
     _stateHistory.SetTimestamp(ts);
+    _perfCountersHistory.SetTimestamp(ts);
     _diskRequests.SetTimestamp(ts);
 
     if (_saveTs == 0)
     {
         _saveTs = ts;
+        _finalizeTs = ts;
+        _memoryCheckTs = ts;
+        return;
     }
-    else if (ts > _saveTs + kSaveInterval)
+
+    if (_streaming && ts > _finalizeTs + kFinalizeInterval && ts > kFinalizeMargin)
+    {
+        SyncStacks();
+        FinalizeExecutions(ts - kFinalizeMargin);
+        _finalizeTs = ts;
+        _finalizedWatermark = ts - kFinalizeMargin;
+    }
+
+    // Save early when the memory budget is exceeded.
+    bool overBudget = false;
+    if (_memoryBudget != 0 && ts > _memoryCheckTs + kMemoryCheckInterval &&
+        ts > _saveTs + kMinSaveInterval)
     {
+        SyncStacks();
+        overBudget = ApproximateMemoryUsage() > _memoryBudget;
+        _memoryCheckTs = ts;
+    }
+
+    if (!overBudget && ts <= _saveTs + _saveInterval)
+        return;
+
+    SyncStacks();
+
+    size_t memoryUsage = _memoryBudget != 0 ? ApproximateMemoryUsage() : 0;
+    UpdateMemoryGauges();
+
+    if (!_streaming)
         SaveExecutions();
 
-        // Clean everything that is |kSaveInterval| old.
-        tbinfo() << "Cleaning the history." << tbendl();
-        _stacksBuilder.Cleanup(_saveTs);
-        _criticalGraph.Cleanup(_saveTs);
-        _stateHistory.Cleanup(_saveTs);
-        _diskRequests.Cleanup(_saveTs);
+    // Clean everything that is older than the previous save, except the
+    // history of the executions that are not finalized.
+    timestamp_t cleanupTs = _saveTs;
+    for (const auto& execution : _executionsBuilder)
+        cleanupTs = std::min(cleanupTs, execution->startTs());
+    Cleanup(cleanupTs, ts, memoryUsage);
 
-        tbinfo() << "Continuing to read the trace." << tbendl();
+    WriteCheckpoint(_streaming ? _finalizedWatermark : ts);
 
-        _lastCleanupTs = _saveTs;
-        _saveTs = ts;
-    }
+    if (_memoryBudget != 0)
+        AdaptSaveInterval(memoryUsage, ts - _saveTs);
+    _saveTs = ts;
 }
 
 void BuildBlock::onEnd(const notification::Path& path, const value::Value* value)
@@ -133,12 +232,28 @@ void BuildBlock::onEnd(const notification::Path& path, const value::Value* value
         return;
 
 	tbinfo() << "Completed reading the trace." << tbendl();
+    SyncStacks();
+
+    // The analysis of the next chunk resumes from the last save, to rebuild
+    // the executions that are cut by the end of this chunk.
+    if (_openEnded)
+        WriteCheckpoint(_streaming ? _finalizedWatermark : _saveTs);
+
 	SaveExecutions();
+    if (!_openEnded)
+        WriteCheckpoint(-1);
 	tbinfo() << "A total of " << _numExecutions << " executions were added to the database." << tbendl();
+    if (_numPartialExecutions != 0)
+    {
+        tberror() << _numPartialExecutions << " executions started before the "
+                     "retained history and have a partial critical path." << tbendl();
+    }
 }
 
 void BuildBlock::SaveExecutions()
 {
+    TIBEE_TRACED_SCOPE("build.save-executions");
+
     tbinfo() << "Saving current executions to the database." << tbendl();
 
     // Notify the executions and stacks builder that we reached
@@ -146,33 +261,35 @@ void BuildBlock::SaveExecutions()
     _executionsBuilder.Terminate();
     _stacksBuilder.Terminate();
 
+    if (_streaming)
+    {
+        FinalizeExecutions(-1);
+        _writer->Wait();
+        return;
+    }
+
     // Save all executions in the database.
     for (auto& execution : _executionsBuilder)
     {
-        if (execution->startTs() < _lastCleanupTs) {
-            tberror() << "Skipping an execution because it starts before the last cleanup ts." << tbendl();
-            tberror() << "  Execution start ts: " << execution->startTs() << tbendl();
+        if (IsAlreadySaved(*execution))
             continue;
-        }
+
+        if (execution->startTs() < _lastCleanupTs)
+            ++_numPartialExecutions;
 
         // Compute the critical path of the execution.
         critical::CriticalPath criticalPath;
-        critical::ComputeCriticalPath(
-            _criticalGraph, execution->startTs(), execution->endTs(),
-            execution->startThread(), &criticalPath);
+        ComputeCriticalPath(*execution, &criticalPath);
 
         // Extract the stacks that belong to the execution.
-        execution::ExtractStacks(
-            criticalPath, _stacksBuilder, _criticalGraph, _stateHistory,
-            _diskRequests, _currentState, &_db, execution.get());
+        ExtractStacks(criticalPath, execution.get());
+        execution->FreezeSamples();
 
         // Extract execution metrics.
-        execution::ExtractMetrics(
-            criticalPath, _stateHistory, _currentState, _quarks,
-            execution.get());
+        ExtractMetrics(criticalPath, execution.get());
 
         // Add the execution to the database.
-        _db.AddExecution(*execution);
+        AddExecution(execution.get());
 
         ++_numExecutions;
     }
@@ -181,5 +298,233 @@ void BuildBlock::SaveExecutions()
     _executionsBuilder.Flush();
 }
 
+void BuildBlock::FinalizeExecutions(timestamp_t watermark)
+{
+    TIBEE_TRACED_SCOPE("build.finalize-executions");
+
+    execution::ExecutionsBuilder::Executions executions;
+    _executionsBuilder.TakeCompletedExecutions(watermark, &executions);
+    executions.erase(
+        std::remove_if(executions.begin(), executions.end(),
+                       [&](const execution::Execution::UP& execution) {
+                           return IsAlreadySaved(*execution);
+                       }),
+        executions.end());
+
+    if (executions.empty())
+        return;
+
+    // The histories don't change until this method returns: compute the
+    // critical paths and the metrics of the executions in parallel.
+    std::vector<critical::CriticalPath> criticalPaths(executions.size());
+    for (size_t i = 0; i < executions.size(); ++i)
+    {
+        execution::Execution* execution = executions[i].get();
+        critical::CriticalPath* criticalPath = &criticalPaths[i];
+        if (execution->startTs() < _lastCleanupTs)
+            ++_numPartialExecutions;
+
+        _workers->Post([this, execution, criticalPath] {
+            ComputeCriticalPath(*execution, criticalPath);
+            ExtractMetrics(*criticalPath, execution);
+        });
+    }
+    _workers->Wait();
+
+    for (size_t i = 0; i < executions.size(); ++i)
+    {
+        // Extracting stacks uses the current state, which is only safe
+        // to access from the reader thread.
+        ExtractStacks(criticalPaths[i], executions[i].get());
+
+        // The execution no longer depends on the histories: write it to
+        // the database in the background.
+        std::shared_ptr<execution::Execution> execution(
+            std::move(executions[i]));
+        _writer->Post([this, execution] {
+            execution->FreezeSamples();
+            AddExecution(execution.get());
+        });
+
+        ++_numExecutions;
+    }
+}
+
+void BuildBlock::ComputeCriticalPath(
+    const execution::Execution& execution,
+    critical::CriticalPath* criticalPath) const
+{
+    TIBEE_TRACED_SCOPE("build.critical-path");
+
+    if (execution.startTs() >= _lastCleanupTs)
+    {
+        critical::ComputeCriticalPath(
+            _criticalGraph, execution.startTs(), execution.endTs(),
+            execution.startThread(), criticalPath);
+        return;
+    }
+
+    timestamp_t startTs = std::min(_lastCleanupTs, execution.endTs());
+    critical::ComputeCriticalPath(
+        _criticalGraph, startTs, execution.endTs(),
+        execution.startThread(), criticalPath);
+    criticalPath->insert(
+        criticalPath->begin(),
+        critical::CriticalPathSegment(
+            execution.startTs(), startTs, execution.startThread(),
+            critical::kUnknown));
+}
+
+void BuildBlock::ExtractStacks(const critical::CriticalPath& criticalPath,
+                               execution::Execution* execution) const
+{
+    TIBEE_TRACED_SCOPE("build.extract-stacks");
+    execution::ExtractStacks(
+        criticalPath, _stacksBuilder, _criticalGraph, _stateHistory,
+        _diskRequests, _currentState, _db, &_stackConcatenator, execution);
+}
+
+void BuildBlock::ExtractMetrics(const critical::CriticalPath& criticalPath,
+                                execution::Execution* execution) const
+{
+    TIBEE_TRACED_SCOPE("build.extract-metrics");
+    execution::ExtractMetrics(criticalPath, _perfCountersHistory, execution);
+}
+
+void BuildBlock::AddExecution(execution::Execution* execution)
+{
+    TIBEE_TRACED_SCOPE("build.database-write");
+    execution->set_trace(_traceId);
+    _db->AddExecution(*execution);
+}
+
+void BuildBlock::SyncStacks()
+{
+    if (!_stacksPipeline.started())
+        return;
+
+    TIBEE_TRACED_SCOPE("build.sync-stacks");
+
+    _stacksPipeline.Drain();
+    _stacksBuilder.SetTimestamp(_ts);
+}
+
+size_t BuildBlock::ApproximateMemoryUsage() const
+{
+    return _executionsBuilder.ApproximateMemoryUsage() +
+           _stacksBuilder.ApproximateMemoryUsage() +
+           _criticalGraph.ApproximateMemoryUsage() +
+           _diskRequests.ApproximateMemoryUsage() +
+           _stateHistory.ApproximateMemoryUsage() +
+           _perfCountersHistory.ApproximateMemoryUsage();
+}
+
+void BuildBlock::UpdateMemoryGauges() const
+{
+    if (!base::Instrumentation::enabled())
+        return;
+
+    // With concurrent pipelines, the gauges show the last pipeline that saved.
+    TIBEE_GAUGE_SET("memory.executions", _executionsBuilder.ApproximateMemoryUsage());
+    TIBEE_GAUGE_SET("memory.stacks", _stacksBuilder.ApproximateMemoryUsage());
+    TIBEE_GAUGE_SET("memory.critical-graph", _criticalGraph.ApproximateMemoryUsage());
+    TIBEE_GAUGE_SET("memory.disk-requests", _diskRequests.ApproximateMemoryUsage());
+    TIBEE_GAUGE_SET("memory.state-history", _stateHistory.ApproximateMemoryUsage());
+    TIBEE_GAUGE_SET("memory.perf-counters", _perfCountersHistory.ApproximateMemoryUsage());
+}
+
+void BuildBlock::WriteCheckpoint(timestamp_t savedTs)
+{
+    if (_checkpointName.empty())
+        return;
+
+    // The executions that are still active or not finalized must be
+    // rebuilt from their start by a resumed run.
+    db::Checkpoint checkpoint;
+    checkpoint.savedTs = savedTs;
+    checkpoint.replayTs = savedTs;
+    timestamp_t oldestStartTs = 0;
+    if (savedTs != static_cast<timestamp_t>(-1) &&
+        _executionsBuilder.GetOldestActiveStartTs(&oldestStartTs))
+    {
+        checkpoint.replayTs = std::min(checkpoint.replayTs, oldestStartTs);
+    }
+    for (const auto& execution : _executionsBuilder)
+        checkpoint.replayTs = std::min(checkpoint.replayTs, execution->startTs());
+
+    // Never move the checkpoint back before the one the run resumed from.
+    if (checkpoint.savedTs < _resumeCheckpoint.savedTs)
+        checkpoint = _resumeCheckpoint;
+
+    if (_streaming && savedTs != static_cast<timestamp_t>(-1))
+    {
+        auto* db = _db;
+        const auto& name = _checkpointName;
+        _writer->Post([db, name, checkpoint] {
+            db->SetCheckpoint(name, checkpoint);
+        });
+        return;
+    }
+    _db->SetCheckpoint(_checkpointName, checkpoint);
+}
+
+bool BuildBlock::IsAlreadySaved(const execution::Execution& execution) const
+{
+    return execution.endTs() <= _resumeCheckpoint.savedTs;
+}
+
+void BuildBlock::AdaptSaveInterval(size_t memoryUsage, timestamp_t elapsed)
+{
+    // The history covers up to two save intervals: aim for a usage between
+    // a quarter and half of the budget at the time of a save.
+    if (memoryUsage > _memoryBudget / 2)
+        _saveInterval = std::max(kMinSaveInterval, elapsed / 2);
+    else if (memoryUsage < _memoryBudget / 4)
+        _saveInterval = std::min(kMaxSaveInterval, _saveInterval * 2);
+
+    tbinfo() << "Memory usage: " << memoryUsage / (1024 * 1024) << " MB, "
+             << "next save in " << _saveInterval / 1000000 << " ms." << tbendl();
+}
+
+void BuildBlock::Cleanup(timestamp_t ts, timestamp_t now, size_t memoryUsage)
+{
+    // Keep the history of the active executions, unless it is too old or,
+    // with a memory budget, too big.
+    timestamp_t oldestActiveTs = 0;
+    if (_executionsBuilder.GetOldestActiveStartTs(&oldestActiveTs) &&
+        oldestActiveTs < ts)
+    {
+        timestamp_t keepTs = oldestActiveTs;
+        if (_memoryBudget == 0)
+        {
+            timestamp_t minTs = now > _maxRetention ? now - _maxRetention : 0;
+            keepTs = std::max(oldestActiveTs, minTs);
+        }
+        else if (memoryUsage > _memoryBudget)
+        {
+            // Halve the history kept for the active executions at each save
+            // until it fits: the oldest executions are saved partially.
+            timestamp_t fromTs = std::max(oldestActiveTs, _lastCleanupTs);
+            keepTs = fromTs + (ts - fromTs) / 2;
+        }
+        ts = std::min(ts, keepTs);
+    }
+    if (ts <= _lastCleanupTs)
+        return;
+
+    TIBEE_TRACED_SCOPE("build.cleanup");
+
+    tbinfo() << "Cleaning the history." << tbendl();
+    _stacksBuilder.Cleanup(ts);
+    _criticalGraph.Cleanup(ts);
+    _stateHistory.Cleanup(ts);
+    _perfCountersHistory.Cleanup(ts);
+    _diskRequests.Cleanup(ts);
+
+    tbinfo() << "Continuing to read the trace." << tbendl();
+
+    _lastCleanupTs = ts;
+}
+
 }  // namespace build_blocks
 }  // namespace tibee
@@ -18,18 +18,27 @@
 #ifndef _TIBEE_BUILDBLOCKS_BUILDBLOCK_HPP
 #define _TIBEE_BUILDBLOCKS_BUILDBLOCK_HPP
 
+#include <memory>
 #include <string>
 
+#include "base/WorkerPool.hpp"
 #include "block/AbstractBlock.hpp"
 #include "critical/CriticalGraph.hpp"
+#include "critical/CriticalPath.hpp"
 #include "db/Database.hpp"
 #include "disk/DiskRequests.hpp"
+#include "execution/ExecutionWindows.hpp"
 #include "execution/ExecutionsBuilder.hpp"
+#include "execution/StackConcatenator.hpp"
 #include "notification/Path.hpp"
 #include "quark/StringQuarkDatabase.hpp"
+#include "stacks/StackRecord.hpp"
 #include "stacks/StacksBuilder.hpp"
 #include "state/CurrentState.hpp"
+#include "state/PerfCountersHistory.hpp"
+#include "state/StateChanges.hpp"
 #include "state/StateHistory.hpp"
+#include "state/ThreadInterest.hpp"
 
 namespace tibee {
 namespace build_blocks {
@@ -37,7 +46,30 @@ namespace build_blocks {
 class BuildBlock : public block::AbstractBlock
 {
 public:
-    BuildBlock(bool stats);
+    // @param db Database in which executions are saved. Can be shared by
+    //     the blocks that analyze different traces concurrently.
+    // @param maxRetention Maximum age of the history kept for the active
+    //     executions (ns), when there is no memory budget.
+    // @param memoryBudget Memory that the histories should not exceed
+    //     (bytes), or 0 to save executions at fixed intervals.
+    // @param executionWindows Windows found by a first pass over the trace,
+    //     or nullptr to analyze the whole trace.
+    // @param traceId Identifier of the analyzed traces, recorded with the
+    //     executions. A random identifier is used when it is empty.
+    // @param checkpointName Name under which checkpoints are written each
+    //     time executions are saved, or an empty string for no checkpoints.
+    // @param resumeName Name of the checkpoint to restart from, or an empty
+    //     string to analyze the whole trace. The analyses skip the events
+    //     that precede the checkpoint and the executions that were already
+    //     saved are not saved again.
+    // @param openEnded Indicates that the trace continues in a next chunk.
+    //     The executions that are active at the end are not complete, so the
+    //     last checkpoint allows an analysis of the next chunk to rebuild them.
+    BuildBlock(db::Database* db, bool stats, bool selectiveHistory,
+               bool streaming, timestamp_t maxRetention, size_t memoryBudget,
+               const execution::ExecutionWindows* executionWindows,
+               const std::string& traceId, const std::string& checkpointName,
+               const std::string& resumeName, bool openEnded);
     ~BuildBlock();
 
 private:
@@ -50,8 +82,54 @@ private:
 
     void SaveExecutions();
 
+    // Saves the completed executions that end before |watermark|. The
+    // critical paths and metrics are computed on the workers while the
+    // reader waits, and the executions are written to the database in the
+    // background.
+    void FinalizeExecutions(timestamp_t watermark);
+
+    // Computes the critical path of an execution. The part of the execution
+    // that precedes the last cleanup is reported as an unknown segment.
+    void ComputeCriticalPath(const execution::Execution& execution,
+                             critical::CriticalPath* criticalPath) const;
+
+    // Steps of the save of an execution, timed separately.
+    void ExtractStacks(const critical::CriticalPath& criticalPath,
+                       execution::Execution* execution) const;
+    void ExtractMetrics(const critical::CriticalPath& criticalPath,
+                        execution::Execution* execution) const;
+    void AddExecution(execution::Execution* execution);
+
+    // Waits until the stacks pipeline is idle, so that the stacks builder
+    // can be used from the reader thread.
+    void SyncStacks();
+
+    // Approximate number of bytes used by the histories and executions.
+    size_t ApproximateMemoryUsage() const;
+
+    // Publishes the memory usage of each structure to the instrumentation.
+    void UpdateMemoryGauges() const;
+
+    // Adapts the save interval to the memory usage measured |elapsed| ns
+    // after the previous save.
+    void AdaptSaveInterval(size_t memoryUsage, timestamp_t elapsed);
+
+    // Writes a checkpoint after the executions that end at or before
+    // |savedTs| were saved. In streaming mode, the checkpoint is written
+    // after the pending executions.
+    void WriteCheckpoint(timestamp_t savedTs);
+
+    // Indicates whether an execution was saved before the run resumed.
+    bool IsAlreadySaved(const execution::Execution& execution) const;
+
+    // Cleans the histories before |ts|, or before the start of the oldest
+    // active execution if it is older. Without a memory budget, the history
+    // of the active executions is kept within |_maxRetention| of |now|.
+    // Otherwise, it is kept while |memoryUsage| is within the budget.
+    void Cleanup(timestamp_t ts, timestamp_t now, size_t memoryUsage);
+
     // Database.
-    db::Database _db;
+    db::Database* _db;
 
     // The executions builder.
     execution::ExecutionsBuilder _executionsBuilder;
@@ -59,6 +137,13 @@ private:
     // The stacks builder.
     stacks::StacksBuilder _stacksBuilder;
 
+    // Concatenates the stacks of the executions. Only used from the reader
+    // thread.
+    mutable execution::StackConcatenator _stackConcatenator;
+
+    // Updates the stacks builder on another thread, when started.
+    stacks::StacksPipeline _stacksPipeline;
+
     // The critical graph.
     critical::CriticalGraph _criticalGraph;
 
@@ -68,6 +153,18 @@ private:
     // The state history.
     state::StateHistory _stateHistory;
 
+    // The performance counters history.
+    state::PerfCountersHistory _perfCountersHistory;
+
+    // The interesting threads.
+    state::ThreadInterest _threadInterest;
+
+    // The execution windows.
+    execution::ExecutionWindows _executionWindows;
+
+    // The typed changes of the current state.
+    state::StateChanges _stateChanges;
+
     // The quarks database.
     quark::StringQuarkDatabase* _quarks;
 
@@ -80,14 +177,58 @@ private:
     // Indicates that we are just showing stats.
     bool _stats;
 
+    // Indicates that executions are saved as soon as the trace passes
+    // their end, rather than at fixed intervals.
+    bool _streaming;
+
+    // Workers that analyze executions in streaming mode.
+    std::unique_ptr<base::WorkerPool> _workers;
+
+    // Worker that writes executions to the database in streaming mode.
+    std::unique_ptr<base::WorkerPool> _writer;
+
+    // Last timestamp at which executions were finalized in streaming mode.
+    timestamp_t _finalizeTs;
+
+    // Watermark of the last finalization in streaming mode.
+    timestamp_t _finalizedWatermark;
+
+    // Name of the checkpoints, or empty for no checkpoints.
+    std::string _checkpointName;
+
+    // Checkpoint from which the run resumed.
+    db::Checkpoint _resumeCheckpoint;
+
+    // Indicates that the trace continues in a next chunk.
+    bool _openEnded;
+
+    // Current timestamp.
+    timestamp_t _ts;
+
     // Last timestamp at which executions were saved.
     timestamp_t _saveTs;
 
     // Timestamp of the last cleanup.
     timestamp_t _lastCleanupTs;
 
+    // Interval at which executions are saved.
+    timestamp_t _saveInterval;
+
+    // Memory budget (bytes), or 0 to save at fixed intervals.
+    size_t _memoryBudget;
+
+    // Last timestamp at which the memory usage was checked.
+    timestamp_t _memoryCheckTs;
+
+    // Maximum age of the history kept for the active executions, when
+    // there is no memory budget.
+    timestamp_t _maxRetention;
+
     // Number of executions.
     size_t _numExecutions;
+
+    // Number of executions whose beginning was cleaned before they were saved.
+    size_t _numPartialExecutions;
 };
 
 }  // namespace build_blocks
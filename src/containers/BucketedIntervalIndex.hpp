@@ -0,0 +1,245 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_CONTAINERS_BUCKETEDINTERVALINDEX_HPP
+#define _TIBEE_CONTAINERS_BUCKETEDINTERVALINDEX_HPP
+
+#include <algorithm>
+#include <assert.h>
+#include <boost/utility.hpp>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+#include "containers/Interval.hpp"
+
+namespace tibee {
+namespace containers {
+
+// Index of intervals bucketed by their lower bound.
+// Each bucket covers a fixed range of lower bounds and keeps its elements in
+// a contiguous array sorted by lower bound, and by decreasing higher bound
+// for equal lower bounds. The maximum higher bound of each bucket allows
+// queries to skip it and cleanups to drop it without looking at its elements.
+// Only the buckets that contain elements exist, so gaps in time cost nothing.
+// @tparam T the type of the value associated with each interval.
+template <typename T>
+class BucketedIntervalIndex : boost::noncopyable {
+ public:
+  typedef std::pair<Interval, T> ElementPair;
+
+  // Constructor.
+  // @param bucket_width Range of lower bounds covered by a bucket.
+  explicit BucketedIntervalIndex(uint64_t bucket_width);
+
+  // Destructor.
+  ~BucketedIntervalIndex();
+
+  // Insert an element in the index.
+  // @param interval Interval of the element to insert.
+  // @param value Value of the element to insert.
+  void Insert(const Interval& interval, const T& value);
+
+  // Enumerate all the intervals that intersect with
+  // [interval.low(), interval.high()]. The elements are ordered by their
+  // lower bound. When many elements have the same lower bound, they are
+  // ordered from the longest to the shortest.
+  // @param interval Interval from which the intersection is searched.
+  // @param visitor Receives the found elements as const ElementPair&.
+  template <typename Visitor>
+  void EnumerateIntersection(const Interval& interval,
+                             Visitor&& visitor) const;
+
+  // Removes the buckets in which all intervals end before |ts|, wherever
+  // they are: a long interval in an old bucket doesn't keep the expired
+  // buckets that follow it. The remaining intervals include all the
+  // intervals that end at or after |ts|. The cost is proportional to the
+  // number of removed buckets, not to the number of buckets in the index.
+  // @param ts The cleanup timestamp.
+  void RemoveEndingBefore(uint64_t ts);
+
+  // @returns the number of elements in the index.
+  size_t size() const {
+    return size_;
+  }
+
+  // @returns the number of buckets in the index.
+  size_t num_buckets() const {
+    return buckets_.size();
+  }
+
+  // @returns the approximate number of bytes used by the index.
+  size_t ApproximateMemoryUsage() const;
+
+ private:
+  // Predicate to sort elements by lower bound, then by decreasing
+  // higher bound.
+  struct ElementsSortPredicate {
+    bool operator()(const ElementPair& left,
+                    const ElementPair& right) const {
+      if (left.first.low() != right.first.low())
+        return left.first.low() < right.first.low();
+      return left.first.high() > right.first.high();
+    }
+  };
+
+  struct Bucket {
+    Bucket() : max_high(0) {}
+
+    // Elements whose lower bound is in the range of the bucket.
+    std::vector<ElementPair> elements;
+
+    // Maximum higher bound of the elements of the bucket.
+    uint64_t max_high;
+  };
+
+  // Buckets, by index (lower bound / bucket width).
+  typedef std::map<uint64_t, Bucket> Buckets;
+  Buckets buckets_;
+
+  // Expiry of a bucket: (maximum higher bound, bucket index). The maximum
+  // higher bound is the one known when the entry was pushed; it is refreshed
+  // when the entry reaches the top of the queue during a cleanup.
+  typedef std::pair<uint64_t, uint64_t> Expiry;
+
+  // One expiry per bucket, the earliest on top.
+  std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>
+      expiries_;
+
+  // Range of lower bounds covered by a bucket.
+  uint64_t bucket_width_;
+
+  // Maximum length of an interval in the index.
+  uint64_t max_length_;
+
+  // Number of elements in the index.
+  size_t size_;
+};
+
+template<typename T>
+BucketedIntervalIndex<T>::BucketedIntervalIndex(uint64_t bucket_width)
+    : bucket_width_(bucket_width), max_length_(0), size_(0) {
+  assert(bucket_width_ != 0);
+}
+
+template<typename T>
+BucketedIntervalIndex<T>::~BucketedIntervalIndex() {
+}
+
+template<typename T>
+void BucketedIntervalIndex<T>::Insert(const Interval& interval,
+                                      const T& value) {
+  uint64_t bucket_index = interval.low() / bucket_width_;
+
+  // Intervals are usually inserted in the last bucket.
+  typename Buckets::iterator bucket_it = buckets_.end();
+  if (!buckets_.empty() && std::prev(bucket_it)->first == bucket_index)
+    --bucket_it;
+  else
+    bucket_it = buckets_.find(bucket_index);
+
+  if (bucket_it == buckets_.end()) {
+    bucket_it = buckets_.insert(
+        std::make_pair(bucket_index, Bucket())).first;
+    expiries_.push(Expiry(interval.high(), bucket_index));
+  }
+
+  Bucket& bucket = bucket_it->second;
+  ElementPair element(interval, value);
+
+  // Intervals are usually inserted by increasing lower bound.
+  if (bucket.elements.empty() ||
+      !ElementsSortPredicate()(element, bucket.elements.back())) {
+    bucket.elements.push_back(element);
+  } else {
+    auto it = std::upper_bound(bucket.elements.begin(), bucket.elements.end(),
+                               element, ElementsSortPredicate());
+    bucket.elements.insert(it, element);
+  }
+
+  bucket.max_high = std::max(bucket.max_high, interval.high());
+  max_length_ = std::max(max_length_, interval.high() - interval.low());
+  ++size_;
+}
+
+template<typename T>
+template<typename Visitor>
+void BucketedIntervalIndex<T>::EnumerateIntersection(
+    const Interval& interval,
+    Visitor&& visitor) const {
+  // Buckets before the one that contains |interval.low() - max_length_|
+  // only contain elements that end before the search interval.
+  uint64_t min_low = interval.low() > max_length_ ?
+      interval.low() - max_length_ : 0;
+  auto it = buckets_.lower_bound(min_low / bucket_width_);
+
+  // Buckets after the one that contains the higher bound of the search
+  // interval only contain elements that start after it.
+  auto end = buckets_.upper_bound(interval.high() / bucket_width_);
+
+  for (; it != end; ++it) {
+    const Bucket& bucket = it->second;
+    if (bucket.max_high < interval.low())
+      continue;
+
+    for (const ElementPair& element : bucket.elements) {
+      if (element.first.low() > interval.high())
+        return;
+      if (element.first.high() >= interval.low())
+        visitor(element);
+    }
+  }
+}
+
+template<typename T>
+size_t BucketedIntervalIndex<T>::ApproximateMemoryUsage() const {
+  size_t usage = 0;
+  for (const auto& bucket : buckets_) {
+    usage += sizeof(typename Buckets::value_type) + sizeof(Expiry) +
+        bucket.second.elements.capacity() * sizeof(ElementPair);
+  }
+  return usage;
+}
+
+template<typename T>
+void BucketedIntervalIndex<T>::RemoveEndingBefore(uint64_t ts) {
+  while (!expiries_.empty() && expiries_.top().first < ts) {
+    uint64_t bucket_index = expiries_.top().second;
+    expiries_.pop();
+
+    auto it = buckets_.find(bucket_index);
+    assert(it != buckets_.end());
+
+    // Intervals inserted since the expiry was pushed may keep the bucket.
+    if (it->second.max_high >= ts) {
+      expiries_.push(Expiry(it->second.max_high, bucket_index));
+      continue;
+    }
+
+    size_ -= it->second.elements.size();
+    buckets_.erase(it);
+  }
+}
+
+}  // namespace containers
+}  // namespace tibee
+
+#endif  // _TIBEE_CONTAINERS_BUCKETEDINTERVALINDEX_HPP
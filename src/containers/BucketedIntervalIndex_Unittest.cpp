@@ -0,0 +1,234 @@
+/* Copyright (c) 2014 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "containers/BucketedIntervalIndex.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace tibee {
+namespace containers {
+
+namespace {
+
+class MockObserver {
+ public:
+  void ObserveElement(const BucketedIntervalIndex<int>::ElementPair& pair) {
+    ObserveElementMock(pair.first, pair.second);
+  }
+
+  MOCK_METHOD2(ObserveElementMock, void(const Interval&, const int&));
+};
+
+}  // namespace
+
+TEST(BucketedIntervalIndexTest, Size) {
+  BucketedIntervalIndex<int> index(10);
+  EXPECT_EQ(0u, index.size());
+
+  index.Insert(Interval(0, 10), 1);
+  EXPECT_EQ(1u, index.size());
+
+  index.Insert(Interval(0, 10), 2);
+  EXPECT_EQ(2u, index.size());
+
+  index.Insert(Interval(15, 25), 3);
+  EXPECT_EQ(3u, index.size());
+  EXPECT_EQ(2u, index.num_buckets());
+}
+
+TEST(BucketedIntervalIndexTest, EnumerateIntersection) {
+  BucketedIntervalIndex<int> index(15);
+  MockObserver observer;
+  auto visitor = [&](const BucketedIntervalIndex<int>::ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  // Insert out of order, across buckets.
+  index.Insert(Interval(10, 20), 2);
+  index.Insert(Interval(0, 10), 1);
+  index.Insert(Interval(40, 50), 4);
+  index.Insert(Interval(20, 30), 3);
+  index.Insert(Interval(0, 50), 5);
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 10), 1));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(10, 20), 2));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(20, 30), 3));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(40, 50), 4));
+
+    index.EnumerateIntersection(Interval(0, 50), visitor);
+  }
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 10), 1));
+
+    index.EnumerateIntersection(Interval(0, 0), visitor);
+  }
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(20, 30), 3));
+
+    index.EnumerateIntersection(Interval(25, 35), visitor);
+  }
+
+  {
+    EXPECT_CALL(observer, ObserveElementMock(Interval(40, 50), 4));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+
+    index.EnumerateIntersection(Interval(50, 100), visitor);
+  }
+
+  index.EnumerateIntersection(Interval(51, 100), visitor);
+}
+
+TEST(BucketedIntervalIndexTest, RemoveEndingBefore) {
+  BucketedIntervalIndex<int> index(10);
+  MockObserver observer;
+  auto visitor = [&](const BucketedIntervalIndex<int>::ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  index.Insert(Interval(0, 5), 1);
+  index.Insert(Interval(10, 15), 2);
+  index.Insert(Interval(12, 40), 3);
+  index.Insert(Interval(20, 25), 4);
+  index.Insert(Interval(30, 35), 5);
+
+  // The second bucket is kept because of [12, 40]. The third bucket is
+  // removed, even if it is between two live buckets.
+  index.RemoveEndingBefore(30);
+  EXPECT_EQ(3u, index.size());
+  EXPECT_EQ(2u, index.num_buckets());
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(12, 40), 3));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(30, 35), 5));
+
+    index.EnumerateIntersection(Interval(30, 100), visitor);
+  }
+
+  index.RemoveEndingBefore(41);
+  EXPECT_EQ(0u, index.size());
+  EXPECT_EQ(0u, index.num_buckets());
+
+  // Insert before the first bucket after a cleanup.
+  index.Insert(Interval(50, 60), 6);
+  index.Insert(Interval(5, 55), 7);
+  EXPECT_EQ(2u, index.size());
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(5, 55), 7));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(50, 60), 6));
+
+    index.EnumerateIntersection(Interval(52, 53), visitor);
+  }
+}
+
+TEST(BucketedIntervalIndexTest, RemoveEndingBeforeBehindLongInterval) {
+  BucketedIntervalIndex<int> index(10);
+  MockObserver observer;
+  auto visitor = [&](const BucketedIntervalIndex<int>::ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  index.Insert(Interval(0, 1000), 1);
+  for (int i = 1; i < 10; ++i)
+    index.Insert(Interval(i * 10, i * 10 + 5), i + 1);
+  index.Insert(Interval(100, 200), 11);
+  size_t usage = index.ApproximateMemoryUsage();
+
+  // Only the long interval of the first bucket and the last interval
+  // survive.
+  index.RemoveEndingBefore(150);
+  EXPECT_EQ(2u, index.size());
+  EXPECT_LT(index.ApproximateMemoryUsage(), usage);
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 1000), 1));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(100, 200), 11));
+
+    index.EnumerateIntersection(Interval(0, 1000), visitor);
+  }
+
+  // New intervals can still be inserted in a released bucket.
+  index.Insert(Interval(55, 160), 12);
+  EXPECT_EQ(3u, index.size());
+  EXPECT_CALL(observer, ObserveElementMock(Interval(0, 1000), 1));
+  EXPECT_CALL(observer, ObserveElementMock(Interval(55, 160), 12));
+  index.EnumerateIntersection(Interval(56, 60), visitor);
+}
+
+TEST(BucketedIntervalIndexTest, SparseBuckets) {
+  BucketedIntervalIndex<int> index(10);
+  MockObserver observer;
+  auto visitor = [&](const BucketedIntervalIndex<int>::ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  // A large gap between two intervals doesn't create empty buckets.
+  index.Insert(Interval(0, 5), 1);
+  index.Insert(Interval(1000000000000, 1000000000005), 2);
+  index.Insert(Interval(500, 505), 3);
+  EXPECT_EQ(3u, index.num_buckets());
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(500, 505), 3));
+    EXPECT_CALL(observer, ObserveElementMock(
+        Interval(1000000000000, 1000000000005), 2));
+
+    index.EnumerateIntersection(Interval(6, 1000000000003), visitor);
+  }
+
+  // A bucket whose intervals were extended after its creation is kept.
+  index.Insert(Interval(1, 600), 4);
+  index.RemoveEndingBefore(550);
+  EXPECT_EQ(3u, index.size());
+  EXPECT_EQ(2u, index.num_buckets());
+
+  index.RemoveEndingBefore(1000000000006);
+  EXPECT_EQ(0u, index.size());
+  EXPECT_EQ(0u, index.num_buckets());
+}
+
+TEST(BucketedIntervalIndexTest, ApproximateMemoryUsage) {
+  BucketedIntervalIndex<int> index(10);
+  EXPECT_EQ(0u, index.ApproximateMemoryUsage());
+
+  for (int i = 0; i < 100; ++i)
+    index.Insert(Interval(i, i + 5), i);
+  size_t usage = index.ApproximateMemoryUsage();
+  EXPECT_GE(usage, 100 * sizeof(BucketedIntervalIndex<int>::ElementPair));
+
+  index.RemoveEndingBefore(60);
+  EXPECT_LT(index.ApproximateMemoryUsage(), usage);
+
+  index.RemoveEndingBefore(1000);
+  EXPECT_EQ(0u, index.ApproximateMemoryUsage());
+}
+
+}  // namespace containers
+}  // namespace tibee
@@ -0,0 +1,677 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_CONTAINERS_POOLEDINTERVALTREE_HPP
+#define _TIBEE_CONTAINERS_POOLEDINTERVALTREE_HPP
+
+#include <algorithm>
+#include <assert.h>
+#include <boost/utility.hpp>
+#include <iterator>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "containers/Interval.hpp"
+
+namespace tibee {
+namespace containers {
+
+// Implementation of a left-leaning red-black interval tree whose nodes are
+// allocated from a pool.
+// Each node contains a single element. Nodes are ordered by the lower bound
+// of their interval, then from the longest to the shortest interval, then by
+// insertion order. Nodes are referenced by their index in the pool, and the
+// nodes of erased elements are reused by the next insertions.
+// @tparam T the type of the value associated with each interval.
+template <typename T>
+class PooledIntervalTree : boost::noncopyable {
+ public:
+  typedef std::pair<Interval, T> ElementPair;
+
+ private:
+  typedef uint32_t NodeIndex;
+  static const NodeIndex kNil = static_cast<NodeIndex>(-1);
+
+ public:
+  // Iterator over the elements of the tree, in order.
+  class const_iterator
+      : public std::iterator<std::forward_iterator_tag, const ElementPair> {
+   public:
+    const_iterator() : tree_(NULL) {}
+
+    const ElementPair& operator*() const {
+      return tree_->nodes_[stack_.back()].element;
+    }
+    const ElementPair* operator->() const {
+      return &tree_->nodes_[stack_.back()].element;
+    }
+
+    const_iterator& operator++() {
+      NodeIndex node = tree_->nodes_[stack_.back()].right;
+      stack_.pop_back();
+      PushLeft(node);
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return stack_ == other.stack_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class PooledIntervalTree;
+
+    const_iterator(const PooledIntervalTree* tree, NodeIndex root)
+        : tree_(tree) {
+      PushLeft(root);
+    }
+
+    void PushLeft(NodeIndex node) {
+      while (node != kNil) {
+        stack_.push_back(node);
+        node = tree_->nodes_[node].left;
+      }
+    }
+
+    const PooledIntervalTree* tree_;
+
+    // Path from the root to the current node, excluding the nodes whose
+    // elements have already been visited.
+    std::vector<NodeIndex> stack_;
+  };
+
+  // Constructor.
+  PooledIntervalTree();
+
+  // Destructor.
+  ~PooledIntervalTree();
+
+  // Insert an element in the tree.
+  // @param interval Interval of the element to insert.
+  // @param value Value of the element to insert.
+  void Insert(const Interval& interval, const T& value);
+
+  // Replace the content of the tree with elements sorted by their lower
+  // bound, and from the longest to the shortest interval for equal lower
+  // bounds. Runs in linear time.
+  // @param elements The sorted elements.
+  void BuildFromSorted(const std::vector<ElementPair>& elements);
+
+  // Erase an element from the tree.
+  // @param interval Interval of the element to erase.
+  // @param value Value of the element to erase.
+  // @returns true if an element was erased.
+  bool Erase(const Interval& interval, const T& value);
+
+  // Erase all the elements whose interval is contained in
+  // [interval.low(), interval.high()].
+  // @param interval The range of the elements to erase.
+  // @returns the number of erased elements.
+  size_t EraseRange(const Interval& interval);
+
+  // Remove all the elements from the tree.
+  void Clear();
+
+  // Enumerate all the intervals that intersect with
+  // [interval.low(), interval.high()]. The elements are ordered by their
+  // lower bound. When many elements have the same lower bound, they are
+  // ordered from the longest to the shortest.
+  // @param interval Interval from which the intersection is searched.
+  // @param visitor Receives the found elements as const ElementPair&.
+  template <typename Visitor>
+  void EnumerateIntersection(const Interval& interval,
+                             Visitor&& visitor) const;
+
+  // @returns an iterator to the first element of the tree.
+  const_iterator begin() const {
+    return const_iterator(this, root_);
+  }
+
+  // @returns an iterator past the last element of the tree.
+  const_iterator end() const {
+    return const_iterator(this, kNil);
+  }
+
+  // @returns the number of elements in the tree.
+  size_t size() const {
+    return size_;
+  }
+
+ private:
+  typedef bool Color;
+  static const Color kRed = true;
+  static const Color kBlack = false;
+
+  // Key of a node: lower bound, higher bound (reversed) and insertion order.
+  struct Key {
+    Key(uint64_t low, uint64_t high, uint64_t sequence)
+        : low(low), high(high), sequence(sequence) {}
+    bool operator<(const Key& other) const {
+      if (low != other.low)
+        return low < other.low;
+      if (high != other.high)
+        return high > other.high;
+      return sequence < other.sequence;
+    }
+    bool operator==(const Key& other) const {
+      return low == other.low && high == other.high &&
+             sequence == other.sequence;
+    }
+    uint64_t low;
+    uint64_t high;
+    uint64_t sequence;
+  };
+
+  struct Node {
+    Key key() const {
+      return Key(element.first.low(), element.first.high(), sequence);
+    }
+
+    ElementPair element;
+
+    // Insertion order of the element, to distinguish equal intervals.
+    uint64_t sequence;
+
+    // Maximum higher bound of the elements in this node and its children.
+    uint64_t subtree_max_high;
+
+    NodeIndex left;
+    NodeIndex right;
+    Color color;
+  };
+
+  NodeIndex NewNode(const ElementPair& element, Color color);
+  void FreeNode(NodeIndex node);
+
+  NodeIndex InsertInternal(NodeIndex h, const ElementPair& element);
+  NodeIndex BuildInternal(const std::vector<ElementPair>& elements,
+                          size_t num_elements, size_t height,
+                          size_t* position);
+  NodeIndex EraseInternal(NodeIndex h, const Key& key);
+  NodeIndex EraseMin(NodeIndex h);
+  bool FindKey(NodeIndex h, const Interval& interval, const T& value,
+               Key* key) const;
+  void CollectContained(NodeIndex h, const Interval& interval,
+                        std::vector<Key>* keys) const;
+
+  template <typename Visitor>
+  void EnumerateIntersectionInternal(NodeIndex h, const Interval& interval,
+                                     Visitor& visitor) const;
+
+  NodeIndex RotateLeft(NodeIndex h);
+  NodeIndex RotateRight(NodeIndex h);
+  void FlipColors(NodeIndex h);
+  NodeIndex MoveRedLeft(NodeIndex h);
+  NodeIndex MoveRedRight(NodeIndex h);
+  NodeIndex Balance(NodeIndex h);
+  void Update(NodeIndex h);
+  bool IsRed(NodeIndex node) const {
+    return node != kNil && nodes_[node].color == kRed;
+  }
+
+  // Pool of nodes.
+  std::vector<Node> nodes_;
+
+  // Nodes of the pool that are not used.
+  std::vector<NodeIndex> free_nodes_;
+
+  // Root of the interval tree.
+  NodeIndex root_;
+
+  // Number of elements in the tree.
+  size_t size_;
+
+  // Insertion order of the next element.
+  uint64_t next_sequence_;
+};
+
+template<typename T>
+const typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::kNil;
+
+template<typename T>
+PooledIntervalTree<T>::PooledIntervalTree()
+    : root_(kNil), size_(0), next_sequence_(0) {
+}
+
+template<typename T>
+PooledIntervalTree<T>::~PooledIntervalTree() {
+}
+
+template<typename T>
+void PooledIntervalTree<T>::Insert(const Interval& interval,
+                                   const T& value) {
+  root_ = InsertInternal(root_, ElementPair(interval, value));
+  nodes_[root_].color = kBlack;
+  ++size_;
+}
+
+template<typename T>
+void PooledIntervalTree<T>::BuildFromSorted(
+    const std::vector<ElementPair>& elements) {
+  assert(std::is_sorted(elements.begin(), elements.end(),
+                        [](const ElementPair& left, const ElementPair& right) {
+    if (left.first.low() != right.first.low())
+      return left.first.low() < right.first.low();
+    return left.first.high() > right.first.high();
+  }));
+
+  Clear();
+  nodes_.reserve(elements.size());
+
+  // The tree is built as a 2-3 tree of the smallest possible height, which
+  // is then encoded as a left-leaning red-black tree.
+  size_t height = 0;
+  while ((static_cast<size_t>(2) << height) - 1 <= elements.size())
+    ++height;
+
+  size_t position = 0;
+  root_ = BuildInternal(elements, elements.size(), height, &position);
+  assert(position == elements.size());
+  size_ = elements.size();
+}
+
+template<typename T>
+bool PooledIntervalTree<T>::Erase(const Interval& interval, const T& value) {
+  Key key(0, 0, 0);
+  if (!FindKey(root_, interval, value, &key))
+    return false;
+
+  if (!IsRed(nodes_[root_].left) && !IsRed(nodes_[root_].right))
+    nodes_[root_].color = kRed;
+  root_ = EraseInternal(root_, key);
+  if (root_ != kNil)
+    nodes_[root_].color = kBlack;
+  --size_;
+  return true;
+}
+
+template<typename T>
+size_t PooledIntervalTree<T>::EraseRange(const Interval& interval) {
+  std::vector<Key> keys;
+  CollectContained(root_, interval, &keys);
+  if (keys.empty())
+    return 0;
+
+  if (keys.size() * 2 > size_) {
+    // Rebuilding the tree with the remaining elements is cheaper.
+    std::vector<ElementPair> remaining;
+    remaining.reserve(size_ - keys.size());
+    for (const ElementPair& element : *this) {
+      if (element.first.low() < interval.low() ||
+          element.first.high() > interval.high()) {
+        remaining.push_back(element);
+      }
+    }
+    uint64_t next_sequence = next_sequence_;
+    BuildFromSorted(remaining);
+    next_sequence_ = std::max(next_sequence_, next_sequence);
+    return keys.size();
+  }
+
+  for (const Key& key : keys) {
+    if (!IsRed(nodes_[root_].left) && !IsRed(nodes_[root_].right))
+      nodes_[root_].color = kRed;
+    root_ = EraseInternal(root_, key);
+    if (root_ != kNil)
+      nodes_[root_].color = kBlack;
+    --size_;
+  }
+  return keys.size();
+}
+
+template<typename T>
+void PooledIntervalTree<T>::Clear() {
+  nodes_.clear();
+  free_nodes_.clear();
+  root_ = kNil;
+  size_ = 0;
+  next_sequence_ = 0;
+}
+
+template<typename T>
+template<typename Visitor>
+void PooledIntervalTree<T>::EnumerateIntersection(
+    const Interval& interval,
+    Visitor&& visitor) const {
+  EnumerateIntersectionInternal(root_, interval, visitor);
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::NewNode(
+    const ElementPair& element, Color color) {
+  Node node;
+  node.element = element;
+  node.sequence = next_sequence_++;
+  node.subtree_max_high = element.first.high();
+  node.left = kNil;
+  node.right = kNil;
+  node.color = color;
+
+  if (!free_nodes_.empty()) {
+    NodeIndex index = free_nodes_.back();
+    free_nodes_.pop_back();
+    nodes_[index] = node;
+    return index;
+  }
+
+  nodes_.push_back(node);
+  return static_cast<NodeIndex>(nodes_.size() - 1);
+}
+
+template<typename T>
+void PooledIntervalTree<T>::FreeNode(NodeIndex node) {
+  free_nodes_.push_back(node);
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex
+    PooledIntervalTree<T>::InsertInternal(NodeIndex h,
+                                          const ElementPair& element) {
+  if (h == kNil)
+    return NewNode(element, kRed);
+
+  // All keys in the tree have a smaller sequence number than the new one.
+  Key key(element.first.low(), element.first.high(), next_sequence_);
+  if (key < nodes_[h].key()) {
+    NodeIndex left = InsertInternal(nodes_[h].left, element);
+    nodes_[h].left = left;
+  } else {
+    NodeIndex right = InsertInternal(nodes_[h].right, element);
+    nodes_[h].right = right;
+  }
+
+  return Balance(h);
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex
+    PooledIntervalTree<T>::BuildInternal(
+        const std::vector<ElementPair>& elements,
+        size_t num_elements, size_t height, size_t* position) {
+  if (height == 0) {
+    assert(num_elements == 0);
+    return kNil;
+  }
+
+  // Maximum number of elements in a 2-3 tree of height |height - 1|.
+  size_t max_child = 1;
+  for (size_t i = 1; i < height; ++i)
+    max_child *= 3;
+  max_child -= 1;
+
+  if (num_elements - 1 <= 2 * max_child) {
+    // 2-node.
+    size_t right_size = (num_elements - 1) / 2;
+    size_t left_size = num_elements - 1 - right_size;
+
+    NodeIndex left = BuildInternal(elements, left_size, height - 1, position);
+    NodeIndex h = NewNode(elements[(*position)++], kBlack);
+    NodeIndex right = BuildInternal(elements, right_size, height - 1,
+                                    position);
+    nodes_[h].left = left;
+    nodes_[h].right = right;
+    Update(h);
+    return h;
+  }
+
+  // 3-node, encoded as a black node with a red left child.
+  size_t remaining = num_elements - 2;
+  size_t right_size = remaining / 3;
+  size_t middle_size = (remaining - right_size) / 2;
+  size_t left_size = remaining - right_size - middle_size;
+
+  NodeIndex left = BuildInternal(elements, left_size, height - 1, position);
+  NodeIndex red = NewNode(elements[(*position)++], kRed);
+  NodeIndex middle = BuildInternal(elements, middle_size, height - 1,
+                                   position);
+  NodeIndex h = NewNode(elements[(*position)++], kBlack);
+  NodeIndex right = BuildInternal(elements, right_size, height - 1, position);
+
+  nodes_[red].left = left;
+  nodes_[red].right = middle;
+  Update(red);
+  nodes_[h].left = red;
+  nodes_[h].right = right;
+  Update(h);
+  return h;
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex
+    PooledIntervalTree<T>::EraseInternal(NodeIndex h, const Key& key) {
+  if (key < nodes_[h].key()) {
+    if (!IsRed(nodes_[h].left) && !IsRed(nodes_[nodes_[h].left].left))
+      h = MoveRedLeft(h);
+    NodeIndex left = EraseInternal(nodes_[h].left, key);
+    nodes_[h].left = left;
+  } else {
+    if (IsRed(nodes_[h].left))
+      h = RotateRight(h);
+    if (key == nodes_[h].key() && nodes_[h].right == kNil) {
+      FreeNode(h);
+      return kNil;
+    }
+    if (!IsRed(nodes_[h].right) && !IsRed(nodes_[nodes_[h].right].left))
+      h = MoveRedRight(h);
+    if (key == nodes_[h].key()) {
+      // Replace the element by its successor.
+      NodeIndex successor = nodes_[h].right;
+      while (nodes_[successor].left != kNil)
+        successor = nodes_[successor].left;
+      nodes_[h].element = nodes_[successor].element;
+      nodes_[h].sequence = nodes_[successor].sequence;
+      NodeIndex right = EraseMin(nodes_[h].right);
+      nodes_[h].right = right;
+    } else {
+      NodeIndex right = EraseInternal(nodes_[h].right, key);
+      nodes_[h].right = right;
+    }
+  }
+  return Balance(h);
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex
+    PooledIntervalTree<T>::EraseMin(NodeIndex h) {
+  if (nodes_[h].left == kNil) {
+    FreeNode(h);
+    return kNil;
+  }
+  if (!IsRed(nodes_[h].left) && !IsRed(nodes_[nodes_[h].left].left))
+    h = MoveRedLeft(h);
+  NodeIndex left = EraseMin(nodes_[h].left);
+  nodes_[h].left = left;
+  return Balance(h);
+}
+
+template<typename T>
+bool PooledIntervalTree<T>::FindKey(NodeIndex h, const Interval& interval,
+                                    const T& value, Key* key) const {
+  // Visit the nodes whose interval is equal to |interval|.
+  while (h != kNil) {
+    const Node& node = nodes_[h];
+    Key min_key(interval.low(), interval.high(), 0);
+    if (node.key() < min_key) {
+      h = node.right;
+      continue;
+    }
+    if (node.element.first.low() != interval.low() ||
+        node.element.first.high() != interval.high()) {
+      h = node.left;
+      continue;
+    }
+    if (FindKey(node.left, interval, value, key))
+      return true;
+    if (node.element.second == value) {
+      *key = node.key();
+      return true;
+    }
+    h = node.right;
+  }
+  return false;
+}
+
+template<typename T>
+void PooledIntervalTree<T>::CollectContained(NodeIndex h,
+                                             const Interval& interval,
+                                             std::vector<Key>* keys) const {
+  if (h == kNil)
+    return;
+  const Node& node = nodes_[h];
+  if (node.subtree_max_high < interval.low())
+    return;
+  if (node.element.first.low() >= interval.low())
+    CollectContained(node.left, interval, keys);
+  if (node.element.first.low() > interval.high())
+    return;
+  if (node.element.first.low() >= interval.low() &&
+      node.element.first.high() <= interval.high()) {
+    keys->push_back(node.key());
+  }
+  CollectContained(node.right, interval, keys);
+}
+
+template<typename T>
+template<typename Visitor>
+void PooledIntervalTree<T>::EnumerateIntersectionInternal(
+    NodeIndex h,
+    const Interval& interval,
+    Visitor& visitor) const {
+  while (h != kNil) {
+    const Node& node = nodes_[h];
+
+    // No element of this subtree ends after the lower bound of the search
+    // interval.
+    if (node.subtree_max_high < interval.low())
+      return;
+
+    EnumerateIntersectionInternal(node.left, interval, visitor);
+
+    // Elements of this node and its right subtree start after the higher
+    // bound of the search interval.
+    if (node.element.first.low() > interval.high())
+      return;
+
+    if (node.element.first.high() >= interval.low())
+      visitor(node.element);
+
+    h = node.right;
+  }
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::RotateLeft(
+    NodeIndex h) {
+  assert(h != kNil);
+  assert(nodes_[h].right != kNil);
+
+  NodeIndex child = nodes_[h].right;
+  nodes_[h].right = nodes_[child].left;
+  nodes_[child].left = h;
+
+  nodes_[child].color = nodes_[h].color;
+  nodes_[h].color = kRed;
+
+  Update(h);
+  Update(child);
+  return child;
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::RotateRight(
+    NodeIndex h) {
+  assert(h != kNil);
+  assert(nodes_[h].left != kNil);
+
+  NodeIndex child = nodes_[h].left;
+  nodes_[h].left = nodes_[child].right;
+  nodes_[child].right = h;
+
+  nodes_[child].color = nodes_[h].color;
+  nodes_[h].color = kRed;
+
+  Update(h);
+  Update(child);
+  return child;
+}
+
+template<typename T>
+void PooledIntervalTree<T>::FlipColors(NodeIndex h) {
+  assert(h != kNil);
+
+  nodes_[h].color = !nodes_[h].color;
+  if (nodes_[h].left != kNil)
+    nodes_[nodes_[h].left].color = !nodes_[nodes_[h].left].color;
+  if (nodes_[h].right != kNil)
+    nodes_[nodes_[h].right].color = !nodes_[nodes_[h].right].color;
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::MoveRedLeft(
+    NodeIndex h) {
+  FlipColors(h);
+  if (IsRed(nodes_[nodes_[h].right].left)) {
+    NodeIndex right = RotateRight(nodes_[h].right);
+    nodes_[h].right = right;
+    h = RotateLeft(h);
+    FlipColors(h);
+  }
+  return h;
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::MoveRedRight(
+    NodeIndex h) {
+  FlipColors(h);
+  if (IsRed(nodes_[nodes_[h].left].left)) {
+    h = RotateRight(h);
+    FlipColors(h);
+  }
+  return h;
+}
+
+template<typename T>
+typename PooledIntervalTree<T>::NodeIndex PooledIntervalTree<T>::Balance(
+    NodeIndex h) {
+  if (IsRed(nodes_[h].right) && !IsRed(nodes_[h].left))
+    h = RotateLeft(h);
+  if (IsRed(nodes_[h].left) && IsRed(nodes_[nodes_[h].left].left))
+    h = RotateRight(h);
+  if (IsRed(nodes_[h].left) && IsRed(nodes_[h].right))
+    FlipColors(h);
+  Update(h);
+  return h;
+}
+
+template<typename T>
+void PooledIntervalTree<T>::Update(NodeIndex h) {
+  Node& node = nodes_[h];
+  uint64_t max_high = node.element.first.high();
+  if (node.left != kNil)
+    max_high = std::max(max_high, nodes_[node.left].subtree_max_high);
+  if (node.right != kNil)
+    max_high = std::max(max_high, nodes_[node.right].subtree_max_high);
+  node.subtree_max_high = max_high;
+}
+
+}  // namespace containers
+}  // namespace tibee
+
+#endif  // _TIBEE_CONTAINERS_POOLEDINTERVALTREE_HPP
@@ -0,0 +1,363 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "containers/PooledIntervalTree.hpp"
+#include "containers/RedBlackIntervalTree.hpp"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace tibee {
+namespace containers {
+
+namespace {
+
+typedef PooledIntervalTree<int>::ElementPair ElementPair;
+
+class MockObserver {
+ public:
+  void ObserveElement(const ElementPair& pair) {
+    ObserveElementMock(pair.first, pair.second);
+  }
+
+  MOCK_METHOD2(ObserveElementMock, void(const Interval&, const int&));
+};
+
+bool ElementLess(const ElementPair& left, const ElementPair& right) {
+  if (left.first.low() != right.first.low())
+    return left.first.low() < right.first.low();
+  return left.first.high() > right.first.high();
+}
+
+std::vector<ElementPair> Intersection(const std::vector<ElementPair>& model,
+                                      const Interval& interval) {
+  std::vector<ElementPair> result;
+  for (const ElementPair& element : model) {
+    if (element.first.low() <= interval.high() &&
+        element.first.high() >= interval.low()) {
+      result.push_back(element);
+    }
+  }
+  return result;
+}
+
+std::vector<ElementPair> Intersection(const PooledIntervalTree<int>& tree,
+                                      const Interval& interval) {
+  std::vector<ElementPair> result;
+  tree.EnumerateIntersection(interval, [&](const ElementPair& element) {
+    result.push_back(element);
+  });
+  return result;
+}
+
+}  // namespace
+
+TEST(PooledIntervalTreeTest, Size) {
+  PooledIntervalTree<int> tree;
+  EXPECT_EQ(0u, tree.size());
+
+  tree.Insert(Interval(0, 10), 1);
+  EXPECT_EQ(1u, tree.size());
+
+  tree.Insert(Interval(0, 10), 2);
+  EXPECT_EQ(2u, tree.size());
+
+  tree.Insert(Interval(15, 25), 3);
+  EXPECT_EQ(3u, tree.size());
+}
+
+TEST(PooledIntervalTreeTest, InsertManyElements) {
+  PooledIntervalTree<int> tree;
+  MockObserver observer;
+  auto visitor = [&](const ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  for (int i = 0; i < 500; i += 5) {
+    Interval interval(i, i + 1);
+    int value = i;
+
+    tree.Insert(interval, value);
+
+    EXPECT_CALL(observer, ObserveElementMock(interval, value));
+    tree.EnumerateIntersection(Interval(i, i + 2), visitor);
+  }
+}
+
+TEST(PooledIntervalTreeTest, EnumerateIntersection) {
+  PooledIntervalTree<int> tree;
+  MockObserver observer;
+  auto visitor = [&](const ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  tree.Insert(Interval(0, 10), 1);
+  tree.Insert(Interval(10, 20), 2);
+  tree.Insert(Interval(20, 30), 3);
+  tree.Insert(Interval(40, 50), 4);
+  tree.Insert(Interval(0, 50), 5);
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 10), 1));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(10, 20), 2));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(20, 30), 3));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(40, 50), 4));
+
+    tree.EnumerateIntersection(Interval(0, 49), visitor);
+  }
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 10), 1));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(10, 20), 2));
+
+    tree.EnumerateIntersection(Interval(0, 10), visitor);
+  }
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 50), 5));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(20, 30), 3));
+
+    tree.EnumerateIntersection(Interval(25, 35), visitor);
+  }
+}
+
+TEST(PooledIntervalTreeTest, Iterator) {
+  PooledIntervalTree<int> tree;
+  EXPECT_TRUE(tree.begin() == tree.end());
+
+  tree.Insert(Interval(20, 30), 3);
+  tree.Insert(Interval(0, 10), 1);
+  tree.Insert(Interval(0, 50), 5);
+  tree.Insert(Interval(10, 20), 2);
+
+  std::vector<ElementPair> expected {
+    ElementPair(Interval(0, 50), 5),
+    ElementPair(Interval(0, 10), 1),
+    ElementPair(Interval(10, 20), 2),
+    ElementPair(Interval(20, 30), 3),
+  };
+  std::vector<ElementPair> actual(tree.begin(), tree.end());
+  EXPECT_EQ(expected, actual);
+}
+
+TEST(PooledIntervalTreeTest, Erase) {
+  PooledIntervalTree<int> tree;
+  MockObserver observer;
+  auto visitor = [&](const ElementPair& pair) {
+    observer.ObserveElement(pair);
+  };
+
+  tree.Insert(Interval(0, 10), 1);
+  tree.Insert(Interval(0, 10), 2);
+  tree.Insert(Interval(10, 20), 3);
+  tree.Insert(Interval(20, 30), 4);
+
+  EXPECT_FALSE(tree.Erase(Interval(0, 10), 3));
+  EXPECT_FALSE(tree.Erase(Interval(0, 11), 1));
+  EXPECT_TRUE(tree.Erase(Interval(0, 10), 1));
+  EXPECT_EQ(3u, tree.size());
+
+  {
+    ::testing::InSequence sequence;
+    EXPECT_CALL(observer, ObserveElementMock(Interval(0, 10), 2));
+    EXPECT_CALL(observer, ObserveElementMock(Interval(10, 20), 3));
+
+    tree.EnumerateIntersection(Interval(5, 15), visitor);
+  }
+
+  // Intervals that are contained in [0, 20] are erased.
+  EXPECT_EQ(2u, tree.EraseRange(Interval(0, 20)));
+  EXPECT_EQ(1u, tree.size());
+
+  EXPECT_CALL(observer, ObserveElementMock(Interval(20, 30), 4));
+  tree.EnumerateIntersection(Interval(0, 100), visitor);
+}
+
+TEST(PooledIntervalTreeTest, BuildFromSorted) {
+  for (int size = 0; size < 100; ++size) {
+    std::vector<ElementPair> elements;
+    for (int i = 0; i < size; ++i)
+      elements.push_back(ElementPair(Interval(i, i + 3), i));
+
+    PooledIntervalTree<int> tree;
+    tree.BuildFromSorted(elements);
+    EXPECT_EQ(elements.size(), tree.size());
+    EXPECT_EQ(elements, std::vector<ElementPair>(tree.begin(), tree.end()));
+
+    // The tree must remain valid after insertions and deletions.
+    ElementPair inserted(Interval(size / 2, size), -1);
+    tree.Insert(inserted.first, inserted.second);
+    elements.insert(std::upper_bound(elements.begin(), elements.end(),
+                                     inserted, ElementLess),
+                    inserted);
+    for (int i = 0; i < size; i += 2) {
+      ElementPair erased(Interval(i, i + 3), i);
+      EXPECT_TRUE(tree.Erase(erased.first, erased.second));
+      elements.erase(std::find(elements.begin(), elements.end(), erased));
+    }
+    EXPECT_EQ(elements, std::vector<ElementPair>(tree.begin(), tree.end()));
+    EXPECT_EQ(Intersection(elements, Interval(10, 20)),
+              Intersection(tree, Interval(10, 20)));
+  }
+}
+
+TEST(PooledIntervalTreeTest, RandomOperations) {
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> low_distribution(0, 1000);
+  std::uniform_int_distribution<int> length_distribution(0, 50);
+  std::uniform_int_distribution<int> value_distribution(0, 3);
+  std::uniform_int_distribution<int> operation_distribution(0, 9);
+
+  PooledIntervalTree<int> tree;
+  std::vector<ElementPair> model;
+
+  for (int i = 0; i < 20000; ++i) {
+    int low = low_distribution(generator);
+    Interval interval(low, low + length_distribution(generator));
+    int value = value_distribution(generator);
+    int operation = operation_distribution(generator);
+
+    if (operation < 5) {
+      tree.Insert(interval, value);
+      ElementPair element(interval, value);
+      model.insert(std::upper_bound(model.begin(), model.end(), element,
+                                    ElementLess),
+                   element);
+    } else if (operation < 9) {
+      auto it = std::find(model.begin(), model.end(),
+                          ElementPair(interval, value));
+      EXPECT_EQ(it != model.end(), tree.Erase(interval, value));
+      if (it != model.end())
+        model.erase(it);
+    } else if (i % 20 == 0) {
+      size_t erased = 0;
+      for (auto it = model.begin(); it != model.end();) {
+        if (it->first.low() >= interval.low() &&
+            it->first.high() <= interval.high()) {
+          it = model.erase(it);
+          ++erased;
+        } else {
+          ++it;
+        }
+      }
+      EXPECT_EQ(erased, tree.EraseRange(interval));
+    } else {
+      EXPECT_EQ(Intersection(model, interval), Intersection(tree, interval));
+    }
+
+    ASSERT_EQ(model.size(), tree.size());
+  }
+
+  EXPECT_EQ(model, std::vector<ElementPair>(tree.begin(), tree.end()));
+}
+
+// Compares the pooled tree with RedBlackIntervalTree on the workloads of
+// RedBlackIntervalTreeTest, scaled to millions of elements.
+TEST(PooledIntervalTreeTest, DISABLED_Benchmark) {
+  const int kNumElements = 4000000;
+  typedef std::chrono::steady_clock Clock;
+  auto elapsed = [](Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        Clock::now() - start).count();
+  };
+
+  uint64_t pooled_sum = 0;
+  uint64_t red_black_sum = 0;
+
+  {
+    auto start = Clock::now();
+    PooledIntervalTree<int> tree;
+    for (int i = 0; i < kNumElements; i += 5) {
+      tree.Insert(Interval(i, i + 1), i);
+      tree.EnumerateIntersection(Interval(i, i + 2),
+                                 [&](const ElementPair& element) {
+        pooled_sum += element.second;
+      });
+    }
+    std::cout << "PooledIntervalTree insert/query: " << elapsed(start)
+              << " ms" << std::endl;
+
+    start = Clock::now();
+    for (int i = 0; i < kNumElements; i += 50) {
+      tree.EnumerateIntersection(Interval(i, i + 100),
+                                 [&](const ElementPair& element) {
+        pooled_sum += element.second;
+      });
+    }
+    std::cout << "PooledIntervalTree range queries: " << elapsed(start)
+              << " ms" << std::endl;
+
+    start = Clock::now();
+    tree.EraseRange(Interval(0, kNumElements / 2));
+    std::cout << "PooledIntervalTree erase range: " << elapsed(start)
+              << " ms" << std::endl;
+  }
+
+  {
+    std::vector<ElementPair> elements;
+    elements.reserve(kNumElements);
+    for (int i = 0; i < kNumElements; ++i)
+      elements.push_back(ElementPair(Interval(i, i + 1), i));
+
+    auto start = Clock::now();
+    PooledIntervalTree<int> tree;
+    tree.BuildFromSorted(elements);
+    std::cout << "PooledIntervalTree bulk build: " << elapsed(start)
+              << " ms" << std::endl;
+  }
+
+  {
+    auto start = Clock::now();
+    RedBlackIntervalTree<int> tree;
+    for (int i = 0; i < kNumElements; i += 5) {
+      tree.Insert(Interval(i, i + 1), i);
+      tree.EnumerateIntersection(
+          Interval(i, i + 2),
+          [&](const RedBlackIntervalTree<int>::ElementPair& element) {
+        red_black_sum += element.second;
+      });
+    }
+    std::cout << "RedBlackIntervalTree insert/query: " << elapsed(start)
+              << " ms" << std::endl;
+
+    start = Clock::now();
+    for (int i = 0; i < kNumElements; i += 50) {
+      tree.EnumerateIntersection(
+          Interval(i, i + 100),
+          [&](const RedBlackIntervalTree<int>::ElementPair& element) {
+        red_black_sum += element.second;
+      });
+    }
+    std::cout << "RedBlackIntervalTree range queries: " << elapsed(start)
+              << " ms" << std::endl;
+  }
+
+  EXPECT_EQ(red_black_sum, pooled_sum);
+}
+
+}  // namespace containers
+}  // namespace tibee
@@ -58,9 +58,10 @@ class RedBlackIntervalTree : boost::noncopyable {
   // lower bound. When many elements have the same lower bound, they are
   // ordered from the longest to the shortest.
   // @param interval Interval from which the intersection is searched.
-  // @param callback The callback that receives the found elements.
+  // @param visitor Receives the found elements as const ElementPair&.
+  template <typename Visitor>
   void EnumerateIntersection(const Interval& interval,
-                             const EnumerateCallback& callback) const;
+                             Visitor&& visitor) const;
 
   // @returns the number of elements in the tree.
   size_t size() const {
@@ -186,9 +187,10 @@ class RedBlackIntervalTree : boost::noncopyable {
   };
 
   Node* InsertInternal(Node* h, const Interval& interval, const T& value);
+  template <typename Visitor>
   void EnumerateIntersectionInternal(Node* h,
                                      const Interval& interval,
-                                     const EnumerateCallback& callback) const;
+                                     Visitor& visitor) const;
 
   Node* RotateLeft(Node* h);
   Node* RotateRight(Node* h);
@@ -229,10 +231,11 @@ void RedBlackIntervalTree<T>::Insert(const Interval& interval, const T& value) {
 }
 
 template<typename T>
+template<typename Visitor>
 void RedBlackIntervalTree<T>::EnumerateIntersection(
     const Interval& interval,
-    const EnumerateCallback& callback) const {
-  EnumerateIntersectionInternal(root_, interval, callback);
+    Visitor&& visitor) const {
+  EnumerateIntersectionInternal(root_, interval, visitor);
 }
 
 template<typename T>
@@ -266,10 +269,11 @@ typename RedBlackIntervalTree<T>::Node*
 }
 
 template<typename T>
+template<typename Visitor>
 void RedBlackIntervalTree<T>::EnumerateIntersectionInternal(
     Node* h,
     const Interval& interval,
-    const EnumerateCallback& callback) const {
+    Visitor& visitor) const {
   if (h == NULL)
     return;
 
@@ -277,7 +281,7 @@ void RedBlackIntervalTree<T>::EnumerateIntersectionInternal(
   // search interval.
   if (h->left() != NULL &&
       h->left()->subtree_max_high() > interval.low()) {
-    EnumerateIntersectionInternal(h->left(), interval, callback);
+    EnumerateIntersectionInternal(h->left(), interval, visitor);
   }
 
   // If the lower bound of this node is after the higher bound of the search
@@ -295,12 +299,12 @@ void RedBlackIntervalTree<T>::EnumerateIntersectionInternal(
          it != h->ElementEnd(); ++it) {
       if (it->first.high() < interval.low())
         break;
-      callback(*it);
+      visitor(*it);
     }
   }
 
   // Search the right subtree.
-  EnumerateIntersectionInternal(h->right(), interval, callback);
+  EnumerateIntersectionInternal(h->right(), interval, visitor);
 }
 
 template<typename T>
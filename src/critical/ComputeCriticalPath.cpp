@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <unordered_map>
 
 namespace tibee
 {
@@ -46,11 +47,26 @@ void InsertCriticalPathSegment(
     }
 }
 
+// Cursors on the nodes of each thread of the critical graph.
+typedef std::unordered_map<thread_t, CriticalGraph::Cursor> Cursors;
+
+CriticalGraph::Cursor* GetCursor(
+    const CriticalGraph& graph,
+    thread_t tid,
+    Cursors* cursors)
+{
+    auto look = cursors->find(tid);
+    if (look == cursors->end())
+        look = cursors->insert(std::make_pair(tid, graph.GetCursor(tid))).first;
+    return &look->second;
+}
+
 void ComputeCriticalPathRecursive(
     const CriticalGraph& graph,
     timestamp_t startTs,
     timestamp_t endTs,
     thread_t tid,
+    Cursors* cursors,
     CriticalPath* path);
 
 void ResolvedBlockedEdge(
@@ -58,6 +74,7 @@ void ResolvedBlockedEdge(
     const CriticalEdge& edge,
     timestamp_t startTs,
     timestamp_t endTs,
+    Cursors* cursors,
     CriticalPath* path)
 {
     assert(edge.type() == kWaitBlocked || edge.type() == kNetwork);
@@ -98,7 +115,8 @@ void ResolvedBlockedEdge(
                 thread_t networkSourceThread = networkWakeUpEdge.from()->tid();
 
                 ComputeCriticalPathRecursive(
-                    graph, startTs, networkStartNode->ts(), networkSourceThread, path);
+                    graph, startTs, networkStartNode->ts(), networkSourceThread,
+                    cursors, path);
 
                 // Add a segment for the time spent waiting on the network thread.
                 InsertCriticalPathSegment(CriticalPathSegment(
@@ -126,7 +144,8 @@ void ResolvedBlockedEdge(
         startTs, startTs, sourceThread, kEpsilon), path);
 
     // Compute the critical path on the source thread.
-    ComputeCriticalPathRecursive(graph, startTs, endTs, sourceThread, path);
+    ComputeCriticalPathRecursive(
+        graph, startTs, endTs, sourceThread, cursors, path);
 }
 
 void ComputeCriticalPathRecursive(
@@ -134,6 +153,7 @@ void ComputeCriticalPathRecursive(
     timestamp_t startTs,
     timestamp_t endTs,
     thread_t tid,
+    Cursors* cursors,
     CriticalPath* path)
 {
     if (endTs <= startTs)
@@ -141,7 +161,8 @@ void ComputeCriticalPathRecursive(
 
     // Find a node on thread |tid| that is at timestamp |startTs| or that has
     // an outgoing edge that overlaps this timestamp.
-    auto* node = graph.GetNodeIntersecting(startTs, tid);
+    auto* cursor = GetCursor(graph, tid, cursors);
+    auto* node = cursor->GetNodeIntersecting(startTs);
 
     // If no node was found for the thread at timestamp |startTs|, it must be
     // because the thread didn't exist at that time.
@@ -149,7 +170,7 @@ void ComputeCriticalPathRecursive(
     {
         // Look for the first node of the thread that has a timestamp > |startTs|
         // and that has an input edge.
-        node = graph.GetNodeStartingAfter(startTs, tid);
+        node = cursor->GetNodeStartingAfter(startTs);
         bool foundSomething = false;
         while (node != nullptr && node->ts() <= endTs)
         {
@@ -160,7 +181,8 @@ void ComputeCriticalPathRecursive(
                 // the critical path on this thread.
                 auto& wakeUpEdge = graph.GetEdge(wakeUpEdgeId);
                 ComputeCriticalPathRecursive(
-                    graph, startTs, node->ts(), wakeUpEdge.from()->tid(), path);
+                    graph, startTs, node->ts(), wakeUpEdge.from()->tid(),
+                    cursors, path);
                 foundSomething = true;
                 break;
             }
@@ -177,7 +199,7 @@ void ComputeCriticalPathRecursive(
         {
             base::tberror() << "Thread with no wake-up edge found while computing critical path ("
                 << tid << ", " << startTs <<")." << base::tbendl();
-            node = graph.GetNodeStartingAfter(startTs, tid);
+            node = cursor->GetNodeStartingAfter(startTs);
 
             timestamp_t segmentEnd = endTs;
             if (node != nullptr) {
@@ -207,7 +229,8 @@ void ComputeCriticalPathRecursive(
 
         if (edge.type() == kWaitBlocked || edge.type() == kNetwork)
         {
-            ResolvedBlockedEdge(graph, edge, edgeStartTs, edgeEndTs, path);
+            ResolvedBlockedEdge(
+                graph, edge, edgeStartTs, edgeEndTs, cursors, path);
         }
         else
         {
@@ -233,7 +256,8 @@ void ComputeCriticalPath(
 {
     assert(path != nullptr);
     assert(path->empty());
-    ComputeCriticalPathRecursive(graph, startTs, endTs, tid, path);
+    Cursors cursors;
+    ComputeCriticalPathRecursive(graph, startTs, endTs, tid, &cursors, path);
 }
 
 }  // namespace critical
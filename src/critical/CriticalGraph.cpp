@@ -25,6 +25,8 @@
 #include <unordered_set>
 
 #include "base/CleanContainer.hpp"
+#include "base/MemoryUsage.hpp"
+#include "base/SortedSearch.hpp"
 #include "base/print.hpp"
 
 namespace tibee
@@ -38,14 +40,6 @@ namespace
 using base::tbendl;
 using base::tberror;
 
-struct NodeTsComparator
-{
-    bool operator() (timestamp_t ts, const CriticalNode::UP& node) const
-    {
-        return ts < node->ts();
-    }
-};
-
 }  // namespace
 
 CriticalGraph::CriticalGraph()
@@ -107,6 +101,19 @@ void CriticalGraph::Cleanup(timestamp_t ts)
 	}
 }
 
+size_t CriticalGraph::ApproximateMemoryUsage() const
+{
+    size_t usage = base::HashMapMemoryUsage(_tid_to_nodes) +
+                   base::HashMapMemoryUsage(_edges);
+    for (const auto& threadHistory : _tid_to_nodes)
+    {
+        usage += sizeof(OrderedNodes) +
+                 base::VectorMemoryUsage(*threadHistory.second) +
+                 threadHistory.second->size() * sizeof(CriticalNode);
+    }
+    return usage;
+}
+
 CriticalNode* CriticalGraph::CreateNode(uint32_t tid)
 {
     // Create node.
@@ -129,46 +136,69 @@ CriticalNode* CriticalGraph::CreateNode(uint32_t tid)
 }
 
 const CriticalNode* CriticalGraph::GetNodeIntersecting(timestamp_t ts, thread_t tid) const
+{
+    return GetCursor(tid).GetNodeIntersecting(ts);
+}
+
+const CriticalNode* CriticalGraph::GetNodeStartingAfter(timestamp_t ts, thread_t tid) const
+{
+    return GetCursor(tid).GetNodeStartingAfter(ts);
+}
+
+CriticalGraph::Cursor CriticalGraph::GetCursor(thread_t tid) const
 {
     auto thread_nodes_it = _tid_to_nodes.find(tid);
     if (thread_nodes_it == _tid_to_nodes.end())
-        return nullptr;
-    const auto& thread_nodes = thread_nodes_it->second;
-    NodeTsComparator comparator;
-    auto node_it = std::upper_bound(thread_nodes->begin(), thread_nodes->end(), ts, comparator);
+        return Cursor(this, nullptr);
+    return Cursor(this, thread_nodes_it->second.get());
+}
 
-    --node_it;
+const CriticalNode* CriticalGraph::Cursor::GetNodeIntersecting(timestamp_t ts)
+{
+    if (_nodes == nullptr)
+        return nullptr;
 
-    if (node_it == thread_nodes->end() || node_it == (thread_nodes->begin() - 1))
+    size_t position = FindNodeStartingAfter(ts);
+    if (position == 0)
         return nullptr;
+    --position;
+    _position = position;
 
-    auto edgeId = (*node_it)->edge(kCriticalEdgeOutHorizontal);
+    const auto& node = (*_nodes)[position];
+    auto edgeId = node->edge(kCriticalEdgeOutHorizontal);
     if (edgeId == kInvalidCriticalEdgeId)
-        return (*node_it)->ts() == ts ? (node_it->get()) : nullptr;
-    if (GetEdge(edgeId).to()->ts() < ts)
+        return node->ts() == ts ? node.get() : nullptr;
+    if (_graph->GetEdge(edgeId).to()->ts() < ts)
         return nullptr;
 
-    return node_it->get();
+    return node.get();
 }
 
-const CriticalNode* CriticalGraph::GetNodeStartingAfter(timestamp_t ts, thread_t tid) const
+const CriticalNode* CriticalGraph::Cursor::GetNodeStartingAfter(timestamp_t ts)
 {
-    auto thread_nodes_it = _tid_to_nodes.find(tid);
-    if (thread_nodes_it == _tid_to_nodes.end() || thread_nodes_it->second->empty()) {
+    if (_nodes == nullptr || _nodes->empty()) {
         base::tberror() << "Querying node on thread that doesn't exist." << base::tbendl();
         return nullptr;
     }
-    const auto& thread_nodes = thread_nodes_it->second;
-    NodeTsComparator comparator;
-    auto node_it = std::upper_bound(thread_nodes->begin(), thread_nodes->end(), ts, comparator);
 
-    if (node_it == thread_nodes->end()) {
-      base::tberror() << "First node on thread " << tid << ": " << thread_nodes->front()->ts() << base::tbendl();
-      base::tberror() << "Last node on thread " << tid << ": " << thread_nodes->back()->ts() << base::tbendl();
+    size_t position = FindNodeStartingAfter(ts);
+    if (position == _nodes->size()) {
+      thread_t tid = _nodes->front()->tid();
+      base::tberror() << "First node on thread " << tid << ": " << _nodes->front()->ts() << base::tbendl();
+      base::tberror() << "Last node on thread " << tid << ": " << _nodes->back()->ts() << base::tbendl();
       return nullptr;
     }
+    _position = position;
 
-    return node_it->get();
+    return (*_nodes)[position].get();
+}
+
+size_t CriticalGraph::Cursor::FindNodeStartingAfter(timestamp_t ts)
+{
+    const auto& nodes = *_nodes;
+    return base::GallopingPartitionPoint(
+        nodes.size(), _position,
+        [&](size_t index) { return nodes[index]->ts() > ts; });
 }
 
 CriticalNode* CriticalGraph::GetLastNodeForThread(uint32_t tid)
@@ -43,6 +43,37 @@ public:
     typedef std::vector<CriticalNode::UP> OrderedNodes;
     typedef std::unordered_map<uint32_t, std::unique_ptr<OrderedNodes>> TidToNodesMap;
 
+    // Remembers a position in the nodes of a thread, so that queries with
+    // increasing timestamps don't search all the nodes of the thread. A
+    // cursor is invalidated by a cleanup.
+    class Cursor
+    {
+    public:
+        Cursor() : _graph(nullptr), _nodes(nullptr), _position(0) {}
+
+        // Get a node which has an horizontal out edge that overlaps |ts|.
+        const CriticalNode* GetNodeIntersecting(timestamp_t ts);
+
+        // Get a node that starts after the specified timestamp.
+        const CriticalNode* GetNodeStartingAfter(timestamp_t ts);
+
+    private:
+        friend class CriticalGraph;
+        Cursor(const CriticalGraph* graph, const OrderedNodes* nodes)
+            : _graph(graph), _nodes(nodes), _position(0) {}
+
+        // Index of the first node that starts after |ts|.
+        size_t FindNodeStartingAfter(timestamp_t ts);
+
+        const CriticalGraph* _graph;
+
+        // Nodes of the thread.
+        const OrderedNodes* _nodes;
+
+        // Index of the node returned by the last query.
+        size_t _position;
+    };
+
     CriticalGraph();
     ~CriticalGraph();
 
@@ -52,6 +83,9 @@ public:
     // Removes everything that is before the specified timestamp.
     void Cleanup(timestamp_t ts);
 
+    // Approximate number of bytes used by the history.
+    size_t ApproximateMemoryUsage() const;
+
     // Create a node.
     // The node is not linked to any other node.
     CriticalNode* CreateNode(uint32_t tid);
@@ -62,6 +96,9 @@ public:
     // Get a node that starts after the specified timestamp.
     const CriticalNode* GetNodeStartingAfter(timestamp_t ts, thread_t tid) const;
 
+    // Get a cursor on the nodes of a thread.
+    Cursor GetCursor(thread_t tid) const;
+
     // Get the last created node for the given thread.
     CriticalNode* GetLastNodeForThread(uint32_t tid);
 
@@ -104,6 +104,43 @@ TEST(CriticalGraph, GetNodeStartingAfter)
     EXPECT_EQ(nullptr, graph.GetNodeStartingAfter(21, 1));
 }
 
+TEST(CriticalGraph, Cursor)
+{
+    // Create the graph.
+    CriticalGraph graph;
+
+    std::vector<CriticalNode*> nodes;
+
+    for (timestamp_t ts = 10; ts < 210; ts += 2)
+    {
+        graph.SetTimestamp(ts);
+        nodes.push_back(graph.CreateNode(1));
+        if (nodes.size() > 1 && nodes.size() % 10 != 0)
+        {
+            graph.CreateHorizontalEdge(
+                kRun, nodes[nodes.size() - 2], nodes.back());
+        }
+    }
+
+    // Forward queries, then backward queries, must return the same
+    // nodes as independent queries.
+    auto cursor = graph.GetCursor(1);
+    for (timestamp_t ts = 0; ts < 220; ++ts)
+    {
+        EXPECT_EQ(graph.GetNodeIntersecting(ts, 1),
+                  cursor.GetNodeIntersecting(ts));
+    }
+    for (timestamp_t ts = 220; ts > 7; ts -= 7)
+    {
+        EXPECT_EQ(graph.GetNodeIntersecting(ts, 1),
+                  cursor.GetNodeIntersecting(ts));
+        EXPECT_EQ(graph.GetNodeStartingAfter(ts - 3, 1),
+                  cursor.GetNodeStartingAfter(ts - 3));
+    }
+
+    auto emptyCursor = graph.GetCursor(2);
+    EXPECT_EQ(nullptr, emptyCursor.GetNodeIntersecting(10));
+}
 
 }    // namespace critical
 }    // namespace tibee
@@ -25,6 +25,7 @@
 #include "block/ServiceList.hpp"
 #include "critical/CriticalTypes.hpp"
 #include "notification/NotificationCenter.hpp"
+#include "value/Value.hpp"
 
 namespace tibee {
 namespace critical_blocks {
@@ -80,6 +81,23 @@ critical::CriticalEdgeType ResolveSoftIRQ(uint32_t vec)
     }
 }
 
+// Type of edge that summarizes a state of a thread that is not recorded in
+// detail: the thread is either running or blocked.
+critical::CriticalEdgeType CoarseEdgeType(critical::CriticalEdgeType type)
+{
+    switch (type)
+    {
+        case critical::kRun:
+        case critical::kInterrupted:
+        case critical::kWaitCpu:
+            return critical::kRun;
+        case critical::kUnknown:
+            return critical::kUnknown;
+        default:
+            return critical::kWaitBlocked;
+    }
+}
+
 uint32_t GetEventCPU(const trace::EventValue& event)
 {
     return event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger();
@@ -96,6 +114,7 @@ PacketKey GetPacketKey(const trace::EventValue& event)
 }  // namespace
 
 CriticalBlock::CriticalBlock()
+    : _pruneGraph(false)
 {
 }
 
@@ -103,6 +122,12 @@ CriticalBlock::~CriticalBlock()
 {
 }
 
+void CriticalBlock::Start(const value::Value* params)
+{
+    if (params != nullptr)
+        _pruneGraph = value::BoolValue::GetValue(params->GetField("prune"));
+}
+
 void CriticalBlock::LoadServices(const block::ServiceList& serviceList)
 {
     AbstractBuildBlock::LoadServices(serviceList);
@@ -126,12 +151,15 @@ void CriticalBlock::AddObservers(notification::NotificationCenter* notificationC
     AddKernelObserver(notificationCenter, Token("hrtimer_expire_exit"), base::BindObject(&CriticalBlock::OnHrtimerExpireExit, this));
     AddKernelObserver(notificationCenter, Token("inet_sock_local_in"), base::BindObject(&CriticalBlock::OnInetSockLocalIn, this));
     AddKernelObserver(notificationCenter, Token("inet_sock_local_out"), base::BindObject(&CriticalBlock::OnInetSockLocalOut, this));
-    AddThreadStateObserver(notificationCenter, Token(kStateStatus), base::BindObject(&CriticalBlock::OnThreadStatus, this));
+    AddThreadStateChangeObserver(notificationCenter, kStateStatus, base::BindObject(&CriticalBlock::OnThreadStatus, this));
     AddThreadStateObserver(notificationCenter, Token(kStateExecName), base::BindObject(&CriticalBlock::OnThreadName, this));
 }
 
 void CriticalBlock::OnTTWU(const trace::EventValue& event)
 {
+    if (!InExecutionWindow())
+        return;
+
     uint32_t source_cpu = GetEventCPU(event);
     uint32_t source_tid = ThreadForCPU(source_cpu);
     uint32_t target_tid = event.getEventField("tid")->AsUInteger();
@@ -247,6 +275,9 @@ void CriticalBlock::OnInetSockLocalIn(const trace::EventValue& event)
 
 void CriticalBlock::OnInetSockLocalOut(const trace::EventValue& event)
 {
+    if (!InExecutionWindow())
+        return;
+
     auto cpu = GetEventCPU(event);
     const auto& cpu_context = _context[cpu];
     if (!cpu_context.empty())
@@ -286,6 +317,12 @@ void CriticalBlock::OnTTWUBetweenThreads(uint32_t source_tid, uint32_t target_ti
             DiskRequests()->AddInterval(diskNode->ts(), State()->timestamp(), target_tid);
     }
 
+    // The thread that wakes up a detailed thread is detailed from now on.
+    // Its earlier history stays summarized unless the first pass already
+    // added it.
+    if (_pruneGraph && source_tid != 0 && ThreadInterest()->Contains(target_tid))
+        ThreadInterest()->AddThread(source_tid);
+
     // Cut the source thread.
     auto nextNodeSource = CutThread(source_tid, "ttwu_source");
     if (nextNodeSource == nullptr)
@@ -345,18 +382,16 @@ void CriticalBlock::OnWakeupFromInterrupt(InterruptContext* context, uint32_t ta
     _lastEdgeTypePerThread[target_tid] = context->type;
 }
 
-void CriticalBlock::OnThreadStatus(
-    uint32_t tid,
-    const notification::Path& path,
-    const value::Value* value)
+void CriticalBlock::OnThreadStatus(const state::StateChange& change)
 {
+    thread_t tid = change.thread;
+
     // Determine the new edge type.
-    auto newStatusValue = value->GetField(kCurrentStateAttributeValueField);
     critical::CriticalEdgeType newEdgeType = critical::kUnknown;
 
-    if (newStatusValue != nullptr)
+    if (change.hasValue)
     {
-        quark::Quark qNewStatus(newStatusValue->AsUInteger());
+        quark::Quark qNewStatus(change.value);
 
         if (qNewStatus == Q_RUN_USERMODE || qNewStatus == Q_RUN_SYSCALL)
             newEdgeType = critical::kRun;
@@ -368,6 +403,9 @@ void CriticalBlock::OnThreadStatus(
             newEdgeType = critical::kWaitBlocked;
     }
 
+    if (!IsDetailed(tid))
+        newEdgeType = CoarseEdgeType(newEdgeType);
+
     // Get the last edge type for the thread.
     auto lookLastType = _lastEdgeTypePerThread.find(tid);
     if (lookLastType != _lastEdgeTypePerThread.end() &&
@@ -376,6 +414,17 @@ void CriticalBlock::OnThreadStatus(
         return;
     }
 
+    // Outside the execution windows, only keep track of the type of the
+    // next edge, so that the graph can resume in the next window.
+    if (!InExecutionWindow())
+    {
+        if (change.hasValue)
+            _lastEdgeTypePerThread[tid] = newEdgeType;
+        else
+            _lastEdgeTypePerThread.erase(tid);
+        return;
+    }
+
     // Create the new node and add a link to it from the prev node.
     auto prevNode = CriticalGraph()->GetLastNodeForThread(tid);
     auto newNode = CriticalGraph()->CreateNode(tid);
@@ -383,7 +432,7 @@ void CriticalBlock::OnThreadStatus(
     if (prevNode != nullptr && lookLastType != _lastEdgeTypePerThread.end())
         CriticalGraph()->CreateHorizontalEdge(lookLastType->second, prevNode, newNode);
 
-    if (newStatusValue != nullptr)
+    if (change.hasValue)
     {
         // Keep track of the type of the next edge.
         _lastEdgeTypePerThread[tid] = newEdgeType;
@@ -444,5 +493,10 @@ uint32_t CriticalBlock::ThreadForCPU(uint32_t cpu) const
     return thread;
 }
 
+bool CriticalBlock::IsDetailed(thread_t tid) const
+{
+    return !_pruneGraph || ThreadInterest()->Contains(tid);
+}
+
 }  // namespace critical_blocks
 }  // namespace tibee
@@ -36,6 +36,14 @@ namespace critical_blocks
 /**
  * Critical block.
  *
+ * When the graph is pruned, only the threads of the thread interest set
+ * are recorded in full detail. The other threads are summarized as
+ * run/blocked spans. With two passes, the first pass seeds the set with
+ * the threads that wake up the analyzed executions, transitively.
+ * Otherwise, the set only grows forward in time: a thread is detailed
+ * from the first time it wakes up a detailed thread, so its earlier
+ * history and the threads that woke it up before are summarized.
+ *
  * @author Francois Doray
  */
 class CriticalBlock : public build_blocks::AbstractBuildBlock
@@ -44,6 +52,7 @@ public:
     CriticalBlock();
     ~CriticalBlock();
 
+    virtual void Start(const value::Value* params) override;
     virtual void LoadServices(const block::ServiceList& serviceList) override;
     virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
 
@@ -67,7 +76,7 @@ private:
     void OnHrtimerExpireExit(const trace::EventValue& event);
     void OnInetSockLocalIn(const trace::EventValue& event);
     void OnInetSockLocalOut(const trace::EventValue& event);
-    void OnThreadStatus(uint32_t tid, const notification::Path& path, const value::Value* value);
+    void OnThreadStatus(const state::StateChange& change);
     void OnThreadName(uint32_t tid, const notification::Path& path, const value::Value* value);
 
     void OnTTWUBetweenThreads(uint32_t source_tid, uint32_t target_tid);
@@ -78,6 +87,13 @@ private:
     // Thread for an event.
     uint32_t ThreadForCPU(uint32_t cpu) const;
 
+    // Indicates whether the graph records all the states of a thread.
+    bool IsDetailed(thread_t tid) const;
+
+    // Only record the threads of the dependency closure of the analyzed
+    // executions in detail.
+    bool _pruneGraph;
+
     // Stack of interrupt contexts per CPU.
     std::unordered_map<uint32_t, std::stack<InterruptContext>> _context;
 
@@ -21,6 +21,7 @@
 #include <sstream>
 #include <vector>
 
+#include "base/Instrumentation.hpp"
 #include "base/ex/FatalError.hpp"
 #include "db/ReadBuffer.hpp"
 #include "db/Slice.hpp"
@@ -47,6 +48,8 @@ const char kExecutionNameReverseIdType = 4;
 const char kFunctionNameReverseIdType = 5;
 const char kStackReverseIdType = 6;
 const char kExecutionKeyType = 7;
+const char kCheckpointKeyType = 8;
+const char kIngestedTraceKeyType = 9;
 
 struct Key
 {
@@ -93,6 +96,8 @@ public:
         else
         {
             // Execution (name + timestamp) -> Execution.
+            // Checkpoint (name) -> Checkpoint.
+            // Ingested trace (identity) -> Nothing.
             if (keyA->id < keyB->id)
                 return -1;
             else if (keyA->id > keyB->id)
@@ -240,6 +245,8 @@ bool ReadExecutionSamplesFromBuffer(
         execution->IncrementSample(stackId, stackValue);
     }
 
+    execution->FreezeSamples();
+
     return true;
 }
 
@@ -266,11 +273,16 @@ Database::~Database()
 
 const std::string& Database::GetFunctionName(stacks::FunctionNameId id) const
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     auto look = _functionNamesCache.find(id);
     if (look != _functionNamesCache.end())
+    {
+        TIBEE_COUNTER_ADD("db.function-names-cache.hits", 1);
         return look->second;
+    }
+    TIBEE_COUNTER_ADD("db.function-names-cache.misses", 1);
 
     Key key;
     key.type = kFunctionNameIdType;
@@ -296,6 +308,7 @@ const std::string& Database::GetFunctionName(stacks::FunctionNameId id) const
 
 stacks::FunctionNameId Database::AddFunctionName(const std::string& name)
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     // Check whether this function name is already in the database.
@@ -311,8 +324,10 @@ stacks::FunctionNameId Database::AddFunctionName(const std::string& name)
     if (status.ok())
     {
         // The function name is already in the database.
+        TIBEE_COUNTER_ADD("db.function-names.existing", 1);
         return StringToUint32(idStr);
     }
+    TIBEE_COUNTER_ADD("db.function-names.added", 1);
 
     // Start a batch of writes to insert the function name in the database.
     leveldb::WriteBatch batch;
@@ -345,11 +360,16 @@ stacks::FunctionNameId Database::AddFunctionName(const std::string& name)
 
 const stacks::Stack& Database::GetStack(stacks::StackId id) const
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     auto look = _stacksCache.find(id);
     if (look != _stacksCache.end())
+    {
+        TIBEE_COUNTER_ADD("db.stacks-cache.hits", 1);
         return look->second;
+    }
+    TIBEE_COUNTER_ADD("db.stacks-cache.misses", 1);
 
     Key key;
     key.type = kStackIdType;
@@ -384,6 +404,7 @@ const stacks::Stack& Database::GetStack(stacks::StackId id) const
 
 stacks::StackId Database::AddStack(const stacks::Stack& stack)
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     // Check whether this stack is already in the database.
@@ -399,8 +420,10 @@ stacks::StackId Database::AddStack(const stacks::Stack& stack)
     if (status.ok())
     {
         // The stack is already in the database.
+        TIBEE_COUNTER_ADD("db.stacks.existing", 1);
         return StringToUint32(idStr);
     }
+    TIBEE_COUNTER_ADD("db.stacks.added", 1);
 
     // Start a batch of writes to insert the function name in the database.
     leveldb::WriteBatch batch;
@@ -444,6 +467,7 @@ void Database::EnumerateExecutions(
         uint64_t numDesired,
         const EnumerateExecutionsCallback& callback) const
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     auto executionNameId =
@@ -529,6 +553,7 @@ void Database::EnumerateExecutions(
 
 void Database::AddExecution(const execution::Execution& execution)
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     auto executionNameId = AddString(execution.name());
@@ -558,6 +583,76 @@ void Database::AddExecution(const execution::Execution& execution)
         throw base::ex::FatalError("Unable to insert execution in database.");
 }
 
+void Database::SetCheckpoint(const std::string& name,
+                             const Checkpoint& checkpoint)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    OpenDatabase();
+
+    Key key;
+    key.type = kCheckpointKeyType;
+    key.id = AddString(name);
+
+    auto status = _db->Put(leveldb::WriteOptions(),
+            Slice(&key, sizeof(key)),
+            Slice(&checkpoint, sizeof(checkpoint)));
+
+    if (!status.ok())
+        throw base::ex::FatalError("Unable to insert checkpoint in database.");
+}
+
+bool Database::GetCheckpoint(const std::string& name,
+                             Checkpoint* checkpoint) const
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    OpenDatabase();
+
+    Key key;
+    key.type = kCheckpointKeyType;
+    key.id = const_cast<Database*>(this)->AddString(name);
+
+    std::string value;
+    auto status = _db->Get(
+            leveldb::ReadOptions(), Slice(&key, sizeof(key)), &value);
+    if (!status.ok() || value.size() != sizeof(Checkpoint))
+        return false;
+
+    memcpy(checkpoint, value.data(), sizeof(Checkpoint));
+    return true;
+}
+
+void Database::SetTraceIngested(const std::string& identity)
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    OpenDatabase();
+
+    Key key;
+    key.type = kIngestedTraceKeyType;
+    key.id = AddString(identity);
+
+    auto status = _db->Put(leveldb::WriteOptions(),
+            Slice(&key, sizeof(key)),
+            leveldb::Slice());
+
+    if (!status.ok())
+        throw base::ex::FatalError("Unable to insert ingested trace in database.");
+}
+
+bool Database::IsTraceIngested(const std::string& identity) const
+{
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
+    OpenDatabase();
+
+    Key key;
+    key.type = kIngestedTraceKeyType;
+    key.id = const_cast<Database*>(this)->AddString(identity);
+
+    std::string value;
+    auto status = _db->Get(
+            leveldb::ReadOptions(), Slice(&key, sizeof(key)), &value);
+    return status.ok();
+}
+
 void Database::DestroyTestDb()
 {
     auto status = leveldb::DestroyDB(kTestDbFile, leveldb::Options());
@@ -567,6 +662,7 @@ void Database::DestroyTestDb()
 
 void Database::PrintStack(stacks::StackId id)
 {
+    std::lock_guard<std::recursive_mutex> lock(_mutex);
     OpenDatabase();
 
     if (id == stacks::kEmptyStackId)
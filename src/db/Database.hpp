@@ -23,6 +23,7 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 
 #include "base/BasicTypes.hpp"
@@ -35,6 +36,20 @@ namespace tibee
 namespace db
 {
 
+// Progress of an analysis, written each time its executions are saved.
+struct Checkpoint
+{
+    Checkpoint() : savedTs(0), replayTs(0) {}
+
+    // All the executions that end at or before this timestamp are in the
+    // database.
+    timestamp_t savedTs;
+
+    // Timestamp from which the trace must be analyzed again to rebuild the
+    // executions that were active at |savedTs|.
+    timestamp_t replayTs;
+};
+
 class Database
 {
 public:
@@ -63,6 +78,14 @@ public:
         const EnumerateExecutionsCallback& callback) const;
     void AddExecution(const execution::Execution& execution);
 
+    // Checkpoints, per analysis name.
+    void SetCheckpoint(const std::string& name, const Checkpoint& checkpoint);
+    bool GetCheckpoint(const std::string& name, Checkpoint* checkpoint) const;
+
+    // Traces whose executions were all saved, by identity.
+    void SetTraceIngested(const std::string& identity);
+    bool IsTraceIngested(const std::string& identity) const;
+
     // Destroy test database.
     static void DestroyTestDb();
 
@@ -99,6 +122,10 @@ private:
     // Cache for stacks.
     std::unordered_map<stacks::StackId, stacks::Stack> _stacksCache;
 
+    // Serializes the accesses to the database and to the caches, so that
+    // executions can be saved from background threads.
+    mutable std::recursive_mutex _mutex;
+
 };
 
 }  // namespace db
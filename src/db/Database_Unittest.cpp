@@ -166,6 +166,7 @@ TEST(Database, Execution)
     d.SetMetric(kDurationMetricId, 8);
     d.IncrementSample(7, 22);
     d.IncrementSample(8, 33);
+    d.FreezeSamples();
 
     db->AddExecution(d);
 
@@ -193,5 +194,59 @@ TEST(Database, Execution)
     executions.clear();
 }
 
+TEST(Database, Checkpoint)
+{
+    Database::DestroyTestDb();
+
+    std::unique_ptr<Database> db(new Database(true));
+
+    Checkpoint checkpoint;
+    EXPECT_FALSE(db->GetCheckpoint("mytrace", &checkpoint));
+
+    Checkpoint first;
+    first.savedTs = 2000;
+    first.replayTs = 1500;
+    db->SetCheckpoint("mytrace", first);
+
+    Checkpoint other;
+    other.savedTs = 7000;
+    other.replayTs = 7000;
+    db->SetCheckpoint("othertrace", other);
+
+    Checkpoint second;
+    second.savedTs = 4000;
+    second.replayTs = 3000;
+    db->SetCheckpoint("mytrace", second);
+
+    db.reset(nullptr);
+    db.reset(new Database(true));
+
+    EXPECT_TRUE(db->GetCheckpoint("mytrace", &checkpoint));
+    EXPECT_EQ(4000u, checkpoint.savedTs);
+    EXPECT_EQ(3000u, checkpoint.replayTs);
+
+    EXPECT_TRUE(db->GetCheckpoint("othertrace", &checkpoint));
+    EXPECT_EQ(7000u, checkpoint.savedTs);
+    EXPECT_EQ(7000u, checkpoint.replayTs);
+}
+
+TEST(Database, IngestedTraces)
+{
+    Database::DestroyTestDb();
+
+    std::unique_ptr<Database> db(new Database(true));
+
+    EXPECT_FALSE(db->IsTraceIngested("uuid-a/chunk-0"));
+    db->SetTraceIngested("uuid-a/chunk-0");
+    EXPECT_TRUE(db->IsTraceIngested("uuid-a/chunk-0"));
+    EXPECT_FALSE(db->IsTraceIngested("uuid-a/chunk-1"));
+
+    db.reset(nullptr);
+    db.reset(new Database(true));
+
+    EXPECT_TRUE(db->IsTraceIngested("uuid-a/chunk-0"));
+    EXPECT_FALSE(db->IsTraceIngested("uuid-a/chunk-1"));
+}
+
 }  // namespace db
 }  // namespace tibee
@@ -17,60 +17,28 @@
  */
 #include "disk/DiskRequests.hpp"
 
-#include <algorithm>
-
-#include "base/CleanContainer.hpp"
-#include "base/print.hpp"
-
 namespace tibee {
 namespace disk {
 
 namespace {
 
-void CallbackWrapper(
-    const containers::RedBlackIntervalTree<thread_t>::ElementPair& pair,
-    const DiskRequests::EnumerateCallback& callback)
-{
-  callback(pair.first, pair.second);
-}
-
-void CleanCallback(
-    const containers::RedBlackIntervalTree<thread_t>::ElementPair& pair,
-    containers::RedBlackIntervalTree<thread_t>* intervals)
-{
-  intervals->Insert(pair.first, pair.second);
-}
-
-void InsertCallback(
-  const containers::RedBlackIntervalTree<thread_t>::ElementPair& pair,
-  std::vector<std::pair<containers::Interval, thread_t>>* vec)
-{
-  vec->push_back(pair);
-}
+// Range of start timestamps covered by a bucket of disk requests (ns).
+const timestamp_t kBucketWidth = 100000000;  // 100 ms
 
 }  // namespace
 
 DiskRequests::DiskRequests()
+  : _ts(0), _intervals(kBucketWidth)
 {
-
 }
 
 DiskRequests::~DiskRequests()
 {
-
 }
 
 void DiskRequests::Cleanup(timestamp_t ts)
 {
-  namespace pl = std::placeholders;
-
-  containers::RedBlackIntervalTree<thread_t> newIntervals;
-  _intervals.EnumerateIntersection(
-    containers::Interval(ts, std::numeric_limits<uint64_t>::max()),
-    std::bind(CleanCallback, pl::_1, &newIntervals)
-  );
-
-  _intervals = std::move(newIntervals);
+  _intervals.RemoveEndingBefore(ts);
 }
 
 void DiskRequests::AddInterval(timestamp_t start, timestamp_t end, thread_t tid)
@@ -78,23 +46,14 @@ void DiskRequests::AddInterval(timestamp_t start, timestamp_t end, thread_t tid)
   _intervals.Insert(containers::Interval(start, end), tid);
 }
 
-void DiskRequests::EnumerateIntervals(timestamp_t start, timestamp_t end, const EnumerateCallback& callback) const
-{
-  namespace pl = std::placeholders;
-
-  _intervals.EnumerateIntersection(
-      containers::Interval(start, end),
-      std::bind(CallbackWrapper, pl::_1, std::ref(callback)));
-}
-
 std::vector<std::pair<containers::Interval, thread_t>> DiskRequests::GetIntervals(timestamp_t start, timestamp_t end) const
 {
-  namespace pl = std::placeholders;
-
   std::vector<std::pair<containers::Interval, thread_t>> vec;
   _intervals.EnumerateIntersection(
       containers::Interval(start, end),
-      std::bind(InsertCallback, pl::_1, &vec));
+      [&](const containers::BucketedIntervalIndex<thread_t>::ElementPair& pair) {
+        vec.push_back(pair);
+      });
   return vec;
 }
 
@@ -22,7 +22,7 @@
 #include <vector>
 
 #include "base/BasicTypes.hpp"
-#include "containers/RedBlackIntervalTree.hpp"
+#include "containers/BucketedIntervalIndex.hpp"
 
 namespace tibee {
 namespace disk {
@@ -43,13 +43,30 @@ public:
   // Removes everything that is before the specified timestamp.
   void Cleanup(timestamp_t ts);
 
+  // Approximate number of bytes used by the requests.
+  size_t ApproximateMemoryUsage() const {
+    return _intervals.ApproximateMemoryUsage();
+  }
+
   void AddInterval(timestamp_t start, timestamp_t end, thread_t tid);
-  void EnumerateIntervals(timestamp_t start, timestamp_t end, const EnumerateCallback& callback) const;
+
+  // Enumerate the requests that intersect [start, end]. The visitor
+  // receives (const containers::Interval& interval, thread_t thread).
+  template <typename Visitor>
+  void EnumerateIntervals(timestamp_t start, timestamp_t end, Visitor&& visitor) const
+  {
+    _intervals.EnumerateIntersection(
+        containers::Interval(start, end),
+        [&](const containers::BucketedIntervalIndex<thread_t>::ElementPair& pair) {
+          visitor(pair.first, pair.second);
+        });
+  }
+
   std::vector<std::pair<containers::Interval, thread_t>> GetIntervals(timestamp_t start, timestamp_t end) const;
 
 private:
   timestamp_t _ts;
-  containers::RedBlackIntervalTree<thread_t> _intervals;
+  containers::BucketedIntervalIndex<thread_t> _intervals;
 };
 
 }  // namespace disk
@@ -18,12 +18,18 @@
 #ifndef _TIBEE_EXECUTION_EXECUTION_HPP
 #define _TIBEE_EXECUTION_EXECUTION_HPP
 
+#include <algorithm>
+#include <array>
+#include <assert.h>
+#include <iterator>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "base/BasicTypes.hpp"
 #include "base/CompareConstants.hpp"
+#include "base/MemoryUsage.hpp"
 #include "stacks/Identifiers.hpp"
 
 namespace tibee
@@ -31,16 +37,80 @@ namespace tibee
 namespace execution
 {
 
+// Key of an empty slot of the samples hash table of an execution. Not a
+// static member: the pair constructor binds it to a reference, and this
+// class has no translation unit to define it in.
+const stacks::StackId kNoStackId = -1;
+
 class Execution
 {
 public:
     typedef std::unique_ptr<Execution> UP;
-    typedef std::unordered_map<MetricId, uint64_t> Metrics;
-    typedef std::unordered_map<stacks::StackId, uint64_t> Samples;
+    typedef std::pair<MetricId, uint64_t> Metric;
+    typedef std::pair<stacks::StackId, uint64_t> Sample;
+    typedef std::vector<Sample> Samples;
+
+    // Maximum number of metrics of an execution. Must be greater than
+    // kNumMetrics + kNumPerformanceCounters.
+    static const size_t kMaxMetrics = 64;
+
+    // Iterates over the metrics that are set, by increasing id.
+    class MetricsIterator
+        : public std::iterator<std::forward_iterator_tag, Metric>
+    {
+    public:
+        MetricsIterator() : _execution(nullptr), _mask(0) {}
+
+        const Metric& operator*() const { return _metric; }
+        const Metric* operator->() const { return &_metric; }
+
+        MetricsIterator& operator++() {
+            _mask &= _mask - 1;
+            Load();
+            return *this;
+        }
+        MetricsIterator operator++(int) {
+            MetricsIterator copy(*this);
+            ++(*this);
+            return copy;
+        }
+
+        bool operator==(const MetricsIterator& other) const {
+            return _mask == other._mask;
+        }
+        bool operator!=(const MetricsIterator& other) const {
+            return _mask != other._mask;
+        }
+
+    private:
+        friend class Execution;
+
+        MetricsIterator(const Execution* execution, uint64_t mask)
+            : _execution(execution), _mask(mask) {
+            Load();
+        }
+
+        void Load() {
+            if (_mask == 0)
+                return;
+            MetricId metricId = __builtin_ctzll(_mask);
+            _metric = Metric(metricId, _execution->_metrics[metricId]);
+        }
+
+        // Execution whose metrics are iterated.
+        const Execution* _execution;
+
+        // Metrics that remain to be visited.
+        uint64_t _mask;
+
+        // Current metric.
+        Metric _metric;
+    };
 
     Execution() 
         : _startTs(0), _startThread(-1),
-          _endTs(0), _endThread(-1) {}
+          _endTs(0), _endThread(-1),
+          _metricsMask(0), _numTableSamples(0) {}
     ~Execution() {}
 
     // Name of the execution.
@@ -69,59 +139,180 @@ public:
 
     // Metrics of the execution.
     size_t metrics_size() const {
-        return _metrics.size();
+        return __builtin_popcountll(_metricsMask);
     }
-    Metrics::const_iterator metrics_begin() const {
-        return _metrics.begin();
+    MetricsIterator metrics_begin() const {
+        return MetricsIterator(this, _metricsMask);
     }
-    Metrics::const_iterator metrics_end() const {
-        return _metrics.end();
+    MetricsIterator metrics_end() const {
+        return MetricsIterator(this, 0);
     }
 
     bool GetMetric(MetricId metricId, uint64_t* value) const {
-        auto look = _metrics.find(metricId);
-        if (look == _metrics.end())
+        if (metricId >= kMaxMetrics ||
+            (_metricsMask & (1ull << metricId)) == 0)
+        {
             return false;
-        *value = look->second;
+        }
+        *value = _metrics[metricId];
         return true;
     }
     void SetMetric(MetricId metricId, uint64_t value) {
+        assert(metricId < kMaxMetrics);
         _metrics[metricId] = value;
+        _metricsMask |= 1ull << metricId;
     }
 
-    // Samples of the execution.
+    // Samples of the execution. The samples are accumulated in a hash table
+    // until FreezeSamples() is called. Once frozen, they are kept in a
+    // vector sorted by stack id, which is what the iterators expose. The
+    // accessors freeze the samples if needed.
     size_t samples_size() const {
+        FreezeSampleTable();
         return _samples.size();
     }
     Samples::const_iterator samples_begin() const {
+        FreezeSampleTable();
         return _samples.begin();
     }
     Samples::const_iterator samples_end() const {
+        FreezeSampleTable();
         return _samples.end();
     }
+    bool samples_frozen() const {
+        return _sampleTable.empty();
+    }
+
     void IncrementSample(stacks::StackId stackId, uint64_t value) {
-        _samples[stackId] += value;
+        assert(stackId != kNoStackId);
+        if (_sampleTable.empty())
+            ThawSamples();
+        else if ((_numTableSamples + 1) * 2 > _sampleTable.size())
+            GrowSampleTable();
+
+        auto& sample = _sampleTable[FindSampleSlot(stackId)];
+        if (sample.first == kNoStackId)
+        {
+            sample.first = stackId;
+            ++_numTableSamples;
+        }
+        sample.second += value;
     }
     uint64_t GetSample(stacks::StackId stackId) const {
-        auto look = _samples.find(stackId);
-        if (look == _samples.end())
+        if (!_sampleTable.empty())
+        {
+            const auto& sample = _sampleTable[FindSampleSlot(stackId)];
+            return sample.first == stackId ? sample.second : 0;
+        }
+
+        auto look = std::lower_bound(
+            _samples.begin(), _samples.end(), Sample(stackId, 0),
+            [](const Sample& a, const Sample& b) { return a.first < b.first; });
+        if (look == _samples.end() || look->first != stackId)
             return 0;
         return look->second;
     }
 
-    // Equal operator.
+    // Moves the accumulated samples to a vector sorted by stack id.
+    void FreezeSamples() {
+        FreezeSampleTable();
+    }
+
+    // Approximate number of bytes used by the execution.
+    size_t ApproximateMemoryUsage() const {
+        return sizeof(*this) +
+            base::VectorMemoryUsage(_name) +
+            base::VectorMemoryUsage(_trace) +
+            base::VectorMemoryUsage(_samples) +
+            base::VectorMemoryUsage(_sampleTable);
+    }
+
+    // Equal operator. Freezes the samples of both executions.
     bool operator==(const Execution& other) const {
+        FreezeSampleTable();
+        other.FreezeSampleTable();
+        if (_metricsMask != other._metricsMask)
+            return false;
+        for (auto it = metrics_begin(); it != metrics_end(); ++it)
+        {
+            if (other._metrics[it->first] != it->second)
+                return false;
+        }
+
         return _name == other._name &&
             _trace == other._trace &&
             _startTs == other._startTs &&
             _startThread == other._startThread &&
             _endTs == other._endTs &&
             _endThread == other._endThread &&
-            _metrics == other._metrics &&
             _samples == other._samples;
     }
 
 private:
+    // Initial number of slots of the samples hash table.
+    static const size_t kInitialSampleTableSize = 16;
+
+    // Finds the slot of |stackId| in the samples hash table, or the empty
+    // slot where it would be inserted.
+    size_t FindSampleSlot(stacks::StackId stackId) const {
+        size_t mask = _sampleTable.size() - 1;
+        size_t slot = (stackId * 2654435761u) & mask;
+        while (_sampleTable[slot].first != stackId &&
+               _sampleTable[slot].first != kNoStackId)
+        {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    // Moves the samples of the hash table to a vector sorted by stack id.
+    // Only changes how the samples are stored, so it can be done lazily
+    // when the samples are read.
+    void FreezeSampleTable() const {
+        if (_sampleTable.empty())
+            return;
+
+        _samples.clear();
+        _samples.reserve(_numTableSamples);
+        for (const auto& sample : _sampleTable)
+        {
+            if (sample.first != kNoStackId)
+                _samples.push_back(sample);
+        }
+        std::sort(_samples.begin(), _samples.end());
+
+        Samples().swap(_sampleTable);
+        _numTableSamples = 0;
+    }
+
+    // Moves the frozen samples back to the hash table.
+    void ThawSamples() {
+        size_t size = kInitialSampleTableSize;
+        while (size < _samples.size() * 4)
+            size *= 2;
+        RebuildSampleTable(size, _samples);
+        Samples().swap(_samples);
+    }
+
+    // Doubles the number of slots of the samples hash table.
+    void GrowSampleTable() {
+        Samples samples;
+        samples.swap(_sampleTable);
+        RebuildSampleTable(samples.size() * 2, samples);
+    }
+
+    void RebuildSampleTable(size_t size, const Samples& samples) {
+        _sampleTable.assign(size, Sample(kNoStackId, 0));
+        _numTableSamples = 0;
+        for (const auto& sample : samples)
+        {
+            if (sample.first == kNoStackId)
+                continue;
+            _sampleTable[FindSampleSlot(sample.first)] = sample;
+            ++_numTableSamples;
+        }
+    }
+
     // Name of the execution.
     std::string _name;
 
@@ -140,11 +331,22 @@ private:
     // End thread of the execution.
     thread_t _endThread;
 
-    // Metrics of the execution.
-    Metrics _metrics;
+    // Metrics of the execution, indexed by metric id.
+    std::array<uint64_t, kMaxMetrics> _metrics;
+
+    // Bit i is set if metric i is set.
+    uint64_t _metricsMask;
+
+    // Frozen samples of the execution, sorted by stack id. Mutable so that
+    // the accessors can freeze the samples.
+    mutable Samples _samples;
+
+    // Samples hash table with linear probing. Empty while the samples
+    // are frozen.
+    mutable Samples _sampleTable;
 
-    // Samples of the execution.
-    Samples _samples;
+    // Number of used slots in |_sampleTable|.
+    mutable size_t _numTableSamples;
 };
 
 }  // namespace execution
@@ -0,0 +1,131 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "execution/ExecutionWindows.hpp"
+
+#include <algorithm>
+
+#include "base/SortedSearch.hpp"
+
+namespace tibee
+{
+namespace execution
+{
+
+ExecutionWindows::ExecutionWindows()
+    : _selective(false),
+      _cursor(0)
+{
+}
+
+ExecutionWindows::~ExecutionWindows()
+{
+}
+
+void ExecutionWindows::AddWindow(timestamp_t begin, timestamp_t end)
+{
+    _windows.push_back(Window(begin, std::max(begin, end)));
+}
+
+void ExecutionWindows::Merge(timestamp_t margin)
+{
+    for (auto& window : _windows)
+        window.first = window.first > margin ? window.first - margin : 0;
+    std::sort(_windows.begin(), _windows.end());
+
+    std::vector<Window> merged;
+    for (const auto& window : _windows)
+    {
+        if (!merged.empty() && window.first <= merged.back().second)
+            merged.back().second = std::max(merged.back().second, window.second);
+        else
+            merged.push_back(window);
+    }
+    _windows.swap(merged);
+    _cursor = 0;
+}
+
+bool ExecutionWindows::Contains(timestamp_t ts) const
+{
+    if (!_selective)
+        return true;
+
+    // First window that ends at or after |ts|.
+    _cursor = base::GallopingPartitionPoint(
+        _windows.size(), _cursor,
+        [&](size_t i) { return _windows[i].second >= ts; });
+    return _cursor < _windows.size() && _windows[_cursor].first <= ts;
+}
+
+void ExecutionWindows::ClipBefore(timestamp_t ts)
+{
+    if (!_selective)
+    {
+        _windows.assign(1, Window(ts, -1));
+        _selective = true;
+        _cursor = 0;
+        return;
+    }
+
+    auto it = std::find_if(_windows.begin(), _windows.end(),
+                           [&](const Window& window) {
+                               return window.second >= ts;
+                           });
+    _windows.erase(_windows.begin(), it);
+    if (!_windows.empty())
+        _windows.front().first = std::max(_windows.front().first, ts);
+    _cursor = 0;
+}
+
+timestamp_t ExecutionWindows::Coverage() const
+{
+    timestamp_t coverage = 0;
+    for (const auto& window : _windows)
+        coverage += window.second - window.first;
+    return coverage;
+}
+
+void ExecutionWindows::Split(size_t numSlices,
+                             std::vector<ExecutionWindows>* slices) const
+{
+    slices->clear();
+    if (numSlices == 0)
+        numSlices = 1;
+
+    timestamp_t total = Coverage();
+    timestamp_t covered = 0;
+    for (const auto& window : _windows)
+    {
+        // Start a new slice when the middle of the window is past the share
+        // of the current slice.
+        timestamp_t length = window.second - window.first;
+        if (slices->empty() ||
+            (slices->size() < numSlices &&
+             covered + length / 2 >= total / numSlices * slices->size()))
+        {
+            slices->push_back(ExecutionWindows());
+            slices->back().SetSelective(true);
+            slices->back()._threads = _threads;
+        }
+
+        slices->back()._windows.push_back(window);
+        covered += length;
+    }
+}
+
+}  // namespace execution
+}  // namespace tibee
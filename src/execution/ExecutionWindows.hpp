@@ -0,0 +1,104 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_EXECUTION_EXECUTIONWINDOWS_HPP_
+#define TIBEE_EXECUTION_EXECUTIONWINDOWS_HPP_
+
+#include <utility>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+
+namespace tibee
+{
+namespace execution
+{
+
+/**
+ * Time windows in which executions occur.
+ *
+ * The windows are found by a first pass over the trace. When the windows
+ * are selective, the expensive analyses only process the events that are
+ * inside a window during the second pass. The first pass also finds the
+ * threads that the executions depend on.
+ *
+ * @author Francois Doray
+ */
+class ExecutionWindows {
+public:
+    typedef std::pair<timestamp_t, timestamp_t> Window;
+
+    ExecutionWindows();
+    ~ExecutionWindows();
+
+    // Only process the events that are inside a window.
+    void SetSelective(bool selective) { _selective = selective; }
+    bool selective() const { return _selective; }
+
+    // Add a window. Windows can be added in any order and can overlap.
+    void AddWindow(timestamp_t begin, timestamp_t end);
+
+    // Widens each window by |margin| before its beginning, then sorts the
+    // windows and merges those that overlap.
+    void Merge(timestamp_t margin);
+
+    // Indicates whether a timestamp is inside a window. Always true when
+    // the windows are not selective. The windows must have been merged.
+    // Queries that move forward in time are amortized O(1).
+    bool Contains(timestamp_t ts) const;
+
+    // Excludes the timestamps before |ts|. The windows become selective.
+    // The windows must have been merged.
+    void ClipBefore(timestamp_t ts);
+
+    // Total duration covered by the windows.
+    timestamp_t Coverage() const;
+
+    // Splits the merged windows into at most |numSlices| groups of
+    // consecutive windows that cover similar durations. Each group is
+    // selective. Since merged windows don't overlap, the boundaries of the
+    // groups fall between executions.
+    void Split(size_t numSlices, std::vector<ExecutionWindows>* slices) const;
+
+    // The windows.
+    const std::vector<Window>& windows() const { return _windows; }
+
+    // Add a thread that the executions depend on.
+    void AddThread(thread_t thread) { _threads.push_back(thread); }
+
+    // The threads that the executions depend on. Each slice has all of
+    // them.
+    const std::vector<thread_t>& threads() const { return _threads; }
+
+private:
+    // Indicates whether only the events inside a window are processed.
+    bool _selective;
+
+    // The windows.
+    std::vector<Window> _windows;
+
+    // The threads that the executions depend on.
+    std::vector<thread_t> _threads;
+
+    // Index of the window found by the last query.
+    mutable size_t _cursor;
+};
+
+}  // namespace execution
+}  // namespace tibee
+
+#endif  // TIBEE_EXECUTION_EXECUTIONWINDOWS_HPP_
@@ -0,0 +1,140 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include "execution/ExecutionWindows.hpp"
+
+namespace tibee
+{
+namespace execution
+{
+
+TEST(ExecutionWindows, NotSelective)
+{
+    ExecutionWindows windows;
+    windows.AddWindow(10, 20);
+    windows.Merge(0);
+
+    EXPECT_TRUE(windows.Contains(5));
+    EXPECT_TRUE(windows.Contains(15));
+    EXPECT_TRUE(windows.Contains(25));
+}
+
+TEST(ExecutionWindows, Merge)
+{
+    ExecutionWindows windows;
+    windows.AddWindow(50, 60);
+    windows.AddWindow(10, 20);
+    windows.AddWindow(15, 30);
+    windows.AddWindow(38, 40);
+    windows.AddWindow(3, 4);
+    windows.Merge(5);
+
+    std::vector<ExecutionWindows::Window> expected {
+        {0, 4}, {5, 30}, {33, 40}, {45, 60}};
+    EXPECT_EQ(expected, windows.windows());
+    EXPECT_EQ(4u + 25u + 7u + 15u, windows.Coverage());
+}
+
+TEST(ExecutionWindows, Contains)
+{
+    ExecutionWindows windows;
+    windows.SetSelective(true);
+    windows.AddWindow(10, 20);
+    windows.AddWindow(30, 40);
+    windows.Merge(0);
+
+    EXPECT_FALSE(windows.Contains(5));
+    EXPECT_TRUE(windows.Contains(10));
+    EXPECT_TRUE(windows.Contains(20));
+    EXPECT_FALSE(windows.Contains(25));
+    EXPECT_TRUE(windows.Contains(35));
+    EXPECT_FALSE(windows.Contains(45));
+
+    // Queries can move backward in time.
+    EXPECT_TRUE(windows.Contains(15));
+    EXPECT_FALSE(windows.Contains(0));
+    EXPECT_TRUE(windows.Contains(40));
+}
+
+TEST(ExecutionWindows, ClipBefore)
+{
+    ExecutionWindows all;
+    all.ClipBefore(50);
+    EXPECT_TRUE(all.selective());
+    EXPECT_FALSE(all.Contains(49));
+    EXPECT_TRUE(all.Contains(50));
+    EXPECT_TRUE(all.Contains(1000000));
+
+    ExecutionWindows windows;
+    windows.SetSelective(true);
+    windows.AddWindow(10, 20);
+    windows.AddWindow(30, 40);
+    windows.AddWindow(50, 60);
+    windows.Merge(0);
+    windows.ClipBefore(35);
+
+    std::vector<ExecutionWindows::Window> expected {{35, 40}, {50, 60}};
+    EXPECT_EQ(expected, windows.windows());
+    EXPECT_FALSE(windows.Contains(15));
+    EXPECT_FALSE(windows.Contains(34));
+    EXPECT_TRUE(windows.Contains(35));
+    EXPECT_TRUE(windows.Contains(55));
+}
+
+TEST(ExecutionWindows, Split)
+{
+    ExecutionWindows windows;
+    windows.AddWindow(0, 10);
+    windows.AddWindow(20, 30);
+    windows.AddWindow(40, 50);
+    windows.AddWindow(60, 100);
+    windows.Merge(0);
+    windows.AddThread(42);
+
+    std::vector<ExecutionWindows> slices;
+    windows.Split(2, &slices);
+    ASSERT_EQ(2u, slices.size());
+
+    std::vector<ExecutionWindows::Window> expected0 {
+        {0, 10}, {20, 30}, {40, 50}};
+    std::vector<ExecutionWindows::Window> expected1 {{60, 100}};
+    EXPECT_EQ(expected0, slices[0].windows());
+    EXPECT_EQ(expected1, slices[1].windows());
+
+    EXPECT_TRUE(slices[0].selective());
+    EXPECT_TRUE(slices[0].Contains(45));
+    EXPECT_FALSE(slices[0].Contains(70));
+    EXPECT_TRUE(slices[1].Contains(70));
+
+    // Each slice depends on all the threads.
+    std::vector<thread_t> expectedThreads {42};
+    EXPECT_EQ(expectedThreads, slices[0].threads());
+    EXPECT_EQ(expectedThreads, slices[1].threads());
+
+    // There are never more slices than windows.
+    windows.Split(10, &slices);
+    EXPECT_EQ(4u, slices.size());
+
+    windows.Split(1, &slices);
+    ASSERT_EQ(1u, slices.size());
+    EXPECT_EQ(windows.windows(), slices[0].windows());
+}
+
+}  // namespace execution
+}  // namespace tibee
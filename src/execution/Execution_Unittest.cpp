@@ -15,6 +15,8 @@
  * You should have received a copy of the GNU General Public License
  * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <vector>
+
 #include "gtest/gtest.h"
 
 #include "execution/Execution.hpp"
@@ -56,5 +58,94 @@ TEST(Execution, Execution)
     EXPECT_EQ(kEndThread, execution.endThread());
 }
 
+TEST(Execution, Metrics)
+{
+    Execution execution;
+    uint64_t value = 0;
+    EXPECT_EQ(0u, execution.metrics_size());
+    EXPECT_FALSE(execution.GetMetric(kDurationMetricId, &value));
+
+    execution.SetMetric(kTsMetricId, 3);
+    execution.SetMetric(kDurationMetricId, 1);
+    execution.SetMetric(kDurationMetricId, 2);
+    execution.SetMetric(Execution::kMaxMetrics - 1, 4);
+    EXPECT_EQ(3u, execution.metrics_size());
+
+    EXPECT_TRUE(execution.GetMetric(kDurationMetricId, &value));
+    EXPECT_EQ(2u, value);
+    EXPECT_FALSE(execution.GetMetric(kNumCustomMetrics, &value));
+
+    std::vector<Execution::Metric> metrics(
+        execution.metrics_begin(), execution.metrics_end());
+    std::vector<Execution::Metric> expected({
+        Execution::Metric(kDurationMetricId, 2),
+        Execution::Metric(kTsMetricId, 3),
+        Execution::Metric(Execution::kMaxMetrics - 1, 4)});
+    EXPECT_EQ(expected, metrics);
+}
+
+TEST(Execution, Samples)
+{
+    Execution execution;
+    EXPECT_TRUE(execution.samples_frozen());
+    EXPECT_EQ(0u, execution.samples_size());
+
+    // Enough samples to grow the hash table a few times.
+    for (stacks::StackId stackId = 100; stackId > 0; --stackId)
+        execution.IncrementSample(stackId, stackId);
+    execution.IncrementSample(stacks::kEmptyStackId, 5);
+    execution.IncrementSample(42, 1);
+    EXPECT_FALSE(execution.samples_frozen());
+    EXPECT_EQ(43u, execution.GetSample(42));
+    EXPECT_EQ(5u, execution.GetSample(stacks::kEmptyStackId));
+    EXPECT_EQ(0u, execution.GetSample(101));
+
+    execution.FreezeSamples();
+    EXPECT_TRUE(execution.samples_frozen());
+    ASSERT_EQ(101u, execution.samples_size());
+    stacks::StackId expectedStackId = stacks::kEmptyStackId;
+    for (auto it = execution.samples_begin(); it != execution.samples_end(); ++it)
+    {
+        EXPECT_EQ(expectedStackId, it->first);
+        ++expectedStackId;
+    }
+    EXPECT_EQ(43u, execution.GetSample(42));
+    EXPECT_EQ(100u, execution.GetSample(100));
+    EXPECT_EQ(0u, execution.GetSample(101));
+
+    // Incrementing a frozen execution moves the samples back to the table.
+    execution.IncrementSample(101, 7);
+    EXPECT_FALSE(execution.samples_frozen());
+    execution.FreezeSamples();
+    EXPECT_EQ(102u, execution.samples_size());
+    EXPECT_EQ(7u, execution.GetSample(101));
+    EXPECT_EQ(43u, execution.GetSample(42));
+
+    // Reading the samples freezes them.
+    execution.IncrementSample(102, 8);
+    EXPECT_FALSE(execution.samples_frozen());
+    EXPECT_EQ(103u, execution.samples_size());
+    EXPECT_TRUE(execution.samples_frozen());
+    EXPECT_EQ(102u, (execution.samples_end() - 1)->first);
+}
+
+TEST(Execution, Equal)
+{
+    Execution a;
+    Execution b;
+    a.SetMetric(kDurationMetricId, 1);
+    b.SetMetric(kDurationMetricId, 1);
+    a.IncrementSample(1, 2);
+    a.IncrementSample(3, 4);
+    b.IncrementSample(3, 4);
+    b.IncrementSample(1, 2);
+    a.FreezeSamples();
+    b.FreezeSamples();
+    EXPECT_TRUE(a == b);
+
+    b.SetMetric(kTsMetricId, 0);
+    EXPECT_FALSE(a == b);
+}
+
 }  // namespace execution
 }  // namespace tibee
@@ -17,6 +17,10 @@
  */
 #include "execution/ExecutionsBuilder.hpp"
 
+#include <algorithm>
+
+#include "base/MemoryUsage.hpp"
+
 namespace tibee
 {
 namespace execution
@@ -36,8 +40,21 @@ bool ExecutionsBuilder::StartExecution(
     const std::string& name,
     bool needsToEnd)
 {
+    // Find the execution with the same name, or add one.
+    auto& executions = _activeExecutions[thread];
+    auto it = std::find_if(
+        executions.begin(), executions.end(),
+        [&](const ActiveExecution& active) {
+            return active.execution->name() == name;
+        });
+    if (it == executions.end())
+    {
+        executions.push_back(ActiveExecution());
+        it = executions.end() - 1;
+    }
+
     // Create execution.
-    Execution::UP& execution = _activeExecutions[thread];
+    Execution::UP& execution = it->execution;
     execution.reset(new Execution);
 
     execution->set_name(name);
@@ -47,37 +64,104 @@ bool ExecutionsBuilder::StartExecution(
     execution->set_endThread(thread);
 
     // Remember whether the execution needs to end.
-    _needsToEnd[thread] = needsToEnd;
+    it->needsToEnd = needsToEnd;
 
     return true;
 }
 
-timestamp_t ExecutionsBuilder::EndExecution(thread_t thread)
+timestamp_t ExecutionsBuilder::EndExecution(
+    thread_t thread, const std::string& name)
 {
     auto look = _activeExecutions.find(thread);
     if (look == _activeExecutions.end())
         return 0;
 
-    timestamp_t start = look->second->startTs();
-    look->second->set_endTs(_ts);
-    look->second->set_endThread(thread);
-    _completedExecutions.push_back(std::move(look->second));
+    auto& executions = look->second;
+    auto it = std::find_if(
+        executions.begin(), executions.end(),
+        [&](const ActiveExecution& active) {
+            return active.execution->name() == name;
+        });
+    if (it == executions.end())
+        return 0;
+
+    timestamp_t duration = EndExecution(&*it);
+    executions.erase(it);
+    if (executions.empty())
+        _activeExecutions.erase(look);
 
-    _activeExecutions.erase(look);
+    return duration;
+}
+
+timestamp_t ExecutionsBuilder::EndExecution(ActiveExecution* active)
+{
+    auto& execution = active->execution;
+    timestamp_t start = execution->startTs();
+    execution->set_endTs(_ts);
+    execution->set_endThread(execution->startThread());
+    _completedExecutions.push_back(std::move(execution));
 
     return _ts - start;
 }
 
+bool ExecutionsBuilder::GetOldestActiveStartTs(timestamp_t* ts) const
+{
+    if (_activeExecutions.empty())
+        return false;
+
+    *ts = -1;
+    for (const auto& executions : _activeExecutions)
+    {
+        for (const auto& active : executions.second)
+            *ts = std::min(*ts, active.execution->startTs());
+    }
+    return true;
+}
+
+void ExecutionsBuilder::TakeCompletedExecutions(
+    timestamp_t ts, Executions* executions)
+{
+    auto it = _completedExecutions.begin();
+    for (; it != _completedExecutions.end() && (*it)->endTs() <= ts; ++it)
+        executions->push_back(std::move(*it));
+    _completedExecutions.erase(_completedExecutions.begin(), it);
+}
+
 void ExecutionsBuilder::Terminate()
 {
-    for (const auto& needsToEnd : _needsToEnd)
+    for (auto it = _activeExecutions.begin(); it != _activeExecutions.end();)
+    {
+        auto& executions = it->second;
+        auto end = std::remove_if(
+            executions.begin(), executions.end(),
+            [&](ActiveExecution& active) {
+                if (active.needsToEnd)
+                    return false;
+                EndExecution(&active);
+                return true;
+            });
+        executions.erase(end, executions.end());
+
+        if (executions.empty())
+            it = _activeExecutions.erase(it);
+        else
+            ++it;
+    }
+}
+
+size_t ExecutionsBuilder::ApproximateMemoryUsage() const
+{
+    size_t usage = base::VectorMemoryUsage(_completedExecutions) +
+                   base::HashMapMemoryUsage(_activeExecutions);
+    for (const auto& execution : _completedExecutions)
+        usage += execution->ApproximateMemoryUsage();
+    for (const auto& executions : _activeExecutions)
     {
-        if (!needsToEnd.second)
-        {
-            auto thread = needsToEnd.first;
-            EndExecution(thread);
-        }
+        usage += base::VectorMemoryUsage(executions.second);
+        for (const auto& active : executions.second)
+            usage += active.execution->ApproximateMemoryUsage();
     }
+    return usage;
 }
 
 }  // namespace execution
@@ -40,18 +40,33 @@ public:
     // Set current state.
     void SetTimestamp(timestamp_t ts) { _ts = ts; }
 
-    // Create execution.
+    // Create execution. A thread can have one active execution per name,
+    // so that executions of different definitions can overlap.
     bool StartExecution(
         thread_t thread,
         const std::string& name,
         bool needsToEnd);
 
-    // End an execution.
-    timestamp_t EndExecution(thread_t thread);
+    // End the active execution with the specified name on a thread.
+    // @returns the duration of the execution, or 0 if there is no such
+    //     active execution.
+    timestamp_t EndExecution(thread_t thread, const std::string& name);
 
     // Complete active executions that don't need to end.
     void Terminate();
 
+    // Approximate number of bytes used by the active and completed
+    // executions.
+    size_t ApproximateMemoryUsage() const;
+
+    // Get the start time of the oldest active execution.
+    // @returns false if there is no active execution.
+    bool GetOldestActiveStartTs(timestamp_t* ts) const;
+
+    // Move the completed executions that end at or before |ts| to
+    // |executions|. Executions are completed by increasing end time.
+    void TakeCompletedExecutions(timestamp_t ts, Executions* executions);
+
     // Clear the list of completed executions.
     void Flush() {
         _completedExecutions.clear();
@@ -72,11 +87,20 @@ private:
     // Completed executions.
     Executions _completedExecutions;
 
-    // Active executions.
-    std::unordered_map<thread_t, Execution::UP> _activeExecutions;
+    struct ActiveExecution
+    {
+        Execution::UP execution;
+
+        // Indicates whether the execution needs to end.
+        bool needsToEnd;
+    };
+    typedef std::vector<ActiveExecution> ActiveExecutions;
+
+    // Moves an active execution to the completed executions.
+    timestamp_t EndExecution(ActiveExecution* active);
 
-    // Indicates whether the current executions needs to end.
-    std::unordered_map<thread_t, bool> _needsToEnd;
+    // Active executions, per thread.
+    std::unordered_map<thread_t, ActiveExecutions> _activeExecutions;
 };
 
 }  // namespace execution
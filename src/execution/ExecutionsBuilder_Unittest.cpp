@@ -42,7 +42,7 @@ TEST(ExecutionsBuilder, Simple)
     builder.SetTimestamp(10);
     builder.StartExecution(kThreadA, kNameA, true);
     builder.SetTimestamp(20);
-    builder.EndExecution(kThreadA);
+    builder.EndExecution(kThreadA, kNameA);
 
     auto it = builder.begin();
     ASSERT_NE(it, builder.end());
@@ -82,7 +82,112 @@ TEST(ExecutionsBuilder, Terminate)
     ++it;
     EXPECT_EQ(builder.end(), it);
 }
+TEST(ExecutionsBuilder, OverlappingNames)
+{
+    ExecutionsBuilder builder;
+
+    builder.SetTimestamp(10);
+    builder.StartExecution(kThreadA, kNameA, true);
+    builder.SetTimestamp(15);
+    builder.StartExecution(kThreadA, kNameB, true);
+
+    // Ending an execution that isn't active on the thread does nothing.
+    builder.SetTimestamp(20);
+    EXPECT_EQ(0u, builder.EndExecution(kThreadB, kNameA));
+    EXPECT_EQ(builder.end(), builder.begin());
+
+    EXPECT_EQ(5u, builder.EndExecution(kThreadA, kNameB));
+    builder.SetTimestamp(30);
+    EXPECT_EQ(20u, builder.EndExecution(kThreadA, kNameA));
+    EXPECT_EQ(0u, builder.EndExecution(kThreadA, kNameA));
+
+    auto it = builder.begin();
+    ASSERT_NE(it, builder.end());
+    EXPECT_EQ(kNameB, (*it)->name());
+    EXPECT_EQ(15u, (*it)->startTs());
+    EXPECT_EQ(20u, (*it)->endTs());
+    ++it;
+    ASSERT_NE(it, builder.end());
+    EXPECT_EQ(kNameA, (*it)->name());
+    EXPECT_EQ(10u, (*it)->startTs());
+    EXPECT_EQ(30u, (*it)->endTs());
+    ++it;
+    EXPECT_EQ(builder.end(), it);
+}
 
+TEST(ExecutionsBuilder, GetOldestActiveStartTs)
+{
+    ExecutionsBuilder builder;
+    timestamp_t ts = 0;
+    EXPECT_FALSE(builder.GetOldestActiveStartTs(&ts));
+
+    builder.SetTimestamp(10);
+    builder.StartExecution(kThreadA, kNameA, true);
+    builder.SetTimestamp(15);
+    builder.StartExecution(kThreadB, kNameB, true);
+
+    EXPECT_TRUE(builder.GetOldestActiveStartTs(&ts));
+    EXPECT_EQ(10u, ts);
+
+    builder.SetTimestamp(20);
+    builder.EndExecution(kThreadA, kNameA);
+    EXPECT_TRUE(builder.GetOldestActiveStartTs(&ts));
+    EXPECT_EQ(15u, ts);
+
+    builder.EndExecution(kThreadB, kNameB);
+    EXPECT_FALSE(builder.GetOldestActiveStartTs(&ts));
+}
+
+TEST(ExecutionsBuilder, ApproximateMemoryUsage)
+{
+    ExecutionsBuilder builder;
+    size_t emptyUsage = builder.ApproximateMemoryUsage();
+
+    builder.SetTimestamp(10);
+    builder.StartExecution(kThreadA, kNameA, true);
+    size_t activeUsage = builder.ApproximateMemoryUsage();
+    EXPECT_GE(activeUsage, emptyUsage + sizeof(Execution));
+
+    ExecutionsBuilder::Executions executions;
+    builder.SetTimestamp(20);
+    builder.EndExecution(kThreadA, kNameA);
+    builder.TakeCompletedExecutions(20, &executions);
+    EXPECT_LT(builder.ApproximateMemoryUsage(), activeUsage);
+}
+
+TEST(ExecutionsBuilder, TakeCompletedExecutions)
+{
+    ExecutionsBuilder builder;
+    ExecutionsBuilder::Executions executions;
+
+    builder.SetTimestamp(10);
+    builder.StartExecution(kThreadA, kNameA, true);
+    builder.SetTimestamp(15);
+    builder.StartExecution(kThreadB, kNameB, true);
+    builder.SetTimestamp(20);
+    builder.EndExecution(kThreadA, kNameA);
+    builder.SetTimestamp(30);
+    builder.EndExecution(kThreadB, kNameB);
+
+    builder.TakeCompletedExecutions(19, &executions);
+    EXPECT_TRUE(executions.empty());
+
+    builder.TakeCompletedExecutions(25, &executions);
+    ASSERT_EQ(1u, executions.size());
+    EXPECT_EQ(kNameA, executions[0]->name());
+    EXPECT_EQ(20u, executions[0]->endTs());
+
+    auto it = builder.begin();
+    ASSERT_NE(it, builder.end());
+    EXPECT_EQ(kNameB, (*it)->name());
+    ++it;
+    EXPECT_EQ(builder.end(), it);
+
+    builder.TakeCompletedExecutions(30, &executions);
+    ASSERT_EQ(2u, executions.size());
+    EXPECT_EQ(kNameB, executions[1]->name());
+    EXPECT_EQ(builder.end(), builder.begin());
+}
 
 }  // namespace execution
 }  // namespace tibee
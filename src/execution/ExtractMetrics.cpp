@@ -17,8 +17,9 @@
  */
 #include "execution/ExtractMetrics.hpp"
 
+#include <vector>
+
 #include "base/CompareConstants.hpp"
-#include "base/Constants.hpp"
 #include "base/print.hpp"
 
 namespace tibee
@@ -64,60 +65,69 @@ void ExtractTimingMetrics(
 
 void ExtractPerformanceCounterMetrics(
     const critical::CriticalPath& criticalPath,
-    const state::StateHistory& stateHistory,
-    state::CurrentState* currentState,
-    quark::StringQuarkDatabase* quarks,
+    const state::PerfCountersHistory& perfCountersHistory,
     Execution* execution)
 {
-    // Path for thread state.
-    state::AttributePathStr threadStatePath {kStateLinux, kStateThreads};
-    auto threadStateKey = currentState->GetAttributeKeyStr(threadStatePath);
+    size_t numColumns = perfCountersHistory.NumColumns();
+    if (numColumns == 0)
+        return;
 
-    // Traverse all performance counters.
-    for (size_t i = 0; i < kNumPerformanceCounters; ++i)
+    // Get the rows at both ends of each run segment in a single batch.
+    std::vector<state::PerfCountersHistory::Query> queries;
+    for (const auto& segment : criticalPath)
     {
-        quark::Quark counterQuark = quarks->StrQuark(kPerformanceCounters[i]);
-        MetricId metricId = kPerformanceCounterFirstMetricId + i;
+        if (segment.type() != critical::kRun)
+            continue;
+        queries.push_back(state::PerfCountersHistory::Query(
+            segment.tid(), segment.startTs()));
+        queries.push_back(state::PerfCountersHistory::Query(
+            segment.tid(), segment.endTs()));
+    }
 
-        for (const auto& segment : criticalPath)
+    std::vector<state::PerfCountersHistory::Row> rows;
+    perfCountersHistory.GetRows(queries, &rows);
+
+    // Sum of the counters on all run segments, for each column.
+    std::vector<uint64_t> totals(numColumns, 0);
+
+    for (size_t i = 0; i < rows.size(); i += 2)
+    {
+        const auto& beginRow = rows[i];
+        const auto& endRow = rows[i + 1];
+        if (beginRow.values == nullptr || endRow.values == nullptr)
+            continue;
+
+        // Only count the columns that have a value at both ends.
+        uint64_t mask = beginRow.mask & endRow.mask;
+        const uint64_t* beginValues = beginRow.values;
+        const uint64_t* endValues = endRow.values;
+        for (size_t column = 0; column < numColumns; ++column)
         {
-            if (segment.type() != critical::kRun)
-                continue;
-
-            auto counterKey = currentState->GetAttributeKey(
-                threadStateKey, {currentState->IntQuark(segment.tid()), counterQuark});
-
-            uint64_t beginValue = 0;
-            uint64_t endValue = 0;
-            if (!stateHistory.GetULongValue(counterKey, segment.startTs(), &beginValue) ||
-                !stateHistory.GetULongValue(counterKey, segment.endTs(), &endValue))
-            {
-                continue;
-            }
-
-            uint64_t segmentValue = endValue - beginValue;
-            if (segmentValue != 0)
-            {
-                uint64_t currentValue = 0;
-                execution->GetMetric(metricId, &currentValue);
-                execution->SetMetric(metricId, currentValue + segmentValue);
-            }
+            uint64_t valid = 0 - ((mask >> column) & 1);
+            totals[column] += (endValues[column] - beginValues[column]) & valid;
         }
     }
+
+    for (size_t column = 0; column < numColumns; ++column)
+    {
+        if (totals[column] == 0)
+            continue;
+        MetricId metricId = kPerformanceCounterFirstMetricId +
+            perfCountersHistory.CounterForColumn(column);
+        execution->SetMetric(metricId, totals[column]);
+    }
 }
 
 }  // namespace
 
 void ExtractMetrics(
         const critical::CriticalPath& criticalPath,
-        const state::StateHistory& stateHistory,
-        state::CurrentState* currentState,
-        quark::StringQuarkDatabase* quarks,
+        const state::PerfCountersHistory& perfCountersHistory,
         Execution* execution)
 {
     ExtractTimingMetrics(criticalPath, execution);
     ExtractPerformanceCounterMetrics(
-        criticalPath, stateHistory, currentState, quarks, execution);
+        criticalPath, perfCountersHistory, execution);
 }
 
 }  // namespace execution
@@ -20,9 +20,7 @@
 
 #include "critical/CriticalPath.hpp"
 #include "execution/Execution.hpp"
-#include "quark/StringQuarkDatabase.hpp"
-#include "state/CurrentState.hpp"
-#include "state/StateHistory.hpp"
+#include "state/PerfCountersHistory.hpp"
 
 namespace tibee
 {
@@ -31,9 +29,7 @@ namespace execution
 
 void ExtractMetrics(
     const critical::CriticalPath& criticalPath,
-    const state::StateHistory& stateHistory,
-    state::CurrentState* currentState,
-    quark::StringQuarkDatabase* quarks,
+    const state::PerfCountersHistory& perfCountersHistory,
     Execution* execution);
 
 }  // namespace execution
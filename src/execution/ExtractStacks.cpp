@@ -18,12 +18,11 @@
 #include "execution/ExtractStacks.hpp"
 
 #include <assert.h>
-#include <deque>
 #include <iostream>
+#include <unordered_map>
 #include <vector>
 
 #include "base/BasicTypes.hpp"
-#include "base/BindObject.hpp"
 #include "base/Constants.hpp"
 #include "critical/ComputeCriticalPath.hpp"
 #include "critical/GetStatusString.hpp"
@@ -47,10 +46,11 @@ public:
         const disk::DiskRequests& diskRequests,
         state::CurrentState* currentState,
         db::Database* db,
+        StackConcatenator* concatenator,
         Execution* execution)
         : stacks(stacks), graph(graph), stateHistory(stateHistory),
           diskRequests(diskRequests), currentState(currentState),
-          db(db), execution(execution)
+          db(db), concatenator(concatenator), execution(execution)
     {
         state::AttributePathStr threadsPath { kStateLinux, kStateThreads };
         threadsPathKey = currentState->GetAttributeKeyStr(threadsPath);
@@ -64,18 +64,27 @@ public:
     void ExtractStacks(const critical::CriticalPath& criticalPath,
                        stacks::StackId baseStackId)
     {
-        namespace pl = std::placeholders;
-
         // Stack of threads.
         std::vector<ThreadInfo> threads;
 
+        // Last CPU of the thread of each wait-cpu segment.
+        std::vector<state::StateHistory::UIntegerResult> lastCpus;
+        GetLastCpus(criticalPath, &lastCpus);
+        size_t waitCpuSegment = 0;
+
+        // Stack of the thread of each segment at its end.
+        std::vector<stacks::StackId> endStacks;
+        GetEndStacks(criticalPath, &endStacks);
+
         // Traverse all segments of the critical path.
-        for (const auto& segment : criticalPath)
+        for (size_t i = 0; i < criticalPath.size(); ++i)
         {
+            const auto& segment = criticalPath[i];
             uint64_t segmentDuration = segment.endTs() - segment.startTs();
 
             // Make sure that the current thread is on top of the stack of threads.
-            EnsureCurrentThreadIsOnThreadsStack(segment, baseStackId, &threads);
+            EnsureCurrentThreadIsOnThreadsStack(
+                segment, baseStackId, endStacks[i], &threads);
 
             if (segment.type() == critical::kEpsilon)
                 continue;
@@ -85,11 +94,12 @@ public:
             {
                 // Find samples that belong to this segment.
                 uint64_t total = 0;
-                auto callback = std::bind(
-                    &StacksExtractor::SampleCallback, this, pl::_1, pl::_2,
-                    std::ref(threads), segment.tid(), &total);
-                stacks.EnumerateStacks(
-                    segment.tid(), segment.startTs(), segment.endTs(), callback);
+                StacksCursor(segment.tid())->EnumerateStacks(
+                    segment.startTs(), segment.endTs(),
+                    [&](stacks::StackId stackId, timestamp_t duration) {
+                        SampleCallback(stackId, duration, threads,
+                                       segment.tid(), &total);
+                    });
 
                 // If there was not enough samples, add a "No stack" sample.
                 if (total < segmentDuration)
@@ -109,7 +119,7 @@ public:
                 {
                     threads.back().stack = ConcatenateStacks(
                         threads.back().cleanStack,
-                        stacks.GetStack(segment.tid(), segment.startTs()));
+                        StacksCursor(segment.tid())->GetStack(segment.startTs()));
                 }
 
                 auto stackId = PushOnStack(
@@ -124,7 +134,7 @@ public:
                 {
                     threads.back().stack = ConcatenateStacks(
                         threads.back().cleanStack,
-                        stacks.GetStack(segment.tid(), segment.startTs()));
+                        StacksCursor(segment.tid())->GetStack(segment.startTs()));
                 }
 
                 auto diskStackId = PushOnStack(
@@ -156,7 +166,7 @@ public:
                     auto stackId = PushOnStack(
                         diskStackId,
                         std::string("[") + currentState->CurrentNameForThread(interval.second) + "]");
-                    stackId = ConcatenateStacks(stackId, stacks.GetStack(interval.second, interval.first.low()));
+                    stackId = ConcatenateStacks(stackId, StacksCursor(interval.second)->GetStack(interval.first.low()));
 
                     execution->IncrementSample(stackId, criticalSegmentDuration);
 
@@ -174,25 +184,22 @@ public:
                     threads.back().cleanStack,
                     critical::GetStatusString(segment.type()));
 
-                // Find the last CPU on which this thread was running.
-                auto lastCpuKey = currentState->GetAttributeKey(
-                    threadsPathKey,
-                    {currentState->IntQuark(segment.tid()), currentCpuQuark});
-
-                uint32_t lastCpu = -1;
+                // Last CPU on which this thread was running.
+                const auto& lastCpu = lastCpus[waitCpuSegment++];
 
-                if (stateHistory.GetUIntegerValue(lastCpuKey, segment.startTs(), &lastCpu))
+                if (lastCpu.found)
                 {
                     // Find out what was running while we were waiting for the CPU.
                     auto curThreadKey = currentState->GetAttributeKey(
                         cpusPathKey,
-                        {currentState->IntQuark(lastCpu), currentThreadQuark});
+                        {currentState->IntQuark(lastCpu.value), currentThreadQuark});
 
                     uint64_t total = 0;
                     stateHistory.EnumerateUIntegerValues(
                         curThreadKey, segment.startTs(), segment.endTs(),
-                        std::bind(&StacksExtractor::PreemptedCallback,
-                                  this, pl::_1, pl::_2, pl::_3, stackId, &total));
+                        [&](uint32_t tid, timestamp_t start, timestamp_t end) {
+                            PreemptedCallback(tid, start, end, stackId, &total);
+                        });
 
                     // Add a simple "wait-cpu" segment.
                     if (segmentDuration > total)
@@ -214,8 +221,7 @@ public:
 
             // Update the stack for this thread.
             threads.back().stack = ConcatenateStacks(
-                threads.back().cleanStack,
-                stacks.GetStack(segment.tid(), segment.endTs()));
+                threads.back().cleanStack, endStacks[i]);
         }
     }
 
@@ -232,6 +238,49 @@ private:
         bool isSyscall;
     };
 
+    void GetLastCpus(const critical::CriticalPath& criticalPath,
+                     std::vector<state::StateHistory::UIntegerResult>* lastCpus)
+    {
+        // Query the state history for all the segments in a single batch.
+        std::vector<state::StateHistory::Query> queries;
+        for (const auto& segment : criticalPath)
+        {
+            if (segment.type() != critical::kWaitCpu)
+                continue;
+
+            auto lastCpuKey = currentState->GetAttributeKey(
+                threadsPathKey,
+                {currentState->IntQuark(segment.tid()), currentCpuQuark});
+            queries.push_back(
+                state::StateHistory::Query(lastCpuKey, segment.startTs()));
+        }
+
+        stateHistory.GetUIntegerValues(queries, lastCpus);
+    }
+
+    void GetEndStacks(const critical::CriticalPath& criticalPath,
+                      std::vector<stacks::StackId>* endStacks)
+    {
+        // Query the stacks at the end of all the segments in a single batch.
+        std::vector<stacks::StacksBuilder::Query> queries;
+        queries.reserve(criticalPath.size());
+        for (const auto& segment : criticalPath)
+        {
+            queries.push_back(stacks::StacksBuilder::Query(
+                segment.tid(), segment.endTs()));
+        }
+
+        stacks.GetStacks(queries, endStacks);
+    }
+
+    stacks::StacksBuilder::Cursor* StacksCursor(thread_t tid)
+    {
+        auto look = stacksCursors.find(tid);
+        if (look == stacksCursors.end())
+            look = stacksCursors.insert(std::make_pair(tid, stacks.GetCursor(tid))).first;
+        return &look->second;
+    }
+
     stacks::StackId PushOnStack(stacks::StackId bottom,
                                 const std::string& function)
     {
@@ -244,38 +293,7 @@ private:
     stacks::StackId ConcatenateStacks(stacks::StackId bottom,
                                       stacks::StackId top)
     {
-        if (top == stacks::kEmptyStackId)
-            return bottom;
-
-        // Look in the cache.
-        auto key = std::make_pair(bottom, top);
-        auto look = concatenationCache.find(key);
-        if (look != concatenationCache.end())
-            return look->second;
-
-        // Get the functions from the top stack.
-        std::deque<stacks::FunctionNameId> topStackFunctions;
-        while (top != stacks::kEmptyStackId)
-        {
-            auto step = db->GetStack(top);
-            topStackFunctions.push_front(step.function());
-            top = step.bottom();
-        }
-
-        // Push the functions of the top stack on the bottom stack.
-        stacks::StackId fullStack = bottom;
-        for (auto function : topStackFunctions)
-        {
-            stacks::Stack step;
-            step.set_bottom(fullStack);
-            step.set_function(function);
-            fullStack = db->AddStack(step);
-        }
-
-        // Insert concatenation in the cache.
-        concatenationCache[key] = fullStack;
-
-        return fullStack;
+        return concatenator->Concatenate(bottom, top);
     }
 
     void SampleCallback(stacks::StackId stackId,
@@ -319,6 +337,7 @@ private:
     void EnsureCurrentThreadIsOnThreadsStack(
         const critical::CriticalPathSegment& segment,
         stacks::StackId baseStackId,
+        stacks::StackId endStack,
         std::vector<ThreadInfo>* threads)
     {
         if (threads->empty())
@@ -353,8 +372,7 @@ private:
 
         // Set the full stack.
         threads->back().stack = ConcatenateStacks(
-            threads->back().cleanStack,
-            stacks.GetStack(segment.tid(), segment.endTs()));
+            threads->back().cleanStack, endStack);
     }
 
     // Stacks.
@@ -375,31 +393,23 @@ private:
     // Database, to find the content of stacks.
     db::Database* db;
 
+    // Concatenates stacks, caching the results of the pipeline.
+    StackConcatenator* concatenator;
+
     // Execution, to which samples are added.
     Execution* execution;
 
+    // Segments are mostly visited in timestamp order: cursors avoid
+    // searching the whole history of a thread for each segment.
+    std::unordered_map<thread_t, stacks::StacksBuilder::Cursor> stacksCursors;
+
     // Keys and quarks to access the state history.
     state::AttributeKey threadsPathKey;
     quark::Quark currentCpuQuark;
     state::AttributeKey cpusPathKey;
     quark::Quark currentThreadQuark;
-
-    // Cash for stacks concatenation.
-    struct PairHash {
-    public:
-      template <typename T, typename U>
-      std::size_t operator()(const std::pair<T, U> &x) const
-      {
-        return std::hash<T>()(x.first) ^ std::hash<U>()(x.second);
-      }
-    };
-    static std::unordered_map<std::pair<stacks::StackId, stacks::StackId>, stacks::StackId, PairHash>
-        concatenationCache;
 };
 
-std::unordered_map<std::pair<stacks::StackId, stacks::StackId>, stacks::StackId, StacksExtractor::PairHash>
-    StacksExtractor::concatenationCache;
-
 }  // namespace
 
 void ExtractStacks(
@@ -410,11 +420,12 @@ void ExtractStacks(
     const disk::DiskRequests& diskRequests,
     state::CurrentState* currentState,
     db::Database* db,
+    StackConcatenator* concatenator,
     Execution* execution)
 {
     StacksExtractor extractor(
         stacks, graph, stateHistory, diskRequests,
-        currentState, db, execution);
+        currentState, db, concatenator, execution);
     extractor.ExtractStacks(criticalPath, stacks::kEmptyStackId);
 }
 
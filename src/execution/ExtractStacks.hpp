@@ -23,6 +23,7 @@
 #include "db/Database.hpp"
 #include "disk/DiskRequests.hpp"
 #include "execution/Execution.hpp"
+#include "execution/StackConcatenator.hpp"
 #include "stacks/StacksBuilder.hpp"
 #include "state/CurrentState.hpp"
 #include "state/StateHistory.hpp"
@@ -40,6 +41,7 @@ void ExtractStacks(
     const disk::DiskRequests& diskRequests,
     state::CurrentState* currentState,
     db::Database* db,
+    StackConcatenator* concatenator,
     Execution* execution);
 
 }  // namespace execution
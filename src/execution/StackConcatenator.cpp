@@ -0,0 +1,74 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "execution/StackConcatenator.hpp"
+
+#include <deque>
+
+namespace tibee
+{
+namespace execution
+{
+
+StackConcatenator::StackConcatenator(db::Database* db)
+    : _db(db)
+{
+}
+
+StackConcatenator::~StackConcatenator()
+{
+}
+
+stacks::StackId StackConcatenator::Concatenate(stacks::StackId bottom,
+                                               stacks::StackId top)
+{
+    if (top == stacks::kEmptyStackId)
+        return bottom;
+
+    // Look in the cache.
+    auto key = std::make_pair(bottom, top);
+    auto look = _cache.find(key);
+    if (look != _cache.end())
+        return look->second;
+
+    // Get the functions from the top stack.
+    std::deque<stacks::FunctionNameId> topStackFunctions;
+    while (top != stacks::kEmptyStackId)
+    {
+        auto step = _db->GetStack(top);
+        topStackFunctions.push_front(step.function());
+        top = step.bottom();
+    }
+
+    // Push the functions of the top stack on the bottom stack.
+    stacks::StackId fullStack = bottom;
+    for (auto function : topStackFunctions)
+    {
+        stacks::Stack step;
+        step.set_bottom(fullStack);
+        step.set_function(function);
+        fullStack = _db->AddStack(step);
+    }
+
+    // Insert concatenation in the cache.
+    _cache[key] = fullStack;
+
+    return fullStack;
+}
+
+}  // namespace execution
+}  // namespace tibee
@@ -0,0 +1,70 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_EXECUTION_STACKCONCATENATOR_HPP
+#define _TIBEE_EXECUTION_STACKCONCATENATOR_HPP
+
+#include <unordered_map>
+#include <utility>
+
+#include "db/Database.hpp"
+#include "stacks/Identifiers.hpp"
+
+namespace tibee
+{
+namespace execution
+{
+
+/**
+ * Concatenates stacks of a database, and caches the concatenations.
+ *
+ * A concatenator is not thread-safe: each analysis pipeline owns its own.
+ * Pipelines share the database, which serializes the stack interning.
+ *
+ * @author Francois Doray
+ */
+class StackConcatenator
+{
+public:
+    StackConcatenator(db::Database* db);
+    ~StackConcatenator();
+
+    // Returns the stack made of the functions of |top| pushed on |bottom|.
+    stacks::StackId Concatenate(stacks::StackId bottom, stacks::StackId top);
+
+private:
+    struct PairHash
+    {
+        template <typename T, typename U>
+        std::size_t operator()(const std::pair<T, U>& x) const
+        {
+            return std::hash<T>()(x.first) ^ std::hash<U>()(x.second);
+        }
+    };
+
+    // Database that owns the stacks.
+    db::Database* _db;
+
+    // Concatenations that were already computed, by (bottom, top).
+    std::unordered_map<std::pair<stacks::StackId, stacks::StackId>,
+                       stacks::StackId, PairHash> _cache;
+};
+
+}  // namespace execution
+}  // namespace tibee
+
+#endif // _TIBEE_EXECUTION_STACKCONCATENATOR_HPP
@@ -0,0 +1,115 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "db/Database.hpp"
+#include "execution/StackConcatenator.hpp"
+
+namespace tibee
+{
+namespace execution
+{
+
+namespace
+{
+
+// Returns the functions of a stack, from the bottom to the top.
+std::vector<stacks::FunctionNameId> GetFunctions(const db::Database& db,
+                                                 stacks::StackId stack)
+{
+    std::vector<stacks::FunctionNameId> functions;
+    while (stack != stacks::kEmptyStackId)
+    {
+        auto step = db.GetStack(stack);
+        functions.insert(functions.begin(), step.function());
+        stack = step.bottom();
+    }
+    return functions;
+}
+
+}  // namespace
+
+TEST(StackConcatenator, Concatenate)
+{
+    db::Database::DestroyTestDb();
+    db::Database db(true);
+    StackConcatenator concatenator(&db);
+
+    auto a = db.AddStack(stacks::Stack(1, stacks::kEmptyStackId));
+    auto ab = db.AddStack(stacks::Stack(2, a));
+    auto c = db.AddStack(stacks::Stack(3, stacks::kEmptyStackId));
+    auto cd = db.AddStack(stacks::Stack(4, c));
+
+    EXPECT_EQ(ab, concatenator.Concatenate(ab, stacks::kEmptyStackId));
+    EXPECT_EQ(cd, concatenator.Concatenate(stacks::kEmptyStackId, cd));
+
+    auto abcd = concatenator.Concatenate(ab, cd);
+    std::vector<stacks::FunctionNameId> expected {1, 2, 3, 4};
+    EXPECT_EQ(expected, GetFunctions(db, abcd));
+    EXPECT_EQ(abcd, concatenator.Concatenate(ab, cd));
+}
+
+TEST(StackConcatenator, ConcurrentPipelines)
+{
+    const size_t kNumStacks = 200;
+
+    db::Database::DestroyTestDb();
+    db::Database db(true);
+
+    // Stacks of increasing depth.
+    std::vector<stacks::StackId> ids {stacks::kEmptyStackId};
+    for (size_t i = 0; i < kNumStacks; ++i)
+        ids.push_back(db.AddStack(stacks::Stack(i, ids.back())));
+
+    // Each pipeline concatenates the same stacks with its own concatenator,
+    // while sharing the database.
+    std::vector<stacks::StackId> results[2];
+    auto extract = [&](std::vector<stacks::StackId>* results) {
+        StackConcatenator concatenator(&db);
+        for (size_t i = 1; i < ids.size(); ++i)
+        {
+            for (size_t j = 1; j < ids.size(); j += 7)
+                results->push_back(concatenator.Concatenate(ids[i], ids[j]));
+        }
+    };
+    std::thread first(extract, &results[0]);
+    std::thread second(extract, &results[1]);
+    first.join();
+    second.join();
+
+    ASSERT_EQ(results[0].size(), results[1].size());
+    EXPECT_EQ(results[0], results[1]);
+
+    size_t index = 0;
+    for (size_t i = 1; i < ids.size(); ++i)
+    {
+        for (size_t j = 1; j < ids.size(); j += 7)
+        {
+            auto functions = GetFunctions(db, results[0][index++]);
+            ASSERT_EQ(i + j, functions.size());
+            EXPECT_EQ(static_cast<stacks::FunctionNameId>(i - 1), functions[i - 1]);
+            EXPECT_EQ(static_cast<stacks::FunctionNameId>(j - 1), functions.back());
+        }
+    }
+}
+
+}  // namespace execution
+}  // namespace tibee
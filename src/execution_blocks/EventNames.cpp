@@ -0,0 +1,51 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "execution_blocks/EventNames.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <string.h>
+
+namespace tibee {
+namespace execution_blocks {
+
+namespace
+{
+const char kUstPrefix[] = "ust/";
+const char kKernelPrefix[] = "kernel/";
+}  // namespace
+
+bool SplitEventName(const std::string& name, bool* isKernel,
+                    std::string* event)
+{
+    if (boost::starts_with(name, kUstPrefix))
+    {
+        *isKernel = false;
+        *event = name.substr(strlen(kUstPrefix));
+        return true;
+    }
+    if (boost::starts_with(name, kKernelPrefix))
+    {
+        *isKernel = true;
+        *event = name.substr(strlen(kKernelPrefix));
+        return true;
+    }
+    return false;
+}
+
+}  // namespace execution_blocks
+}  // namespace tibee
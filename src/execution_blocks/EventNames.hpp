@@ -0,0 +1,38 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_EXECUTIONBLOCKS_EVENTNAMES_HPP
+#define _TIBEE_EXECUTIONBLOCKS_EVENTNAMES_HPP
+
+#include <string>
+
+namespace tibee {
+namespace execution_blocks {
+
+// Splits the name of an event of an execution definition, which is
+// prefixed with ust/ or kernel/.
+// @param name Prefixed name of the event.
+// @param isKernel Set to true for a kernel event, false for a ust event.
+// @param event Receives the name of the event, without its prefix.
+// @returns false if the name doesn't have a known prefix.
+bool SplitEventName(const std::string& name, bool* isKernel,
+                    std::string* event);
+
+}  // namespace execution_blocks
+}  // namespace tibee
+
+#endif // _TIBEE_EXECUTIONBLOCKS_EVENTNAMES_HPP
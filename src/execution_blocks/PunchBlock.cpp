@@ -17,25 +17,20 @@
  */
 #include "execution_blocks/PunchBlock.hpp"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
-#include "base/BindObject.hpp"
 #include "base/CompareConstants.hpp"
 #include "base/Constants.hpp"
 #include "base/print.hpp"
+#include "execution_blocks/EventNames.hpp"
 #include "notification/Token.hpp"
 #include "value/MakeValue.hpp"
 
 namespace tibee {
 namespace execution_blocks {
 
-namespace
-{
-const char kUstPrefix[] = "ust/";
-const char kKernelPrefix[] = "kernel/";
-}  // namespace
-
 PunchBlock::PunchBlock()
     : _stats(false)
 {
@@ -47,89 +42,149 @@ PunchBlock::~PunchBlock()
 
 void PunchBlock::Start(const value::Value* params)
 {
-    auto nameValue = params->GetField("name");
-    auto execValue = params->GetField("exec");
-    auto beginValue = params->GetField("begin");
-    auto endValue = params->GetField("end");
+    auto definitionsValue = params->GetField("definitions");
     auto statsValue = params->GetField("stats");
 
-    if (nameValue == nullptr || execValue == nullptr ||
-        beginValue == nullptr || endValue == nullptr ||
-        statsValue == nullptr)
+    if (definitionsValue == nullptr || statsValue == nullptr)
     {
         base::tberror() << "Missing some parameters for punch block." << base::tbendl();
         return;
     }
 
-    _name = nameValue->AsString();
-    _exec = execValue->AsString();
-    _beginEvent = beginValue->AsString();
-    _endEvent = endValue->AsString();
+    for (const auto& definitionValue : *value::ArrayValue::Cast(definitionsValue))
+    {
+        auto nameValue = definitionValue.GetField("name");
+        auto execValue = definitionValue.GetField("exec");
+        auto beginValue = definitionValue.GetField("begin");
+        auto endValue = definitionValue.GetField("end");
+
+        if (nameValue == nullptr || execValue == nullptr ||
+            beginValue == nullptr || endValue == nullptr)
+        {
+            base::tberror() << "Missing some parameters for an execution definition." << base::tbendl();
+            continue;
+        }
+
+        Definition definition;
+        definition.name = nameValue->AsString();
+        definition.exec = execValue->AsString();
+        definition.beginEvent = beginValue->AsString();
+        definition.endEvent = endValue->AsString();
+        _definitions.push_back(definition);
+    }
+
     _stats = value::BoolValue::Cast(statsValue)->GetValue();
 
     if (_stats)
     {
+        if (_definitions.size() > 1)
+            std::cout << "name,";
         std::cout << "duration_us" << std::endl;
     }
 }
 
 void PunchBlock::AddObservers(notification::NotificationCenter* notificationCenter)
 {
-    AddEventObserver(notificationCenter, _beginEvent, &PunchBlock::onBegin);
-    AddEventObserver(notificationCenter, _endEvent, &PunchBlock::onEnd);
+    // Observe each event once, even if it delimits many definitions.
+    for (size_t i = 0; i < _definitions.size(); ++i)
+    {
+        GetEventDefinitions(_definitions[i].beginEvent)->begins.push_back(i);
+        GetEventDefinitions(_definitions[i].endEvent)->ends.push_back(i);
+    }
+
+    for (size_t i = 0; i < _events.size(); ++i)
+    {
+        AddEventObserver(notificationCenter, _events[i].event,
+                         [this, i](const trace::EventValue& event) {
+                             onEvent(i, event);
+                         });
+    }
 }
 
-void PunchBlock::onBegin(const trace::EventValue& event)
+void PunchBlock::onEvent(size_t eventIndex, const trace::EventValue& event)
 {
+    const auto& eventDefinitions = _events[eventIndex];
     auto tid = ThreadForEvent(event);
-    if (!TidIsAnalyzed(tid))
+
+    std::string threadName;
+    if (std::any_of(_definitions.begin(), _definitions.end(),
+                    [](const Definition& definition) {
+                        return !definition.exec.empty();
+                    }))
+    {
+        threadName = State()->CurrentNameForThread(tid);
+    }
+
+    // End executions first, so that an event can both end an execution
+    // and begin the next one.
+    for (size_t index : eventDefinitions.ends)
+    {
+        const auto& definition = _definitions[index];
+        if (!TidIsAnalyzed(definition, threadName))
+            continue;
+
+        timestamp_t duration = Executions()->EndExecution(tid, definition.name);
+        if (_stats && duration != 0 && duration > 5000000)
+        {
+            if (_definitions.size() > 1)
+                std::cout << definition.name << ",";
+            std::cout << (duration / 1000) << "," << State()->timestamp() << std::endl;
+        }
+    }
+
+    // Executions that begin outside the execution windows belong to
+    // another time slice.
+    if (!InExecutionWindow())
         return;
 
-    Executions()->StartExecution(tid, _name, true);
+    for (size_t index : eventDefinitions.begins)
+    {
+        const auto& definition = _definitions[index];
+        if (!TidIsAnalyzed(definition, threadName))
+            continue;
+
+        ThreadInterest()->AddThread(tid);
+        Executions()->StartExecution(tid, definition.name, true);
+    }
 }
 
-void PunchBlock::onEnd(const trace::EventValue& event)
+PunchBlock::EventDefinitions* PunchBlock::GetEventDefinitions(
+    const std::string& event)
 {
-    auto tid = ThreadForEvent(event);
-    if (!TidIsAnalyzed(tid))
-        return;
-
-    timestamp_t duration = Executions()->EndExecution(tid);
-    if (_stats && duration != 0 && duration > 5000000)
+    for (auto& eventDefinitions : _events)
     {
-        std::cout << (duration / 1000) << "," << State()->timestamp() << std::endl;
+        if (eventDefinitions.event == event)
+            return &eventDefinitions;
     }
+
+    _events.push_back(EventDefinitions());
+    _events.back().event = event;
+    return &_events.back();
 }
 
 void PunchBlock::AddEventObserver(notification::NotificationCenter* notificationCenter,
                                   const std::string& name,
-                                  Observer observer)
+                                  const Observer& observer)
 {
-    if (boost::starts_with(name, kUstPrefix))
-    {
-        AddUstObserver(notificationCenter,
-                       notification::Token(name.substr(strlen(kUstPrefix))),
-                       base::BindObject(observer, this));
-    }
-    else if (boost::starts_with(name, kKernelPrefix))
-    {
-        AddKernelObserver(notificationCenter,
-                          notification::Token(name.substr(strlen(kKernelPrefix))),
-                          base::BindObject(observer, this));
-    }
-    else
+    bool isKernel = false;
+    std::string event;
+    if (!SplitEventName(name, &isKernel, &event))
     {
         base::tberror() << "Punch block: event name is not prefixed with ust/ or kernel/."
                         << base::tbendl();
+        return;
     }
+
+    if (isKernel)
+        AddKernelObserver(notificationCenter, notification::Token(event), observer);
+    else
+        AddUstObserver(notificationCenter, notification::Token(event), observer);
 }
 
-bool PunchBlock::TidIsAnalyzed(uint32_t tid) const
+bool PunchBlock::TidIsAnalyzed(const Definition& definition,
+                               const std::string& threadName) const
 {
-    if (_exec.empty())
-        return true;
-    auto thread_name = State()->CurrentNameForThread(tid);
-    return thread_name == _exec;
+    return definition.exec.empty() || threadName == definition.exec;
 }
 
 }  // namespace execution_blocks
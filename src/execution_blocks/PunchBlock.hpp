@@ -18,7 +18,9 @@
 #ifndef _TIBEE_BUILDERBLOCKS_PUNCHBLOCK_HPP
 #define _TIBEE_BUILDERBLOCKS_PUNCHBLOCK_HPP
 
+#include <functional>
 #include <string>
+#include <vector>
 
 #include "build_blocks/AbstractBuildBlock.hpp"
 #include "notification/NotificationCenter.hpp"
@@ -46,27 +48,48 @@ public:
     virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
 
 private:
-    void onBegin(const trace::EventValue& event);
-    void onEnd(const trace::EventValue& event);
+    // Definition of a kind of execution.
+    struct Definition
+    {
+        // The name of the generated executions.
+        std::string name;
 
-    typedef void (PunchBlock::*Observer)(const trace::EventValue& event);
+        // The name of the analyzed executable.
+        std::string exec;
+
+        // The name of the begin event.
+        std::string beginEvent;
+
+        // The name of the end event;
+        std::string endEvent;
+    };
+
+    // Definitions that begin or end on an event.
+    struct EventDefinitions
+    {
+        std::string event;
+        std::vector<size_t> begins;
+        std::vector<size_t> ends;
+    };
+
+    void onEvent(size_t eventIndex, const trace::EventValue& event);
+
+    typedef std::function<void (const trace::EventValue& event)> Observer;
     void AddEventObserver(notification::NotificationCenter* notificationCenter,
                           const std::string& name,
-                          Observer observer);
-
-    bool TidIsAnalyzed(uint32_t tid) const;
+                          const Observer& observer);
 
-    // The name of the generated executions.
-    std::string _name;
+    // Get the definitions of an event, adding them if necessary.
+    EventDefinitions* GetEventDefinitions(const std::string& event);
 
-    // The name of the analyzed executable.
-    std::string _exec;
+    bool TidIsAnalyzed(const Definition& definition,
+                       const std::string& threadName) const;
 
-    // The name of the begin event.
-    std::string _beginEvent;
+    // The definitions of the generated executions.
+    std::vector<Definition> _definitions;
 
-    // The name of the end event;
-    std::string _endEvent;
+    // The definitions of each observed event.
+    std::vector<EventDefinitions> _events;
 
     // Just show statistics of execution duration.
     bool _stats;
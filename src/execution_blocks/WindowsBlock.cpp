@@ -0,0 +1,271 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "execution_blocks/WindowsBlock.hpp"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <string.h>
+
+#include "base/BindObject.hpp"
+#include "base/Constants.hpp"
+#include "base/print.hpp"
+#include "execution_blocks/EventNames.hpp"
+#include "notification/Token.hpp"
+#include "value/MakeValue.hpp"
+
+namespace tibee {
+namespace execution_blocks {
+
+namespace
+{
+
+// Length of the command names in the kernel trace, which are truncated.
+const size_t kMaxCommLength = 15;
+
+}  // namespace
+
+using notification::Token;
+
+WindowsBlock::WindowsBlock(execution::ExecutionWindows* executionWindows)
+    : _executionWindows(executionWindows),
+      _filterByExec(false),
+      _ts(0)
+{
+}
+
+WindowsBlock::~WindowsBlock()
+{
+}
+
+void WindowsBlock::Start(const value::Value* params)
+{
+    auto definitionsValue = params->GetField("definitions");
+    if (definitionsValue == nullptr)
+    {
+        base::tberror() << "Missing some parameters for windows block." << base::tbendl();
+        return;
+    }
+
+    for (const auto& definitionValue : *value::ArrayValue::Cast(definitionsValue))
+    {
+        auto beginValue = definitionValue.GetField("begin");
+        auto endValue = definitionValue.GetField("end");
+        auto execValue = definitionValue.GetField("exec");
+        if (beginValue == nullptr || endValue == nullptr)
+        {
+            base::tberror() << "Missing some parameters for an execution definition." << base::tbendl();
+            continue;
+        }
+
+        Definition definition;
+        definition.beginEvent = beginValue->AsString();
+        definition.endEvent = endValue->AsString();
+        if (execValue != nullptr)
+            definition.exec = execValue->AsString();
+        if (!definition.exec.empty())
+            _filterByExec = true;
+        _definitions.push_back(definition);
+    }
+}
+
+void WindowsBlock::AddObservers(notification::NotificationCenter* notificationCenter)
+{
+    notificationCenter->AddObserver(
+        {Token(kTraceNotificationPrefix), Token(kTimestampNotificationName)},
+        base::BindObject(&WindowsBlock::onTimestamp, this));
+    notificationCenter->AddObserver(
+        {Token(kTraceNotificationPrefix), Token(kEndNotificationName)},
+        base::BindObject(&WindowsBlock::onEnd, this));
+    AddKernelObserver(notificationCenter, Token("sched_switch"),
+                      base::BindObject(&WindowsBlock::onSchedSwitch, this));
+    AddKernelObserver(notificationCenter, Token("sched_ttwu"),
+                      base::BindObject(&WindowsBlock::onTTWU, this));
+
+    for (size_t i = 0; i < _definitions.size(); ++i)
+    {
+        AddEventObserver(notificationCenter, _definitions[i].beginEvent,
+                         [this, i](const trace::EventValue& event) {
+                             onBeginEvent(i, event);
+                         });
+        AddEventObserver(notificationCenter, _definitions[i].endEvent,
+                         [this, i](const trace::EventValue& event) {
+                             onEndEvent(i, event);
+                         });
+    }
+}
+
+void WindowsBlock::onTimestamp(const notification::Path& path, const value::Value* value)
+{
+    _ts = value->AsULong();
+}
+
+void WindowsBlock::onEnd(const notification::Path& path, const value::Value* value)
+{
+    // Executions that didn't end extend to the end of the trace.
+    for (const auto& openWindow : _openWindows)
+    {
+        if (openWindow.second.open)
+            _executionWindows->AddWindow(openWindow.second.begin, _ts);
+    }
+    _openWindows.clear();
+
+    // Threads that the executions depend on: the threads that run them and
+    // the threads that wake up a thread of the closure.
+    std::unordered_set<thread_t> closure;
+    std::vector<thread_t> pending(_executionThreads.begin(),
+                                  _executionThreads.end());
+    while (!pending.empty())
+    {
+        thread_t thread = pending.back();
+        pending.pop_back();
+        if (!closure.insert(thread).second)
+            continue;
+
+        _executionWindows->AddThread(thread);
+        auto look = _wakers.find(thread);
+        if (look == _wakers.end())
+            continue;
+        pending.insert(pending.end(), look->second.begin(), look->second.end());
+    }
+}
+
+void WindowsBlock::onSchedSwitch(const trace::EventValue& event)
+{
+    uint32_t cpu = CpuForEvent(event);
+    if (cpu >= _cpuThreads.size())
+        _cpuThreads.resize(cpu + 1, kInvalidThread);
+
+    const auto* fields = event.getFields();
+    thread_t prevTid = fields->GetField("prev_tid")->AsInteger();
+    thread_t nextTid = fields->GetField("next_tid")->AsInteger();
+    _cpuThreads[cpu] = nextTid;
+
+    // Only needed to filter the executions by executable.
+    if (_filterByExec)
+    {
+        SetThreadName(prevTid, fields->GetField("prev_comm")->AsString());
+        SetThreadName(nextTid, fields->GetField("next_comm")->AsString());
+    }
+}
+
+void WindowsBlock::SetThreadName(thread_t thread, const std::string& name)
+{
+    // Names rarely change: only write them when they do.
+    auto& threadName = _threadNames[thread].name;
+    if (strncmp(threadName, name.c_str(), sizeof(threadName)) == 0)
+        return;
+    strncpy(threadName, name.c_str(), sizeof(threadName) - 1);
+    threadName[sizeof(threadName) - 1] = '\0';
+}
+
+void WindowsBlock::onTTWU(const trace::EventValue& event)
+{
+    thread_t source = ThreadForEvent(event);
+    if (source == 0 || source == kInvalidThread)
+        return;
+
+    thread_t target = event.getFields()->GetField("tid")->AsInteger();
+    _wakers[target].insert(source);
+}
+
+void WindowsBlock::onBeginEvent(size_t definition, const trace::EventValue& event)
+{
+    thread_t thread = ThreadForEvent(event);
+    if (!TidIsAnalyzed(_definitions[definition], thread))
+        return;
+
+    // A new execution replaces the active one of the thread, as in
+    // PunchBlock. The window keeps the beginning of the replaced execution.
+    if (thread != kInvalidThread)
+        _executionThreads.insert(thread);
+
+    auto& openWindow = _openWindows[OpenWindowKey(definition, thread)];
+    if (!openWindow.open)
+        openWindow.begin = _ts;
+    openWindow.open = true;
+}
+
+void WindowsBlock::onEndEvent(size_t definition, const trace::EventValue& event)
+{
+    thread_t thread = ThreadForEvent(event);
+    auto look = _openWindows.find(OpenWindowKey(definition, thread));
+    if (look == _openWindows.end() || !look->second.open)
+        return;
+
+    look->second.open = false;
+    _executionWindows->AddWindow(look->second.begin, _ts);
+}
+
+void WindowsBlock::AddEventObserver(notification::NotificationCenter* notificationCenter,
+                                    const std::string& name,
+                                    const Observer& observer)
+{
+    bool isKernel = false;
+    std::string event;
+    if (!SplitEventName(name, &isKernel, &event))
+    {
+        base::tberror() << "Windows block: event name is not prefixed with ust/ or kernel/."
+                        << base::tbendl();
+        return;
+    }
+
+    if (isKernel)
+        AddKernelObserver(notificationCenter, Token(event), observer);
+    else
+        AddUstObserver(notificationCenter, Token(event), observer);
+}
+
+uint32_t WindowsBlock::CpuForEvent(const trace::EventValue& event) const
+{
+    return event.getStreamPacketContext()->GetField("cpu_id")->AsUInteger();
+}
+
+thread_t WindowsBlock::ThreadForEvent(const trace::EventValue& event) const
+{
+    const auto* context = event.getStreamEventContext();
+    if (context != nullptr)
+    {
+        auto threadValue = context->GetField("vtid");
+        if (threadValue != nullptr)
+            return threadValue->AsUInteger();
+    }
+
+    uint32_t cpu = CpuForEvent(event);
+    if (cpu >= _cpuThreads.size())
+        return kInvalidThread;
+    return _cpuThreads[cpu];
+}
+
+bool WindowsBlock::TidIsAnalyzed(const Definition& definition,
+                                 thread_t thread) const
+{
+    if (definition.exec.empty())
+        return true;
+
+    auto look = _threadNames.find(thread);
+    if (look == _threadNames.end())
+        return true;
+
+    // The kernel truncates the command names.
+    const char* name = look->second.name;
+    if (strlen(name) >= kMaxCommLength)
+        return boost::starts_with(definition.exec, name);
+    return definition.exec == name;
+}
+
+}  // namespace execution_blocks
+}  // namespace tibee
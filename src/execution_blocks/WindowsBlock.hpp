@@ -0,0 +1,158 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_EXECUTIONBLOCKS_WINDOWSBLOCK_HPP
+#define _TIBEE_EXECUTIONBLOCKS_WINDOWSBLOCK_HPP
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+#include "block/AbstractBlock.hpp"
+#include "execution/ExecutionWindows.hpp"
+#include "notification/NotificationCenter.hpp"
+#include "notification/Path.hpp"
+#include "trace/value/EventValue.hpp"
+#include "value/Value.hpp"
+
+namespace tibee {
+namespace execution_blocks {
+
+/**
+ * Block that finds the time windows in which executions occur, during a
+ * first pass over the trace. Only sched_switch and the begin and end
+ * events of the execution definitions are observed.
+ *
+ * Windows are conservative: an execution that doesn't end extends its
+ * window to the end of the trace, unless another execution of the same
+ * definition begins on its thread. Executions of threads whose name is
+ * not known yet are kept, even if the definition filters by executable.
+ *
+ * The thread of a kernel event is the current thread of its CPU, tracked
+ * from sched_switch. Before the first sched_switch of a CPU, the events
+ * of the CPU share a window per definition.
+ *
+ * The block also finds the threads that the executions depend on: the
+ * threads that run executions and the threads that wake them up,
+ * transitively. Wake-ups are considered regardless of their time, so the
+ * closure may include more threads than needed.
+ *
+ * @author Francois Doray
+ */
+class WindowsBlock : public block::AbstractBlock
+{
+public:
+    // @param executionWindows Receives the windows found in the trace.
+    WindowsBlock(execution::ExecutionWindows* executionWindows);
+    ~WindowsBlock();
+
+    virtual void Start(const value::Value* params) override;
+    virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
+
+private:
+    // Execution of a definition that is open on a thread.
+    struct OpenWindow
+    {
+        OpenWindow() : begin(0), open(false) {}
+
+        // Beginning of the oldest execution replaced by the open one.
+        timestamp_t begin;
+
+        // Indicates whether an execution is open.
+        bool open;
+    };
+
+    // Begin and end events of a definition, and the executable to analyze.
+    struct Definition
+    {
+        std::string beginEvent;
+        std::string endEvent;
+        std::string exec;
+    };
+
+    typedef std::pair<size_t, thread_t> OpenWindowKey;
+    typedef std::function<void (const trace::EventValue& event)> Observer;
+
+    void onTimestamp(const notification::Path& path, const value::Value* value);
+    void onEnd(const notification::Path& path, const value::Value* value);
+    void onSchedSwitch(const trace::EventValue& event);
+    void onTTWU(const trace::EventValue& event);
+    void onBeginEvent(size_t definition, const trace::EventValue& event);
+    void onEndEvent(size_t definition, const trace::EventValue& event);
+
+    void AddEventObserver(notification::NotificationCenter* notificationCenter,
+                          const std::string& name,
+                          const Observer& observer);
+
+    // CPU of an event.
+    uint32_t CpuForEvent(const trace::EventValue& event) const;
+
+    // Thread of an event: its vtid context, or the current thread of its
+    // CPU. kInvalidThread if neither is known.
+    thread_t ThreadForEvent(const trace::EventValue& event) const;
+
+    // Indicates whether the executions of a definition on a thread are
+    // analyzed. Threads with an unknown name are kept.
+    bool TidIsAnalyzed(const Definition& definition, thread_t thread) const;
+
+    // Remembers the command name of a thread.
+    void SetThreadName(thread_t thread, const std::string& name);
+
+    // Command name of a thread, truncated by the kernel to 15 characters.
+    struct ThreadName
+    {
+        char name[16];
+    };
+
+    // Receives the windows.
+    execution::ExecutionWindows* _executionWindows;
+
+    // The definitions of the executions.
+    std::vector<Definition> _definitions;
+
+    // Indicates whether a definition filters its executions by executable.
+    bool _filterByExec;
+
+    // Current thread of each CPU.
+    std::vector<thread_t> _cpuThreads;
+
+    // Last known command name of each thread. Only kept when a definition
+    // filters by executable.
+    std::unordered_map<thread_t, ThreadName> _threadNames;
+
+    // Threads that ran an analyzed execution.
+    std::unordered_set<thread_t> _executionThreads;
+
+    // Threads that woke up each thread.
+    std::unordered_map<thread_t, std::unordered_set<thread_t>> _wakers;
+
+    // Open windows, by definition and thread.
+    std::map<OpenWindowKey, OpenWindow> _openWindows;
+
+    // Current timestamp.
+    timestamp_t _ts;
+};
+
+}  // namespace execution_blocks
+}  // namespace tibee
+
+#endif // _TIBEE_EXECUTIONBLOCKS_WINDOWSBLOCK_HPP
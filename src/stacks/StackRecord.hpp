@@ -0,0 +1,124 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_STACKS_STACKRECORD_HPP
+#define _TIBEE_STACKS_STACKRECORD_HPP
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+#include "base/PipelineStage.hpp"
+
+namespace tibee
+{
+namespace stacks
+{
+
+// Number of addresses that fit in a record. The addresses of deeper stacks
+// are carried out of line.
+const size_t kInlineStackDepth = 64;
+
+// Event that updates the stacks, decoded into a fixed layout so that it can
+// be handed off to another thread without allocating, unless its stack is
+// deeper than kInlineStackDepth.
+struct StackRecord
+{
+    enum Type : uint8_t
+    {
+        // An image is loaded in a process.
+        kImage,
+        // Sample of the stack of a running thread.
+        kOnCpuSample,
+        // Sample of the stack of a thread in a system call.
+        kOffCpuSample,
+        // Beginning of a system call.
+        kSyscallEntry,
+        // End of a system call.
+        kSyscallExit,
+        // System call that lasted |value| ns and ended at |ts|.
+        kSyscallLatency,
+    };
+
+    StackRecord()
+        : type(kSyscallExit), depth(0), thread(0), process(0), ts(0),
+          address(0), value(0), name(nullptr) {}
+
+    // Adds an address at the top of the stack sample.
+    void PushAddress(uint64_t address)
+    {
+        if (depth < kInlineStackDepth)
+        {
+            addresses[depth++] = address;
+            return;
+        }
+        if (!deepAddresses)
+        {
+            deepAddresses = std::make_shared<std::vector<uint64_t>>(
+                addresses, addresses + depth);
+        }
+        deepAddresses->push_back(address);
+        ++depth;
+    }
+
+    // Returns the addresses of the stack sample.
+    const uint64_t* GetAddresses() const
+    {
+        return deepAddresses ? deepAddresses->data() : addresses;
+    }
+
+    // Type of the record.
+    Type type;
+
+    // Number of addresses in the stack sample.
+    uint32_t depth;
+
+    // Thread and process of the event.
+    thread_t thread;
+    process_t process;
+
+    // Timestamp of the event.
+    timestamp_t ts;
+
+    // Base address of an image.
+    uint64_t address;
+
+    // Size of an image, duration of a system call or index of a system call.
+    uint64_t value;
+
+    // Path of an image or name of a system call. Points to a string that
+    // outlives the record.
+    const std::string* name;
+
+    // Addresses of a stack sample, in the order of the event, when the
+    // stack is not deeper than kInlineStackDepth.
+    uint64_t addresses[kInlineStackDepth];
+
+    // All the addresses of a deeper stack sample. Only allocated for these
+    // rare stacks, so that records usually don't allocate.
+    std::shared_ptr<std::vector<uint64_t>> deepAddresses;
+};
+
+// Stage that applies stack records to the stacks builder on its own thread.
+typedef base::PipelineStage<StackRecord> StacksPipeline;
+
+}  // namespace stacks
+}  // namespace tibee
+
+#endif  // _TIBEE_STACKS_STACKRECORD_HPP
@@ -20,6 +20,8 @@
 #include <algorithm>
 
 #include "base/CleanContainer.hpp"
+#include "base/MemoryUsage.hpp"
+#include "base/SortedSearch.hpp"
 #include "base/print.hpp"
 
 namespace tibee
@@ -66,6 +68,14 @@ void StacksBuilder::Cleanup(timestamp_t ts)
 	}
 }
 
+size_t StacksBuilder::ApproximateMemoryUsage() const
+{
+    size_t usage = base::HashMapMemoryUsage(_stacks);
+    for (const auto& threadHistory : _stacks)
+        usage += base::VectorMemoryUsage(threadHistory.second);
+    return usage;
+}
+
 void StacksBuilder::SetStack(thread_t thread, StackId stackId, bool isSyscall)
 {
     auto& stacks = _stacks[thread];
@@ -104,10 +114,20 @@ void StacksBuilder::SetNoStack(thread_t thread)
     SetStack(thread, GetStackIdentifier(stack), true);
 }
 
+void StacksBuilder::StartSystemCall(thread_t thread, StackId stackId)
+{
+    SetStack(thread, stackId, true);
+}
+
 void StacksBuilder::StartSystemCall(thread_t thread, const std::string& syscall)
+{
+    StartSystemCall(thread, GetSystemCallStack(syscall));
+}
+
+StackId StacksBuilder::GetSystemCallStack(const std::string& syscall)
 {
     std::vector<std::string> stack({std::string("sys:") + syscall});
-    SetStack(thread, GetStackIdentifier(stack), true);
+    return GetStackIdentifier(stack);
 }
 
 void StacksBuilder::EndSytemCall(thread_t thread)
@@ -181,49 +201,72 @@ void StacksBuilder::SetLastSystemCallStack(
     SetLastSystemCallStack(thread, GetStackIdentifier(stack));
 }
 
-void StacksBuilder::EnumerateStacks(
-    thread_t thread, timestamp_t start, timestamp_t end,
-    const EnumerateStacksCallback& callback) const
+stacks::StackId StacksBuilder::GetStack(thread_t thread, timestamp_t ts) const
 {
-    auto look = _stacks.find(thread);
-    if (look == _stacks.end())
-        return;
-    const auto& stacks = look->second;
-
-    StacksComparator comparator;
-    auto it = std::lower_bound(
-        stacks.begin(), stacks.end(), start, comparator);
-    if (it != stacks.begin())
-        --it;
+    return GetCursor(thread).GetStack(ts);
+}
 
-    for (; it != stacks.end(); ++it)
+void StacksBuilder::GetStacks(const std::vector<Query>& queries,
+                              std::vector<StackId>* stackIds) const
+{
+    stackIds->assign(queries.size(), kEmptyStackId);
+
+    std::vector<size_t> order;
+    base::SortQueries(
+        queries,
+        [](const Query& query) { return query.thread; },
+        [](const Query& query) { return query.ts; },
+        &order);
+
+    // Sweep the stacks of each thread with a single cursor.
+    size_t i = 0;
+    while (i < order.size())
     {
-        if (it->startTs > end)
-            return;
-        timestamp_t stackStart = std::max(start, it->startTs);
-        timestamp_t stackEnd = std::min(end, it->endTs);
-
-        callback(it->stackId, stackEnd - stackStart);
+        thread_t thread = queries[order[i]].thread;
+        Cursor cursor = GetCursor(thread);
+        for (; i < order.size() && queries[order[i]].thread == thread; ++i)
+            (*stackIds)[order[i]] = cursor.GetStack(queries[order[i]].ts);
     }
 }
 
-stacks::StackId StacksBuilder::GetStack(thread_t thread, timestamp_t ts) const
+StacksBuilder::Cursor StacksBuilder::GetCursor(thread_t thread) const
 {
     auto look = _stacks.find(thread);
     if (look == _stacks.end())
-      return kEmptyStackId;
-    const auto& stacks = look->second;
+        return Cursor();
+    return Cursor(&look->second);
+}
 
-    StacksComparator comparator;
-    auto it = std::upper_bound(
-        stacks.begin(), stacks.end(), ts, comparator);
-    if (it != stacks.begin())
-        --it;
-    if (it == stacks.end())
+size_t StacksBuilder::Cursor::FindFirstStack(timestamp_t start)
+{
+    const auto& stacks = *_stacks;
+
+    size_t position = base::GallopingPartitionPoint(
+        stacks.size(), _position,
+        [&](size_t index) { return stacks[index].startTs >= start; });
+    if (position != 0)
+        --position;
+    _position = position;
+    return position;
+}
+
+stacks::StackId StacksBuilder::Cursor::GetStack(timestamp_t ts)
+{
+    if (_stacks == nullptr)
+        return kEmptyStackId;
+    const auto& stacks = *_stacks;
+
+    // Find the last stack that starts at or before |ts|.
+    size_t position = base::GallopingPartitionPoint(
+        stacks.size(), _position,
+        [&](size_t index) { return stacks[index].startTs > ts; });
+    if (position == 0)
         return kEmptyStackId;
+    _position = --position;
 
-    if (it->startTs <= ts && it->endTs > ts)
-        return it->stackId;
+    const auto& stack = stacks[position];
+    if (stack.startTs <= ts && stack.endTs > ts)
+        return stack.stackId;
     return kEmptyStackId;
 }
 
@@ -233,12 +276,6 @@ bool StacksBuilder::StacksComparator::operator() (
     return stack.startTs < ts;
 }
 
-bool StacksBuilder::StacksComparator::operator() (
-    timestamp_t ts, const StackWrapper& stack) const
-{
-    return ts < stack.startTs;
-}
-
 void StacksBuilder::Terminate()
 {
     for (auto& stacks : _stacks)
@@ -18,6 +18,8 @@
 #ifndef _TIBEE_EXECUTION_STACKSBUILDER_HPP
 #define _TIBEE_EXECUTION_STACKSBUILDER_HPP
 
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 
@@ -32,10 +34,54 @@ namespace stacks
 
 class StacksBuilder
 {
+private:
+    struct StackWrapper;
+
 public:
     typedef std::function<void (
         StackId stackId, timestamp_t duration)> EnumerateStacksCallback;
 
+    // Query for the stack of a thread at a timestamp.
+    struct Query
+    {
+        Query() : thread(kInvalidThread), ts(0) {}
+        Query(thread_t thread, timestamp_t ts) : thread(thread), ts(ts) {}
+        thread_t thread;
+        timestamp_t ts;
+    };
+
+    // Remembers a position in the stacks of a thread, so that queries with
+    // increasing timestamps don't search the whole history. A cursor is
+    // invalidated by a cleanup.
+    class Cursor
+    {
+    public:
+        Cursor() : _stacks(nullptr), _position(0) {}
+
+        // Enumerate the stacks encountered in the specified time interval.
+        // The visitor receives (StackId stackId, timestamp_t duration).
+        template <typename Visitor>
+        void EnumerateStacks(timestamp_t start, timestamp_t end,
+                             Visitor&& visitor);
+
+        // Get the stack at the specified timestamp.
+        StackId GetStack(timestamp_t ts);
+
+    private:
+        friend class StacksBuilder;
+        explicit Cursor(const std::vector<StackWrapper>* stacks)
+            : _stacks(stacks), _position(0) {}
+
+        // Index of the last stack that starts before |start|.
+        size_t FindFirstStack(timestamp_t start);
+
+        // Stacks of the thread.
+        const std::vector<StackWrapper>* _stacks;
+
+        // Index of the stack returned by the last query.
+        size_t _position;
+    };
+
     StacksBuilder();
     ~StacksBuilder();
 
@@ -45,6 +91,9 @@ public:
     // Removes everything that is before the specified timestamp.
     void Cleanup(timestamp_t ts);
 
+    // Approximate number of bytes used by the history.
+    size_t ApproximateMemoryUsage() const;
+
     // Set database.
     void SetDatabase(db::Database* db) { _db = db; }
 
@@ -55,8 +104,13 @@ public:
     void SetNoStack(thread_t thread);
 
     // Start a system call on a thread.
+    void StartSystemCall(thread_t thread, StackId stackId);
     void StartSystemCall(thread_t thread, const std::string& syscall);
 
+    // Get the identifier of the stack of a system call, to start it many
+    // times without looking it up in the database.
+    StackId GetSystemCallStack(const std::string& syscall);
+
     // End a system call on a thread.
     void EndSytemCall(thread_t thread);
 
@@ -66,13 +120,27 @@ public:
     void SetLastSystemCallStack(thread_t thread, const std::vector<std::string>& stack);
 
     // Enumerate the stacks encountered on a thread in
-    // the specified time interval.
+    // the specified time interval. The visitor receives
+    // (StackId stackId, timestamp_t duration).
+    template <typename Visitor>
     void EnumerateStacks(thread_t thread, timestamp_t start, timestamp_t end,
-                         const EnumerateStacksCallback& callback) const;
+                         Visitor&& visitor) const
+    {
+        GetCursor(thread).EnumerateStacks(start, end, visitor);
+    }
 
     // Get the stack at the specified timestamp.
     stacks::StackId GetStack(thread_t thread, timestamp_t ts) const;
 
+    // Get the stacks of a batch of queries. |stackIds| receives the stack
+    // of each query, at the same index. Queries are grouped by thread, so
+    // that the stacks of each thread are traversed once.
+    void GetStacks(const std::vector<Query>& queries,
+                   std::vector<StackId>* stackIds) const;
+
+    // Get a cursor on the stacks of a thread.
+    Cursor GetCursor(thread_t thread) const;
+
     // Set the end timestamp of the last stack of each thread to now.
     void Terminate();
 
@@ -103,10 +171,29 @@ private:
     {
     public:
         bool operator() (const StackWrapper& stack, timestamp_t ts) const;
-        bool operator() (timestamp_t ts, const StackWrapper& stack) const;
     };
 };
 
+template <typename Visitor>
+void StacksBuilder::Cursor::EnumerateStacks(
+    timestamp_t start, timestamp_t end, Visitor&& visitor)
+{
+    if (_stacks == nullptr)
+        return;
+    const auto& stacks = *_stacks;
+
+    for (size_t i = FindFirstStack(start); i < stacks.size(); ++i)
+    {
+        const auto& stack = stacks[i];
+        if (stack.startTs > end)
+            return;
+        timestamp_t stackStart = std::max(start, stack.startTs);
+        timestamp_t stackEnd = std::min(end, stack.endTs);
+
+        visitor(stack.stackId, stackEnd - stackStart);
+    }
+}
+
 }  // namespace stacks
 }  // namespace tibee
 
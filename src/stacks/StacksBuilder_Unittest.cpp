@@ -140,5 +140,40 @@ TEST(StacksBuilder, EndEmpty)
     EXPECT_EQ(expectedStacks, stacks);
 }
 
+TEST(StacksBuilder, GetStacks)
+{
+    db::Database::DestroyTestDb();
+    db::Database db(true);
+    StacksBuilder builder;
+    builder.SetDatabase(&db);
+
+    builder.SetTimestamp(1000);
+    builder.SetStack(1, 1);
+    builder.SetStack(2, 4);
+    builder.SetTimestamp(2000);
+    builder.SetStack(1, 2);
+    builder.SetTimestamp(3000);
+    builder.SetStack(1, 3);
+    builder.SetTimestamp(4000);
+    builder.Terminate();
+
+    // Queries are not sorted by thread or by timestamp.
+    std::vector<StacksBuilder::Query> queries {
+        {1, 3500}, {2, 1500}, {1, 500}, {3, 2000}, {1, 2500}, {1, 1000},
+    };
+
+    std::vector<StackId> stackIds;
+    builder.GetStacks(queries, &stackIds);
+    ASSERT_EQ(queries.size(), stackIds.size());
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        EXPECT_EQ(builder.GetStack(queries[i].thread, queries[i].ts),
+                  stackIds[i]);
+    }
+    EXPECT_EQ(3u, stackIds[0]);
+    EXPECT_EQ(4u, stackIds[1]);
+    EXPECT_EQ(kEmptyStackId, stackIds[3]);
+}
+
 }  // namespace stacks
 }  // namespace tibee
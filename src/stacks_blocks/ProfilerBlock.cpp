@@ -17,8 +17,12 @@
  */
 #include "stacks_blocks/ProfilerBlock.hpp"
 
+#include <algorithm>
 #include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/predicate.hpp>
+#include <functional>
+#include <iostream>
+#include <string.h>
 
 #include "base/BindObject.hpp"
 #include "value/Value.hpp"
@@ -29,15 +33,17 @@ namespace stacks_blocks {
 namespace
 {
 
-using notification::RegexToken;
+using notification::AnyToken;
 using notification::Token;
+using stacks::StackRecord;
 
 const char kSyscallWithParamsPrefix[] = "syscall_entry_";
 
 }  // namespace
 
 ProfilerBlock::ProfilerBlock()
-    : _dumpStacks(false)
+    : _dumpStacks(false),
+      _pipeline(false)
 {
 }
 
@@ -48,6 +54,19 @@ ProfilerBlock::~ProfilerBlock()
 void ProfilerBlock::Start(const value::Value* params)
 {
     _dumpStacks = value::BoolValue::GetValue(params->GetField("dump"));
+    _pipeline = value::BoolValue::GetValue(params->GetField("pipeline"));
+}
+
+void ProfilerBlock::LoadServices(const block::ServiceList& serviceList)
+{
+    AbstractBuildBlock::LoadServices(serviceList);
+
+    // Symbolize the stacks and update the stacks builder on another thread.
+    if (_pipeline)
+    {
+        StacksPipeline()->Start(
+            std::bind(&ProfilerBlock::HandleRecord, this, std::placeholders::_1));
+    }
 }
 
 void ProfilerBlock::AddObservers(
@@ -63,24 +82,11 @@ void ProfilerBlock::AddObservers(
                    Token("lttng_profile:off_cpu_sample"),
                    base::BindObject(&ProfilerBlock::OnOffCpuSample, this));
 
+    // System call events are recognized by their event id, which is
+    // resolved once from the name of the event.
     AddKernelObserver(notificationCenter,
-                      RegexToken("^sys_"),
-                      base::BindObject(&ProfilerBlock::OnSyscallEntry, this));
-    AddKernelObserver(notificationCenter,
-                      RegexToken("^compat_sys_"),
-                      base::BindObject(&ProfilerBlock::OnSyscallEntry, this));
-    AddKernelObserver(notificationCenter,
-                      RegexToken("^syscall_entry_"),
-                      base::BindObject(&ProfilerBlock::OnSyscallEntry, this));
-    AddKernelObserver(notificationCenter,
-                      RegexToken("^syscall_exit_"),
-                      base::BindObject(&ProfilerBlock::OnSyscallExit, this));
-    AddKernelObserver(notificationCenter,
-                      RegexToken("^compat_syscall_exit_"),
-                      base::BindObject(&ProfilerBlock::OnSyscallExit, this));
-    AddKernelObserver(notificationCenter,
-                      Token("exit_syscall"),
-                      base::BindObject(&ProfilerBlock::OnSyscallExit, this));
+                      AnyToken(),
+                      base::BindObject(&ProfilerBlock::OnKernelEvent, this));
     AddKernelObserver(notificationCenter,
                       Token("syscall_latency"),
                       base::BindObject(&ProfilerBlock::OnSyscallLatency, this));
@@ -88,98 +94,282 @@ void ProfilerBlock::AddObservers(
 
 void ProfilerBlock::OnBaddr(const trace::EventValue& event)
 {
-    process_t pid = ProcessForEvent(event);
-    uint64_t baddr = event.getEventField("baddr")->AsULong();
-    std::string sopath = event.getEventField("sopath")->AsString();
-    uint64_t size = event.getEventField("size")->AsULong();
+    StackRecord record;
+    record.type = StackRecord::kImage;
+    record.process = ProcessForEvent(event);
+    record.address = event.getEventField("baddr")->AsULong();
+    record.value = event.getEventField("size")->AsULong();
+    record.name = InternString(event.getEventField("sopath")->AsString());
+    PushRecord(&record);
+}
 
-    symbols::Image image;
-    image.set_path(sopath);
-    image.set_base_address(baddr);
-    image.set_size(size);
+void ProfilerBlock::OnOnCpuSample(const trace::EventValue& event)
+{
+    // Symbolizing a stack is expensive: skip samples outside the executions.
+    if (!InExecutionWindow())
+        return;
+
+    StackRecord record;
+    record.type = StackRecord::kOnCpuSample;
+    ReadStack(event, &record);
+    PushRecord(&record);
+}
 
-    if (baddr == 0x400000)
-    {
-        image.set_offset(0x400000);
-        image.set_base_address(0x400000);
-    }
+void ProfilerBlock::OnOffCpuSample(const trace::EventValue& event)
+{
+    if (!InExecutionWindow())
+        return;
 
-    _images[pid].push_back(image);
+    StackRecord record;
+    record.type = StackRecord::kOffCpuSample;
+    ReadStack(event, &record);
+    PushRecord(&record);
 }
 
-void ProfilerBlock::OnOnCpuSample(const trace::EventValue& event)
+void ProfilerBlock::OnKernelEvent(const trace::EventValue& event)
 {
-    thread_t tid = ThreadForEvent(event);
-    std::vector<std::string> stack;
+    const auto& slot = GetKernelEventSlot(event);
 
-    if (_dumpStacks)
-        std::cout << "[on-cpu] Thread " << tid << std::endl;
+    switch (slot.kind)
+    {
+        case KernelEventSlot::kSyscallEntry:
+            OnSyscallEntry(event, slot);
+            break;
+        case KernelEventSlot::kSyscallExit:
+            OnSyscallExit(event);
+            break;
+        default:
+            break;
+    }
+}
 
-    ReadStack(event, &stack);
+void ProfilerBlock::OnSyscallEntry(const trace::EventValue& event,
+                                   const KernelEventSlot& slot)
+{
+    StackRecord record;
+    record.type = StackRecord::kSyscallEntry;
+    record.thread = ThreadForEvent(event);
+    record.value = slot.syscall;
+    record.name = slot.name;
+    PushRecord(&record);
+}
 
-    Stacks()->SetStack(tid, stack);
+void ProfilerBlock::OnSyscallExit(const trace::EventValue& event)
+{
+    StackRecord record;
+    record.type = StackRecord::kSyscallExit;
+    record.thread = ThreadForEvent(event);
+    PushRecord(&record);
 }
 
-void ProfilerBlock::OnOffCpuSample(const trace::EventValue& event)
+void ProfilerBlock::OnSyscallLatency(const trace::EventValue& event)
+{
+    StackRecord record;
+    record.type = StackRecord::kSyscallLatency;
+    record.thread = ThreadForEvent(event);
+    record.value = event.getEventField("duration")->AsULong();
+    PushRecord(&record);
+}
+
+const ProfilerBlock::KernelEventSlot& ProfilerBlock::GetKernelEventSlot(
+    const trace::EventValue& event)
 {
-    thread_t tid = ThreadForEvent(event);
-    std::vector<std::string> stack;
+    size_t id = event.getId();
+    if (id >= _kernelEvents.size())
+        _kernelEvents.resize(id + 1);
+
+    // The first slot of an id matches, unless traces with different event
+    // ids are read together. Names are interned: comparing the pointers is
+    // enough.
+    auto& slots = _kernelEvents[id];
+    const char* eventName = EventNamePointer(event);
+    for (const auto& slot : slots)
+    {
+        if (slot.eventName == eventName)
+            return slot;
+    }
 
-    if (_dumpStacks)
-        std::cout << "[off-cpu] Thread " << tid << std::endl;
+    slots.push_back(KernelEventSlot());
+    auto& slot = slots.back();
+    slot.eventName = eventName;
 
-    ReadStack(event, &stack);
+    std::string name = eventName;
+    if (boost::starts_with(name, "sys_") ||
+        boost::starts_with(name, "compat_sys_"))
+    {
+        slot.kind = KernelEventSlot::kSyscallEntry;
+    }
+    else if (boost::starts_with(name, kSyscallWithParamsPrefix))
+    {
+        slot.kind = KernelEventSlot::kSyscallEntry;
+        name = name.substr(strlen(kSyscallWithParamsPrefix));
+    }
+    else if (boost::starts_with(name, "syscall_exit_") ||
+             boost::starts_with(name, "compat_syscall_exit_") ||
+             name == "exit_syscall")
+    {
+        slot.kind = KernelEventSlot::kSyscallExit;
+        return slot;
+    }
+    else
+    {
+        slot.kind = KernelEventSlot::kOther;
+        return slot;
+    }
 
-    Stacks()->SetLastSystemCallStack(tid, stack);
+    slot.syscall = GetSyscallIndex(name);
+    slot.name = &_syscalls.find(name)->first;
+    return slot;
 }
 
-void ProfilerBlock::OnSyscallEntry(const trace::EventValue& event)
+uint32_t ProfilerBlock::GetSyscallIndex(const std::string& syscall)
 {
-    thread_t tid = ThreadForEvent(event);
+    auto look = _syscalls.find(syscall);
+    if (look != _syscalls.end())
+        return look->second;
+    uint32_t index = _syscalls.size();
+    _syscalls[syscall] = index;
+    return index;
+}
 
-    std::string syscall = event.getName();
-    if (syscall.find(kSyscallWithParamsPrefix) == 0)
-        syscall = syscall.substr(strlen(kSyscallWithParamsPrefix));
+void ProfilerBlock::ReadStack(const trace::EventValue& event,
+                              StackRecord* record)
+{
+    record->thread = ThreadForEvent(event);
+    record->process = ProcessForEvent(event);
 
-    Stacks()->StartSystemCall(tid, syscall);
+    const auto* stackField = value::ArrayValue::Cast(event.getEventField("stack"));
+    for (const auto& addressValue : *stackField)
+        record->PushAddress(addressValue.AsULong());
 }
 
-void ProfilerBlock::OnSyscallExit(const trace::EventValue& event)
+void ProfilerBlock::PushRecord(StackRecord* record)
 {
-    thread_t tid = ThreadForEvent(event);
-    Stacks()->EndSytemCall(tid);
+    record->ts = State()->timestamp();
+
+    if (_pipeline)
+        StacksPipeline()->Push(*record);
+    else
+        HandleRecord(*record);
 }
 
-void ProfilerBlock::OnSyscallLatency(const trace::EventValue& event)
+const std::string* ProfilerBlock::InternString(const std::string& str)
 {
-    thread_t tid = ThreadForEvent(event);
-
-    auto duration = event.getEventField("duration")->AsULong();
+    return &*_strings.insert(str).first;
+}
 
-    auto ts = State()->timestamp();
+void ProfilerBlock::HandleRecord(const StackRecord& record)
+{
+    Stacks()->SetTimestamp(record.ts);
 
-    Stacks()->SetTimestamp(ts - duration);
-    Stacks()->StartSystemCall(tid, "syscall");
-    Stacks()->SetTimestamp(ts);
-    Stacks()->EndSytemCall(tid);
+    switch (record.type)
+    {
+        case StackRecord::kImage:
+        {
+            symbols::Image image;
+            image.set_path(*record.name);
+            image.set_base_address(record.address);
+            image.set_size(record.value);
+
+            if (record.address == 0x400000)
+            {
+                image.set_offset(0x400000);
+                image.set_base_address(0x400000);
+            }
+
+            auto& processImages = _images[record.process];
+            processImages.images.push_back(image);
+            if (image.size() != 0)
+            {
+                processImages.index.Insert(
+                    containers::Interval(image.base_address(),
+                                         image.base_address() + image.size() - 1),
+                    processImages.images.size() - 1);
+            }
+            break;
+        }
+
+        case StackRecord::kOnCpuSample:
+        {
+            if (_dumpStacks)
+                std::cout << "[on-cpu] Thread " << record.thread << std::endl;
+
+            std::vector<std::string> stack;
+            SymbolizeStack(record, &stack);
+            Stacks()->SetStack(record.thread, stack);
+            break;
+        }
+
+        case StackRecord::kOffCpuSample:
+        {
+            if (_dumpStacks)
+                std::cout << "[off-cpu] Thread " << record.thread << std::endl;
+
+            std::vector<std::string> stack;
+            SymbolizeStack(record, &stack);
+            Stacks()->SetLastSystemCallStack(record.thread, stack);
+            break;
+        }
+
+        case StackRecord::kSyscallEntry:
+        {
+            // Look up the stack of a system call only the first time.
+            size_t syscall = record.value;
+            if (syscall >= _syscallStacks.size())
+                _syscallStacks.resize(syscall + 1, stacks::kEmptyStackId);
+            if (_syscallStacks[syscall] == stacks::kEmptyStackId)
+                _syscallStacks[syscall] = Stacks()->GetSystemCallStack(*record.name);
+            Stacks()->StartSystemCall(record.thread, _syscallStacks[syscall]);
+            break;
+        }
+
+        case StackRecord::kSyscallExit:
+            Stacks()->EndSytemCall(record.thread);
+            break;
+
+        case StackRecord::kSyscallLatency:
+            Stacks()->SetTimestamp(record.ts - record.value);
+            Stacks()->StartSystemCall(record.thread, "syscall");
+            Stacks()->SetTimestamp(record.ts);
+            Stacks()->EndSytemCall(record.thread);
+            break;
+    }
 }
 
-void ProfilerBlock::ReadStack(const trace::EventValue& event,
-                              std::vector<std::string>* stack)
+const symbols::Image* ProfilerBlock::FindImage(const ProcessImages& images,
+                                               uint64_t address)
 {
-    process_t pid = ProcessForEvent(event);
+    // Images are never unloaded: like a scan of the images in load order,
+    // prefer the first one loaded at this address.
+    size_t first = images.images.size();
+    images.index.EnumerateIntersection(
+        containers::Interval(address, address),
+        [&](const containers::PooledIntervalTree<size_t>::ElementPair& element) {
+            first = std::min(first, element.second);
+        });
+    if (first == images.images.size())
+        return nullptr;
+    return &images.images[first];
+}
 
-    std::vector<std::string> symbolizedStack;
-    const auto* stackField = value::ArrayValue::Cast(event.getEventField("stack"));
+void ProfilerBlock::SymbolizeStack(const StackRecord& record,
+                                   std::vector<std::string>* stack)
+{
+    const auto& images = _images[record.process];
+    const uint64_t* addresses = record.GetAddresses();
 
-    for (const auto& addressValue : *stackField)
+    for (size_t i = 0; i < record.depth; ++i)
     {
-        uint64_t address = addressValue.AsULong();
+        uint64_t address = addresses[i];
 
         symbols::Symbol symbol;
         uint64_t offset = 0;
-        if (!_symbols.LookupSymbol(address, _images[pid], &symbol, &offset))
+        const auto* image = FindImage(images, address);
+        if (image == nullptr ||
+            !_symbols.LookupSymbol(address, *image, &symbol, &offset))
+        {
             symbol.set_name("Unknown Symbol");
+        }
         if (boost::starts_with(symbol.name(), "lttng_profile"))
             continue;
 
@@ -19,10 +19,15 @@
 #define _TIBEE_STACKSBLOCKS_PROFILERBLOCK_HPP
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "base/BasicTypes.hpp"
 #include "build_blocks/AbstractBuildBlock.hpp"
+#include "containers/PooledIntervalTree.hpp"
+#include "stacks/Identifiers.hpp"
+#include "stacks/StackRecord.hpp"
 #include "symbols/SymbolLookup.hpp"
 #include "trace/value/EventValue.hpp"
 
@@ -32,6 +37,10 @@ namespace stacks_blocks {
 /**
  * Blocks that handles lttng-profile events.
  *
+ * Events are decoded into stack records. In pipeline mode, the records are
+ * symbolized and applied to the stacks builder on the thread of the stacks
+ * pipeline, in the order of the trace.
+ *
  * @author Francois Doray
  */
 class ProfilerBlock : public build_blocks::AbstractBuildBlock
@@ -41,24 +50,110 @@ public:
     ~ProfilerBlock();
 
     virtual void Start(const value::Value* params) override;
+    virtual void LoadServices(const block::ServiceList& serviceList) override;
     virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
 
 private:
+    // What a kernel event means for the stacks, resolved once per event
+    // name and id.
+    struct KernelEventSlot
+    {
+        enum Kind : uint8_t
+        {
+            kOther,
+            kSyscallEntry,
+            kSyscallExit,
+        };
+
+        KernelEventSlot()
+            : eventName(nullptr), kind(kOther), syscall(0), name(nullptr) {}
+
+        // Name of the event, as interned by the trace reader: the same
+        // name always has the same pointer. Event ids are only unique
+        // within a stream class of a trace, so the same id can have other
+        // names.
+        const char* eventName;
+
+        Kind kind;
+
+        // Index of the system call started by the event.
+        uint32_t syscall;
+
+        // Name of the system call started by the event.
+        const std::string* name;
+    };
+
     void OnBaddr(const trace::EventValue& event);
     void OnOnCpuSample(const trace::EventValue& event);
     void OnOffCpuSample(const trace::EventValue& event);
-    void OnSyscallEntry(const trace::EventValue& event);
+    void OnKernelEvent(const trace::EventValue& event);
+    void OnSyscallEntry(const trace::EventValue& event,
+                        const KernelEventSlot& slot);
     void OnSyscallExit(const trace::EventValue& event);
 
     void OnSyscallLatency(const trace::EventValue& event);
 
-    void ReadStack(const trace::EventValue& event, std::vector<std::string>* stack);
+    // Returns the slot of |event|, resolving it from the name of the event
+    // the first time this name is seen with this id. Otherwise, only the
+    // id and the name pointer are compared.
+    const KernelEventSlot& GetKernelEventSlot(const trace::EventValue& event);
+
+    // Returns the index of a system call, assigning one if needed.
+    uint32_t GetSyscallIndex(const std::string& syscall);
+
+    // Reads the thread, the process and the addresses of a stack sample.
+    void ReadStack(const trace::EventValue& event, stacks::StackRecord* record);
+
+    // Timestamps a record and hands it to the stacks pipeline, or handles
+    // it immediately when there is no pipeline.
+    void PushRecord(stacks::StackRecord* record);
+
+    // Returns a pointer to a copy of |str| that lives as long as the block.
+    const std::string* InternString(const std::string& str);
+
+    // Applies a record to the stacks builder.
+    void HandleRecord(const stacks::StackRecord& record);
+
+    // Images loaded in a process, indexed by address range.
+    struct ProcessImages
+    {
+        // The images, in the order in which they were loaded.
+        symbols::ImageVector images;
+
+        // Index in |images| of the image loaded at each address range.
+        containers::PooledIntervalTree<size_t> index;
+    };
+
+    // Returns the first loaded image that contains |address|, or nullptr.
+    static const symbols::Image* FindImage(const ProcessImages& images,
+                                           uint64_t address);
+
+    // Symbolizes the addresses of a stack sample.
+    void SymbolizeStack(const stacks::StackRecord& record,
+                        std::vector<std::string>* stack);
 
     // Dump stacks to std output.
     bool _dumpStacks;
 
-    // Images loaded in each process.
-    std::unordered_map<process_t, symbols::ImageVector> _images;
+    // Handle the records on the thread of the stacks pipeline.
+    bool _pipeline;
+
+    // Strings referenced by records.
+    std::unordered_set<std::string> _strings;
+
+    // Slots of the kernel events, indexed by event id. An id has a slot
+    // for each trace in which it names a different event.
+    std::vector<std::vector<KernelEventSlot>> _kernelEvents;
+
+    // Index of each system call name.
+    std::unordered_map<std::string, uint32_t> _syscalls;
+
+    // Stack of each system call, indexed by system call index. Only accessed
+    // by HandleRecord().
+    std::vector<stacks::StackId> _syscallStacks;
+
+    // Images loaded in each process. Only accessed by HandleRecord().
+    std::unordered_map<process_t, ProcessImages> _images;
 
     // Modules that resolves symbols.
     symbols::SymbolLookup _symbols;
@@ -0,0 +1,492 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_STATE_CHUNKEDHISTORY_HPP_
+#define TIBEE_STATE_CHUNKEDHISTORY_HPP_
+
+#include <algorithm>
+#include <assert.h>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+#include "base/MemoryUsage.hpp"
+#include "base/SortedSearch.hpp"
+#include "state/AttributeKey.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+// Query for the value of an attribute at a timestamp.
+struct HistoryQuery
+{
+    HistoryQuery() : ts(0) {}
+    HistoryQuery(AttributeKey key, timestamp_t ts) : key(key), ts(ts) {}
+    AttributeKey key;
+    timestamp_t ts;
+};
+
+/**
+ * History of the values of a set of attributes.
+ *
+ * Attribute keys are mapped to dense slots. The history of a slot is split
+ * in chunks. Each chunk stores its timestamps and its values in separate
+ * arrays, and its timestamps as 32-bit offsets from the first timestamp of
+ * the chunk. A cleanup drops the chunks that are entirely before the
+ * cleanup timestamp without copying the other ones.
+ *
+ * @author Francois Doray
+ */
+template <typename T>
+class ChunkedHistory
+{
+public:
+    typedef size_t Slot;
+    static const Slot kInvalidSlot = static_cast<Slot>(-1);
+
+    // Remembers a position in the history of a slot, so that queries with
+    // increasing timestamps don't search the whole history. A cursor is
+    // invalidated by a cleanup.
+    class Cursor
+    {
+    public:
+        Cursor() : _slot(kInvalidSlot), _chunk(0), _entry(0) {}
+
+    private:
+        friend class ChunkedHistory;
+        explicit Cursor(Slot slot) : _slot(slot), _chunk(0), _entry(0) {}
+
+        // Slot of the cursor.
+        Slot _slot;
+
+        // Position of the entry returned by the last query.
+        size_t _chunk;
+        size_t _entry;
+    };
+
+    // Result of a query.
+    struct Result
+    {
+        Result() : found(false), value() {}
+        bool found;
+        T value;
+    };
+
+    ChunkedHistory() {}
+    ~ChunkedHistory() {}
+
+    // Get the slot of an attribute, or kInvalidSlot if it has no history.
+    Slot GetSlot(AttributeKey key) const
+    {
+        auto look = _slots.find(key);
+        if (look == _slots.end())
+            return kInvalidSlot;
+        return look->second;
+    }
+
+    // Get the slot of an attribute, creating it if necessary.
+    Slot GetOrCreateSlot(AttributeKey key)
+    {
+        auto look = _slots.find(key);
+        if (look != _slots.end())
+            return look->second;
+        Slot slot = _series.size();
+        _slots[key] = slot;
+        _series.push_back(Series());
+        return slot;
+    }
+
+    // Indicates whether the attribute has a history.
+    bool Contains(AttributeKey key) const
+    {
+        return _slots.find(key) != _slots.end();
+    }
+
+    // Append a value at the specified timestamp, unless it is
+    // equal to the last value of the slot. Timestamps must be increasing.
+    void Append(Slot slot, timestamp_t ts, T value);
+
+    // Get the last value of a slot.
+    bool GetLastValue(Slot slot, T* value) const;
+
+    // Get the value of a slot at the specified timestamp.
+    bool GetValue(Slot slot, timestamp_t ts, T* value) const;
+
+    // Get a cursor on the history of a slot.
+    Cursor GetCursor(Slot slot) const { return Cursor(slot); }
+
+    // Get the value of the slot of a cursor at the specified timestamp,
+    // starting the search from the last position of the cursor.
+    bool GetValue(Cursor* cursor, timestamp_t ts, T* value) const;
+
+    // Answer a batch of queries. |results| receives the result of each
+    // query, at the same index. Queries are grouped by attribute, so that
+    // the history of each attribute is traversed once.
+    void GetValues(const std::vector<HistoryQuery>& queries,
+                   std::vector<Result>* results) const;
+
+    // Enumerate the values of a slot in the specified interval. The
+    // visitor receives (value, start, end).
+    template <typename Visitor>
+    void EnumerateValues(Slot slot, timestamp_t start, timestamp_t end,
+                         Visitor&& visitor) const;
+
+    // Removes everything that is before the specified timestamp, except
+    // the values that are still valid at that timestamp.
+    void Cleanup(timestamp_t ts);
+
+    // Approximate number of bytes used by the history.
+    size_t ApproximateMemoryUsage() const;
+
+private:
+    // Maximum duration covered by a chunk, so that offsets fit in 32 bits.
+    static const timestamp_t kMaxChunkDuration =
+        std::numeric_limits<uint32_t>::max();
+
+    struct Chunk
+    {
+        explicit Chunk(timestamp_t baseTs) : baseTs(baseTs) {}
+
+        timestamp_t ts(size_t index) const { return baseTs + offsets[index]; }
+
+        // Timestamp of the first entry of the chunk.
+        timestamp_t baseTs;
+
+        // Timestamps of the entries, relative to |baseTs|.
+        std::vector<uint32_t> offsets;
+
+        // Values of the entries.
+        std::vector<T> values;
+    };
+
+    struct Series
+    {
+        Series() : begin(0) {}
+
+        // Chunks, ordered by timestamp.
+        std::deque<Chunk> chunks;
+
+        // Index of the first valid entry in the first chunk.
+        size_t begin;
+    };
+
+    // Position of an entry in a series.
+    struct Position
+    {
+        Position() : chunk(0), entry(0) {}
+        Position(size_t chunk, size_t entry) : chunk(chunk), entry(entry) {}
+        size_t chunk;
+        size_t entry;
+    };
+
+    // Find the last entry of |series| that is at or before |ts|.
+    bool FindEntry(const Series& series, timestamp_t ts,
+                   Position* position) const;
+
+    // Attribute key -> slot.
+    std::unordered_map<AttributeKey, Slot> _slots;
+
+    // History of each slot.
+    std::vector<Series> _series;
+};
+
+template <typename T>
+const typename ChunkedHistory<T>::Slot ChunkedHistory<T>::kInvalidSlot;
+
+template <typename T>
+const timestamp_t ChunkedHistory<T>::kMaxChunkDuration;
+
+template <typename T>
+void ChunkedHistory<T>::Append(Slot slot, timestamp_t ts, T value)
+{
+    assert(slot < _series.size());
+    auto& series = _series[slot];
+
+    if (!series.chunks.empty())
+    {
+        auto& last = series.chunks.back();
+        if (last.values.back() == value)
+            return;
+        assert(ts >= last.ts(last.offsets.size() - 1));
+        if (ts - last.baseTs <= kMaxChunkDuration)
+        {
+            last.offsets.push_back(static_cast<uint32_t>(ts - last.baseTs));
+            last.values.push_back(value);
+            return;
+        }
+    }
+
+    series.chunks.push_back(Chunk(ts));
+    series.chunks.back().offsets.push_back(0);
+    series.chunks.back().values.push_back(value);
+}
+
+template <typename T>
+bool ChunkedHistory<T>::GetLastValue(Slot slot, T* value) const
+{
+    if (slot >= _series.size() || _series[slot].chunks.empty())
+        return false;
+    *value = _series[slot].chunks.back().values.back();
+    return true;
+}
+
+template <typename T>
+bool ChunkedHistory<T>::GetValue(Slot slot, timestamp_t ts, T* value) const
+{
+    if (slot >= _series.size())
+        return false;
+
+    const auto& series = _series[slot];
+    Position position;
+    if (!FindEntry(series, ts, &position))
+        return false;
+
+    *value = series.chunks[position.chunk].values[position.entry];
+    return true;
+}
+
+template <typename T>
+bool ChunkedHistory<T>::GetValue(
+    Cursor* cursor, timestamp_t ts, T* value) const
+{
+    if (cursor->_slot >= _series.size())
+        return false;
+
+    const auto& series = _series[cursor->_slot];
+    const auto& chunks = series.chunks;
+    if (chunks.empty())
+        return false;
+
+    // Search the chunk of the cursor if it covers |ts|.
+    size_t chunkIndex = cursor->_chunk;
+    if (chunkIndex >= chunks.size() ||
+        chunks[chunkIndex].baseTs > ts ||
+        (chunkIndex + 1 < chunks.size() && chunks[chunkIndex + 1].baseTs <= ts))
+    {
+        Position position;
+        if (!FindEntry(series, ts, &position))
+            return false;
+        cursor->_chunk = position.chunk;
+        cursor->_entry = position.entry;
+        *value = chunks[position.chunk].values[position.entry];
+        return true;
+    }
+
+    const auto& chunk = chunks[chunkIndex];
+    size_t begin = (chunkIndex == 0) ? series.begin : 0;
+    if (ts < chunk.ts(begin))
+        return false;
+
+    size_t entryIndex = chunk.offsets.size() - 1;
+    if (ts - chunk.baseTs <= kMaxChunkDuration)
+    {
+        const uint32_t* offsets = chunk.offsets.data() + begin;
+        uint32_t offset = static_cast<uint32_t>(ts - chunk.baseTs);
+        size_t hint = cursor->_entry > begin ? cursor->_entry - begin : 0;
+        entryIndex = begin + base::GallopingPartitionPoint(
+            chunk.offsets.size() - begin, hint,
+            [&](size_t index) { return offsets[index] > offset; }) - 1;
+    }
+
+    cursor->_entry = entryIndex;
+    *value = chunk.values[entryIndex];
+    return true;
+}
+
+template <typename T>
+void ChunkedHistory<T>::GetValues(
+    const std::vector<HistoryQuery>& queries,
+    std::vector<Result>* results) const
+{
+    results->assign(queries.size(), Result());
+
+    std::vector<size_t> order;
+    base::SortQueries(
+        queries,
+        [](const HistoryQuery& query) { return query.key.get(); },
+        [](const HistoryQuery& query) { return query.ts; },
+        &order);
+
+    // Sweep the history of each attribute with a single cursor.
+    size_t i = 0;
+    while (i < order.size())
+    {
+        AttributeKey key = queries[order[i]].key;
+        Cursor cursor = GetCursor(GetSlot(key));
+        for (; i < order.size() && queries[order[i]].key == key; ++i)
+        {
+            auto& result = (*results)[order[i]];
+            result.found = GetValue(&cursor, queries[order[i]].ts, &result.value);
+        }
+    }
+}
+
+template <typename T>
+template <typename Visitor>
+void ChunkedHistory<T>::EnumerateValues(
+    Slot slot, timestamp_t start, timestamp_t end,
+    Visitor&& visitor) const
+{
+    if (slot >= _series.size())
+        return;
+
+    const auto& series = _series[slot];
+    if (series.chunks.empty())
+        return;
+
+    // Start from the value that is valid at |start|, or from the first
+    // value if there is none.
+    Position position(0, series.begin);
+    FindEntry(series, start, &position);
+
+    const auto& chunks = series.chunks;
+    while (position.chunk < chunks.size())
+    {
+        const auto& chunk = chunks[position.chunk];
+        timestamp_t entryTs = chunk.ts(position.entry);
+        if (entryTs >= end)
+            return;
+
+        // Move to the next entry to find the end of this one.
+        Position next(position.chunk, position.entry + 1);
+        if (next.entry == chunk.offsets.size())
+        {
+            ++next.chunk;
+            next.entry = 0;
+        }
+
+        timestamp_t intervalStart = std::max(entryTs, start);
+        timestamp_t intervalEnd = end;
+        if (next.chunk < chunks.size())
+            intervalEnd = std::min(chunks[next.chunk].ts(next.entry), end);
+
+        visitor(chunk.values[position.entry], intervalStart, intervalEnd);
+
+        position = next;
+    }
+}
+
+template <typename T>
+void ChunkedHistory<T>::Cleanup(timestamp_t ts)
+{
+    for (auto& series : _series)
+    {
+        auto& chunks = series.chunks;
+        if (chunks.empty())
+            continue;
+
+        // Drop the first chunk while the next one starts before |ts|: the
+        // value valid at |ts| is then in the next chunk or after it.
+        while (chunks.size() > 1 && chunks[1].baseTs < ts)
+        {
+            chunks.pop_front();
+            series.begin = 0;
+        }
+
+        // Keep the last entry that is before |ts| in the first chunk.
+        auto& first = chunks.front();
+        if (ts <= first.baseTs)
+            continue;
+
+        size_t firstIndex = 0;
+        if (ts - first.baseTs > kMaxChunkDuration)
+        {
+            firstIndex = first.offsets.size() - 1;
+        }
+        else
+        {
+            const uint32_t* offsets = first.offsets.data();
+            const uint32_t* lower = base::BranchlessLowerBound(
+                offsets, first.offsets.size(),
+                static_cast<uint32_t>(ts - first.baseTs));
+            firstIndex = (lower - offsets) - 1;
+        }
+
+        series.begin = std::max(series.begin, firstIndex);
+    }
+}
+
+template <typename T>
+size_t ChunkedHistory<T>::ApproximateMemoryUsage() const
+{
+    size_t usage = base::HashMapMemoryUsage(_slots) +
+                   base::VectorMemoryUsage(_series);
+    for (const auto& series : _series)
+    {
+        for (const auto& chunk : series.chunks)
+        {
+            usage += sizeof(Chunk) +
+                     base::VectorMemoryUsage(chunk.offsets) +
+                     base::VectorMemoryUsage(chunk.values);
+        }
+    }
+    return usage;
+}
+
+template <typename T>
+bool ChunkedHistory<T>::FindEntry(
+    const Series& series, timestamp_t ts, Position* position) const
+{
+    const auto& chunks = series.chunks;
+    if (chunks.empty())
+        return false;
+
+    // Find the last chunk that starts at or before |ts|.
+    size_t chunkIndex = 0;
+    if (chunks.size() > 1)
+    {
+        size_t low = 0;
+        size_t high = chunks.size();
+        while (high - low > 1)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (chunks[middle].baseTs <= ts)
+                low = middle;
+            else
+                high = middle;
+        }
+        chunkIndex = low;
+    }
+
+    const auto& chunk = chunks[chunkIndex];
+    size_t begin = (chunkIndex == 0) ? series.begin : 0;
+    if (ts < chunk.ts(begin))
+        return false;
+
+    size_t entryIndex = chunk.offsets.size() - 1;
+    if (ts - chunk.baseTs <= kMaxChunkDuration)
+    {
+        const uint32_t* offsets = chunk.offsets.data() + begin;
+        const uint32_t* upper = base::BranchlessUpperBound(
+            offsets, chunk.offsets.size() - begin,
+            static_cast<uint32_t>(ts - chunk.baseTs));
+        entryIndex = begin + (upper - offsets) - 1;
+    }
+
+    position->chunk = chunkIndex;
+    position->entry = entryIndex;
+    return true;
+}
+
+}  // namespace state
+}  // namespace tibee
+
+#endif  // TIBEE_STATE_CHUNKEDHISTORY_HPP_
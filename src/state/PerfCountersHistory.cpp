@@ -0,0 +1,318 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "state/PerfCountersHistory.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+#include "base/CleanContainer.hpp"
+#include "base/MemoryUsage.hpp"
+#include "base/SortedSearch.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+PerfCountersHistory::PerfCountersHistory()
+    : _ts(0)
+{
+}
+
+PerfCountersHistory::~PerfCountersHistory()
+{
+}
+
+void PerfCountersHistory::Cleanup(timestamp_t ts)
+{
+    size_t numColumns = NumColumns();
+
+    for (auto& history : _threads)
+    {
+        // Keep the last row that is before |ts|.
+        auto it = std::lower_bound(
+            history.timestamps.begin(), history.timestamps.end(), ts);
+        if (it == history.timestamps.begin())
+            continue;
+        --it;
+
+        size_t firstRow = it - history.timestamps.begin();
+        base::CleanVector(it, history.timestamps.end(), &history.timestamps);
+        base::CleanVector(history.values.begin() + firstRow * numColumns,
+                          history.values.end(), &history.values);
+        base::CleanVector(history.masks.begin() + firstRow,
+                          history.masks.end(), &history.masks);
+    }
+}
+
+size_t PerfCountersHistory::ApproximateMemoryUsage() const
+{
+    size_t usage = base::HashMapMemoryUsage(_threadSlots) +
+                   base::VectorMemoryUsage(_threads);
+    for (const auto& history : _threads)
+    {
+        usage += base::VectorMemoryUsage(history.timestamps) +
+                 base::VectorMemoryUsage(history.values) +
+                 base::VectorMemoryUsage(history.masks) +
+                 base::VectorMemoryUsage(history.states);
+    }
+    return usage;
+}
+
+PerfCountersHistory::Column PerfCountersHistory::AddCounter(size_t counter)
+{
+    auto look = std::find(_counters.begin(), _counters.end(), counter);
+    if (look != _counters.end())
+        return look - _counters.begin();
+
+    assert(_counters.size() < kMaxColumns);
+
+    // Widen the rows that were already added.
+    size_t numColumns = NumColumns();
+    for (auto& history : _threads)
+    {
+        std::vector<uint64_t> values;
+        values.reserve(history.timestamps.size() * (numColumns + 1));
+        for (size_t row = 0; row < history.timestamps.size(); ++row)
+        {
+            auto rowBegin = history.values.begin() + row * numColumns;
+            values.insert(values.end(), rowBegin, rowBegin + numColumns);
+            values.push_back(0);
+        }
+        history.values.swap(values);
+        history.states.resize(numColumns + 1);
+    }
+
+    _counters.push_back(counter);
+    return numColumns;
+}
+
+PerfCountersHistory::ThreadSlot PerfCountersHistory::GetThreadSlot(
+    thread_t thread)
+{
+    auto look = _threadSlots.find(thread);
+    if (look != _threadSlots.end())
+        return look->second;
+    ThreadSlot slot = _threads.size();
+    _threadSlots[thread] = slot;
+    _threads.push_back(ThreadHistory());
+    return slot;
+}
+
+void PerfCountersHistory::SetCpuBaseValue(
+    ThreadSlot slot, Column column, uint64_t value)
+{
+    auto& history = GetThreadHistory(slot);
+    auto& state = history.states[column];
+    state.cpuAbsolute = value;
+    state.cpuReal = GetLastValue(history, column);
+
+    if (!HasValue(history, column))
+        SetCpuValue(slot, column, value);
+}
+
+void PerfCountersHistory::SetCpuValue(
+    ThreadSlot slot, Column column, uint64_t value)
+{
+    // Make sure that this is not the first value we get for this counter.
+    auto& history = GetThreadHistory(slot);
+    auto& state = history.states[column];
+    if (state.cpuAbsolute == kInvalid || state.cpuAbsolute > value)
+    {
+        SetCpuBaseValue(slot, column, value);
+        return;
+    }
+
+    // Compute the minimum value that the thread perf counter must have now.
+    auto minDiff = value - state.cpuAbsolute;
+    auto minReal = state.cpuReal + minDiff;
+
+    // Set the new value of the performance counter.
+    auto real = std::max(GetLastValue(history, column), minReal);
+    SetValue(&history, column, real);
+
+    // Keep track of the state.
+    state.cpuAbsolute = value;
+    state.cpuReal = real;
+}
+
+void PerfCountersHistory::SetThreadValue(
+    ThreadSlot slot, Column column, uint64_t value)
+{
+    auto& history = GetThreadHistory(slot);
+    auto& state = history.states[column];
+
+    if (state.threadAbsolute == kInvalid)
+    {
+        // This is the first thread value we got. Keep track of it.
+        state.threadAbsolute = value;
+        state.threadReal = GetLastValue(history, column);
+
+        // If there is no value for the thread yet, set it to zero.
+        if (!HasValue(history, column))
+            SetValue(&history, column, 0);
+
+        return;
+    }
+
+    // Compute the minimum value that the thread perf counter must have now.
+    auto minDiff = value - state.threadAbsolute;
+    auto minReal = state.threadReal + minDiff;
+
+    // Set the new value of the performance counter.
+    auto real = std::max(GetLastValue(history, column), minReal);
+    SetValue(&history, column, real);
+
+    // Keep track of the state.
+    state.threadAbsolute = value;
+    state.threadReal = real;
+}
+
+bool PerfCountersHistory::GetRow(
+    thread_t thread, timestamp_t ts, Row* row) const
+{
+    Cursor cursor = GetCursor(thread);
+    return GetRow(&cursor, ts, row);
+}
+
+PerfCountersHistory::Cursor PerfCountersHistory::GetCursor(
+    thread_t thread) const
+{
+    auto look = _threadSlots.find(thread);
+    if (look == _threadSlots.end())
+        return Cursor();
+    return Cursor(look->second);
+}
+
+bool PerfCountersHistory::GetRow(
+    Cursor* cursor, timestamp_t ts, Row* row) const
+{
+    if (cursor->_slot == kInvalidSlot)
+        return false;
+
+    const auto& history = _threads[cursor->_slot];
+    size_t index = base::GallopingPartitionPoint(
+        history.timestamps.size(), cursor->_row,
+        [&](size_t i) { return history.timestamps[i] > ts; });
+    if (index == 0)
+        return false;
+    --index;
+    cursor->_row = index;
+
+    row->values = history.values.data() + index * NumColumns();
+    row->mask = history.masks[index];
+    return true;
+}
+
+void PerfCountersHistory::GetRows(
+    const std::vector<Query>& queries, std::vector<Row>* rows) const
+{
+    rows->assign(queries.size(), Row());
+
+    std::vector<size_t> order;
+    base::SortQueries(
+        queries,
+        [](const Query& query) { return query.thread; },
+        [](const Query& query) { return query.ts; },
+        &order);
+
+    // Sweep the history of each thread with a single cursor.
+    size_t i = 0;
+    while (i < order.size())
+    {
+        thread_t thread = queries[order[i]].thread;
+        Cursor cursor = GetCursor(thread);
+        for (; i < order.size() && queries[order[i]].thread == thread; ++i)
+            GetRow(&cursor, queries[order[i]].ts, &(*rows)[order[i]]);
+    }
+}
+
+bool PerfCountersHistory::GetValue(
+    thread_t thread, Column column, timestamp_t ts, uint64_t* value) const
+{
+    Row row;
+    if (!GetRow(thread, ts, &row) || (row.mask & (1ull << column)) == 0)
+        return false;
+    *value = row.values[column];
+    return true;
+}
+
+PerfCountersHistory::ThreadHistory& PerfCountersHistory::GetThreadHistory(
+    ThreadSlot slot)
+{
+    auto& history = _threads[slot];
+    if (history.states.size() != NumColumns())
+        history.states.resize(NumColumns());
+    return history;
+}
+
+void PerfCountersHistory::SetValue(
+    ThreadHistory* history, Column column, uint64_t value)
+{
+    size_t numColumns = NumColumns();
+    uint64_t bit = 1ull << column;
+
+    if (!history->timestamps.empty())
+    {
+        size_t last = history->timestamps.size() - 1;
+        uint64_t* lastValues = history->values.data() + last * numColumns;
+
+        if ((history->masks[last] & bit) != 0 && lastValues[column] == value)
+            return;
+
+        // Several counters of a thread usually change at the same timestamp.
+        if (history->timestamps[last] == _ts)
+        {
+            lastValues[column] = value;
+            history->masks[last] |= bit;
+            return;
+        }
+
+        // Copy the last row.
+        history->values.resize(history->values.size() + numColumns);
+        std::copy_n(history->values.begin() + last * numColumns, numColumns,
+                    history->values.begin() + (last + 1) * numColumns);
+        history->masks.push_back(history->masks[last] | bit);
+    }
+    else
+    {
+        history->values.resize(numColumns);
+        history->masks.push_back(bit);
+    }
+
+    history->timestamps.push_back(_ts);
+    history->values[history->values.size() - numColumns + column] = value;
+}
+
+bool PerfCountersHistory::HasValue(
+    const ThreadHistory& history, Column column) const
+{
+    return !history.masks.empty() &&
+           (history.masks.back() & (1ull << column)) != 0;
+}
+
+uint64_t PerfCountersHistory::GetLastValue(
+    const ThreadHistory& history, Column column) const
+{
+    if (!HasValue(history, column))
+        return 0;
+    return history.values[history.values.size() - NumColumns() + column];
+}
+
+}  // namespace state
+}  // namespace tibee
@@ -0,0 +1,203 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_STATE_PERFCOUNTERSHISTORY_HPP_
+#define TIBEE_STATE_PERFCOUNTERSHISTORY_HPP_
+
+#include <unordered_map>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+/**
+ * History of the performance counters of each thread.
+ *
+ * Each enabled counter is a column. Every time a counter of a thread
+ * changes, a row with the current value of all the columns is added
+ * to the history of the thread, so that a single lookup returns all the
+ * counters of a thread at a given timestamp.
+ *
+ * @author Francois Doray
+ */
+class PerfCountersHistory {
+public:
+    typedef size_t Column;
+    typedef size_t ThreadSlot;
+
+    // Maximum number of columns (size of the validity mask).
+    static const size_t kMaxColumns = 64;
+
+    // Slot of a thread that has no history.
+    static const ThreadSlot kInvalidSlot = static_cast<ThreadSlot>(-1);
+
+    // Values of all the columns of a thread at a given timestamp. Bit
+    // |column| of |mask| is set if the column has a value.
+    struct Row
+    {
+        Row() : values(nullptr), mask(0) {}
+        const uint64_t* values;
+        uint64_t mask;
+    };
+
+    // Query for the row of a thread at a timestamp.
+    struct Query
+    {
+        Query() : thread(kInvalidThread), ts(0) {}
+        Query(thread_t thread, timestamp_t ts) : thread(thread), ts(ts) {}
+        thread_t thread;
+        timestamp_t ts;
+    };
+
+    // Remembers a position in the history of a thread, so that queries
+    // with increasing timestamps don't search the whole history. A cursor
+    // is invalidated by a cleanup.
+    class Cursor
+    {
+    public:
+        Cursor() : _slot(kInvalidSlot), _row(0) {}
+
+    private:
+        friend class PerfCountersHistory;
+        explicit Cursor(ThreadSlot slot) : _slot(slot), _row(0) {}
+
+        // Slot of the thread.
+        ThreadSlot _slot;
+
+        // Index of the row returned by the last query.
+        size_t _row;
+    };
+
+    PerfCountersHistory();
+    ~PerfCountersHistory();
+
+    // Set the current timestamp.
+    void SetTimestamp(timestamp_t ts) { _ts = ts; }
+
+    // Removes everything that is before the specified timestamp.
+    void Cleanup(timestamp_t ts);
+
+    // Approximate number of bytes used by the history.
+    size_t ApproximateMemoryUsage() const;
+
+    // Get the column of a counter, adding it if necessary. |counter| is
+    // an index in kPerformanceCounters.
+    Column AddCounter(size_t counter);
+
+    // Number of columns.
+    size_t NumColumns() const { return _counters.size(); }
+
+    // Counter of a column, as an index in kPerformanceCounters.
+    size_t CounterForColumn(Column column) const { return _counters[column]; }
+
+    // Get the slot of a thread, adding it if necessary. Callers that set
+    // several counters of a thread should get its slot once.
+    ThreadSlot GetThreadSlot(thread_t thread);
+
+    // Set a counter from a value read on a CPU, when the thread is
+    // scheduled in.
+    void SetCpuBaseValue(ThreadSlot slot, Column column, uint64_t value);
+
+    // Set a counter from a value read on a CPU, while the thread is running.
+    void SetCpuValue(ThreadSlot slot, Column column, uint64_t value);
+
+    // Set a counter from a value read for the thread only.
+    void SetThreadValue(ThreadSlot slot, Column column, uint64_t value);
+
+    // Get the row of a thread at the specified timestamp.
+    bool GetRow(thread_t thread, timestamp_t ts, Row* row) const;
+
+    // Get a cursor on the history of a thread.
+    Cursor GetCursor(thread_t thread) const;
+
+    // Get the row of the thread of a cursor at the specified timestamp,
+    // starting the search from the last position of the cursor.
+    bool GetRow(Cursor* cursor, timestamp_t ts, Row* row) const;
+
+    // Get the rows of a batch of queries. |rows| receives the row of each
+    // query, at the same index, with null values if there is none. Queries
+    // are grouped by thread, so that the history of each thread is
+    // traversed once.
+    void GetRows(const std::vector<Query>& queries,
+                 std::vector<Row>* rows) const;
+
+    // Get the value of a counter of a thread at the specified timestamp.
+    bool GetValue(thread_t thread, Column column, timestamp_t ts,
+                  uint64_t* value) const;
+
+private:
+    // Previous values of a counter.
+    static const uint64_t kInvalid = -1;
+    struct CounterState
+    {
+        CounterState()
+            : cpuAbsolute(kInvalid), cpuReal(kInvalid),
+              threadAbsolute(kInvalid), threadReal(kInvalid) {}
+        uint64_t cpuAbsolute;
+        uint64_t cpuReal;
+        uint64_t threadAbsolute;
+        uint64_t threadReal;
+    };
+
+    // History of a thread.
+    struct ThreadHistory
+    {
+        // Timestamp of each row.
+        std::vector<timestamp_t> timestamps;
+
+        // Values of the rows, NumColumns() per row.
+        std::vector<uint64_t> values;
+
+        // Validity mask of each row.
+        std::vector<uint64_t> masks;
+
+        // Previous values of each column.
+        std::vector<CounterState> states;
+    };
+
+    ThreadHistory& GetThreadHistory(ThreadSlot slot);
+
+    // Set the value of a column at the current timestamp.
+    void SetValue(ThreadHistory* history, Column column, uint64_t value);
+
+    // Indicates whether a column has a value.
+    bool HasValue(const ThreadHistory& history, Column column) const;
+
+    // Last value of a column, or zero.
+    uint64_t GetLastValue(const ThreadHistory& history, Column column) const;
+
+    // Current timestamp.
+    timestamp_t _ts;
+
+    // Counter of each column.
+    std::vector<size_t> _counters;
+
+    // Thread -> slot.
+    std::unordered_map<thread_t, ThreadSlot> _threadSlots;
+
+    // History of each thread slot.
+    std::vector<ThreadHistory> _threads;
+};
+
+}  // namespace state
+}  // namespace tibee
+
+#endif  // TIBEE_STATE_PERFCOUNTERSHISTORY_HPP_
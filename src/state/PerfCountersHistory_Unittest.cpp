@@ -0,0 +1,184 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include "state/PerfCountersHistory.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+TEST(PerfCountersHistory, PerfCounters)
+{
+    uint64_t val1 = 0;
+    uint64_t val2 = 0;
+    uint64_t val3 = 0;
+    uint64_t val4 = 0;
+
+    thread_t thread = 1;
+    PerfCountersHistory::ThreadSlot slot = 0;
+
+    // History 1.
+    PerfCountersHistory history1;
+    auto column = history1.AddCounter(0);
+    slot = history1.GetThreadSlot(thread);
+    history1.SetTimestamp(10);
+    history1.SetCpuBaseValue(slot, column, 1000);
+    history1.SetTimestamp(20);
+    history1.SetCpuValue(slot, column, 2000);
+    history1.SetTimestamp(30);
+    history1.SetCpuBaseValue(slot, column, 10000);
+    history1.SetTimestamp(40);
+    history1.SetCpuValue(slot, column, 11000);
+
+    EXPECT_TRUE(history1.GetValue(thread, column, 10, &val1));
+    EXPECT_TRUE(history1.GetValue(thread, column, 20, &val2));
+    EXPECT_EQ(1000u, val2 - val1);
+
+    EXPECT_TRUE(history1.GetValue(thread, column, 40, &val2));
+    EXPECT_EQ(2000u, val2 - val1);
+
+    // History 2.
+    PerfCountersHistory history2;
+    column = history2.AddCounter(0);
+    slot = history2.GetThreadSlot(thread);
+    history2.SetTimestamp(10);
+    history2.SetThreadValue(slot, column, 1000);
+    history2.SetTimestamp(20);
+    history2.SetThreadValue(slot, column, 2200);
+    history2.SetTimestamp(30);
+    history2.SetThreadValue(slot, column, 3000);
+
+    EXPECT_TRUE(history2.GetValue(thread, column, 10, &val1));
+    EXPECT_TRUE(history2.GetValue(thread, column, 20, &val2));
+    EXPECT_TRUE(history2.GetValue(thread, column, 30, &val3));
+    EXPECT_EQ(1200u, val2 - val1);
+    EXPECT_EQ(800u, val3 - val2);
+
+    // History 3.
+    PerfCountersHistory history3;
+    column = history3.AddCounter(0);
+    slot = history3.GetThreadSlot(thread);
+    history3.SetTimestamp(10);
+    history3.SetCpuBaseValue(slot, column, 1000);
+    history3.SetTimestamp(20);
+    history3.SetThreadValue(slot, column, 500);
+    history3.SetTimestamp(30);
+    history3.SetCpuValue(slot, column, 2000);
+    history3.SetTimestamp(40);
+    history3.SetThreadValue(slot, column, 3000);
+
+    EXPECT_TRUE(history3.GetValue(thread, column, 10, &val1));
+    EXPECT_TRUE(history3.GetValue(thread, column, 20, &val2));
+    EXPECT_TRUE(history3.GetValue(thread, column, 30, &val3));
+    EXPECT_TRUE(history3.GetValue(thread, column, 40, &val4));
+
+    EXPECT_EQ(0u, val2 - val1);
+    EXPECT_EQ(1000u, val3 - val2);
+    EXPECT_EQ(1500u, val4 - val3);
+}
+
+TEST(PerfCountersHistory, Rows)
+{
+    PerfCountersHistory history;
+    auto columnA = history.AddCounter(3);
+    auto columnB = history.AddCounter(7);
+    EXPECT_EQ(columnA, history.AddCounter(3));
+    EXPECT_EQ(2u, history.NumColumns());
+    EXPECT_EQ(7u, history.CounterForColumn(columnB));
+
+    auto slot = history.GetThreadSlot(1);
+    history.SetTimestamp(10);
+    history.SetThreadValue(slot, columnA, 100);
+    history.SetTimestamp(20);
+    history.SetThreadValue(slot, columnA, 150);
+    history.SetThreadValue(slot, columnB, 1000);
+    history.SetTimestamp(30);
+    history.SetThreadValue(slot, columnB, 1300);
+
+    PerfCountersHistory::Row row;
+    EXPECT_FALSE(history.GetRow(1, 5, &row));
+    EXPECT_FALSE(history.GetRow(2, 10, &row));
+
+    EXPECT_TRUE(history.GetRow(1, 15, &row));
+    EXPECT_EQ(1ull << columnA, row.mask);
+    EXPECT_EQ(0u, row.values[columnA]);
+
+    EXPECT_TRUE(history.GetRow(1, 25, &row));
+    EXPECT_EQ((1ull << columnA) | (1ull << columnB), row.mask);
+    EXPECT_EQ(50u, row.values[columnA]);
+    EXPECT_EQ(0u, row.values[columnB]);
+
+    EXPECT_TRUE(history.GetRow(1, 30, &row));
+    EXPECT_EQ(50u, row.values[columnA]);
+    EXPECT_EQ(300u, row.values[columnB]);
+
+    // Adding a column keeps the existing rows.
+    auto columnC = history.AddCounter(9);
+    uint64_t val = 0;
+    EXPECT_TRUE(history.GetValue(1, columnB, 30, &val));
+    EXPECT_EQ(300u, val);
+    EXPECT_FALSE(history.GetValue(1, columnC, 30, &val));
+
+    // Cleanup keeps the row that is valid at the cleanup timestamp.
+    history.Cleanup(25);
+    EXPECT_FALSE(history.GetRow(1, 15, &row));
+    EXPECT_TRUE(history.GetValue(1, columnA, 25, &val));
+    EXPECT_EQ(50u, val);
+    EXPECT_TRUE(history.GetValue(1, columnB, 30, &val));
+    EXPECT_EQ(300u, val);
+}
+
+TEST(PerfCountersHistory, GetRows)
+{
+    PerfCountersHistory history;
+    auto column = history.AddCounter(3);
+
+    for (thread_t thread = 1; thread <= 3; ++thread)
+    {
+        auto slot = history.GetThreadSlot(thread);
+        for (uint64_t i = 0; i < 10; ++i)
+        {
+            history.SetTimestamp(10 * i + thread);
+            history.SetThreadValue(slot, column, 100 * thread + i);
+        }
+    }
+
+    // Queries are not sorted by thread or by timestamp.
+    std::vector<PerfCountersHistory::Query> queries {
+        {3, 95}, {1, 0}, {2, 42}, {1, 33}, {4, 50}, {2, 12}, {1, 33},
+    };
+    std::vector<PerfCountersHistory::Row> rows;
+    history.GetRows(queries, &rows);
+    ASSERT_EQ(queries.size(), rows.size());
+
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        PerfCountersHistory::Row expected;
+        bool found = history.GetRow(queries[i].thread, queries[i].ts, &expected);
+        EXPECT_EQ(found, rows[i].values != nullptr);
+        EXPECT_EQ(expected.values, rows[i].values);
+        EXPECT_EQ(expected.mask, rows[i].mask);
+    }
+    EXPECT_EQ(nullptr, rows[1].values);
+    EXPECT_EQ(nullptr, rows[4].values);
+}
+
+}  // namespace state
+}  // namespace tibee
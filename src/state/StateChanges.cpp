@@ -0,0 +1,67 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "state/StateChanges.hpp"
+
+#include <assert.h>
+
+namespace tibee
+{
+namespace state
+{
+
+StateChanges::StateChanges()
+{
+}
+
+StateChanges::~StateChanges()
+{
+}
+
+StateChanges::Channel StateChanges::GetChannel(const std::string& table,
+                                               const std::string& attribute,
+                                               bool* isNew)
+{
+    auto key = std::make_pair(table, attribute);
+    auto look = _channels.find(key);
+    if (look != _channels.end())
+    {
+        *isNew = false;
+        return look->second;
+    }
+
+    Channel channel = _observers.size();
+    _channels[key] = channel;
+    _observers.push_back(std::vector<Observer>());
+    *isNew = true;
+    return channel;
+}
+
+void StateChanges::AddObserver(Channel channel, const Observer& observer)
+{
+    assert(channel < _observers.size());
+    _observers[channel].push_back(observer);
+}
+
+void StateChanges::Notify(Channel channel, const StateChange& change) const
+{
+    for (const auto& observer : _observers[channel])
+        observer(change);
+}
+
+}  // namespace state
+}  // namespace tibee
@@ -0,0 +1,102 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_STATE_STATECHANGES_HPP_
+#define TIBEE_STATE_STATECHANGES_HPP_
+
+#include <functional>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+#include "state/AttributeKey.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+// Change of an integer attribute of the current state.
+struct StateChange
+{
+    StateChange()
+        : thread(kInvalidThread), hasValue(false), value(0) {}
+
+    // Thread of a thread attribute. kInvalidThread for the other attributes,
+    // which are identified by their key.
+    thread_t thread;
+
+    // Key of the attribute.
+    AttributeKey key;
+
+    // Indicates whether the attribute has a value. The attributes of a
+    // thread are nulled when it exits.
+    bool hasValue;
+
+    // New integer or quark value of the attribute.
+    uint32_t value;
+};
+
+/**
+ * Dispatches the changes of attributes of the current state to typed
+ * observers.
+ *
+ * Each observed attribute has a channel. A change is unboxed once, whatever
+ * the number of observers of its channel, and is delivered as plain integers.
+ *
+ * @author Francois Doray
+ */
+class StateChanges
+{
+public:
+    typedef std::function<void (const StateChange&)> Observer;
+    typedef size_t Channel;
+
+    StateChanges();
+    ~StateChanges();
+
+    // Get the channel of an attribute of a table of the current state.
+    // |isNew| is set to true when the channel did not exist yet.
+    Channel GetChannel(const std::string& table,
+                       const std::string& attribute,
+                       bool* isNew);
+
+    // Add an observer to a channel.
+    void AddObserver(Channel channel, const Observer& observer);
+
+    // Dispatch a change to the observers of a channel, in the order in
+    // which they were added.
+    void Notify(Channel channel, const StateChange& change) const;
+
+    // Number of channels.
+    size_t num_channels() const { return _observers.size(); }
+
+private:
+    // (table, attribute) -> channel.
+    std::map<std::pair<std::string, std::string>, Channel> _channels;
+
+    // Observers of each channel.
+    std::vector<std::vector<Observer>> _observers;
+};
+
+}  // namespace state
+}  // namespace tibee
+
+#endif  // TIBEE_STATE_STATECHANGES_HPP_
@@ -0,0 +1,89 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "gtest/gtest.h"
+
+#include <vector>
+
+#include "state/StateChanges.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+TEST(StateChanges, GetChannel)
+{
+    StateChanges stateChanges;
+    bool isNew = false;
+
+    auto status = stateChanges.GetChannel("threads", "status", &isNew);
+    EXPECT_TRUE(isNew);
+    auto cpu = stateChanges.GetChannel("threads", "cur_cpu", &isNew);
+    EXPECT_TRUE(isNew);
+    EXPECT_NE(status, cpu);
+
+    EXPECT_EQ(status, stateChanges.GetChannel("threads", "status", &isNew));
+    EXPECT_FALSE(isNew);
+
+    auto cpuThread = stateChanges.GetChannel("cpus", "status", &isNew);
+    EXPECT_TRUE(isNew);
+    EXPECT_NE(status, cpuThread);
+    EXPECT_EQ(3u, stateChanges.num_channels());
+}
+
+TEST(StateChanges, Notify)
+{
+    StateChanges stateChanges;
+    bool isNew = false;
+    auto status = stateChanges.GetChannel("threads", "status", &isNew);
+    auto cpu = stateChanges.GetChannel("threads", "cur_cpu", &isNew);
+
+    std::vector<int> calls;
+    std::vector<StateChange> changes;
+    stateChanges.AddObserver(status, [&](const StateChange& change) {
+        calls.push_back(1);
+        changes.push_back(change);
+    });
+    stateChanges.AddObserver(status, [&](const StateChange& change) {
+        calls.push_back(2);
+    });
+    stateChanges.AddObserver(cpu, [&](const StateChange& change) {
+        calls.push_back(3);
+    });
+
+    StateChange change;
+    change.thread = 42;
+    change.key = AttributeKey(7);
+    change.hasValue = true;
+    change.value = 3;
+    stateChanges.Notify(status, change);
+
+    EXPECT_EQ(std::vector<int>({1, 2}), calls);
+    ASSERT_EQ(1u, changes.size());
+    EXPECT_EQ(42u, changes[0].thread);
+    EXPECT_EQ(AttributeKey(7), changes[0].key);
+    EXPECT_TRUE(changes[0].hasValue);
+    EXPECT_EQ(3u, changes[0].value);
+
+    calls.clear();
+    stateChanges.Notify(cpu, StateChange());
+    EXPECT_EQ(std::vector<int>({3}), calls);
+}
+
+}  // namespace state
+}  // namespace tibee
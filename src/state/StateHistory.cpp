@@ -18,9 +18,6 @@
 #include "state/StateHistory.hpp"
 
 #include <algorithm>
-#include <iostream>
-
-#include "base/CleanContainer.hpp"
 
 namespace tibee
 {
@@ -43,218 +40,59 @@ StateHistory::~StateHistory()
 
 void StateHistory::Cleanup(timestamp_t ts)
 {
-	for (auto& keyHistory : _uIntegerHistory)
-	{
-	    if (keyHistory.second.empty())
-	        continue;
-
-		EntryComparator comparator;
-		auto it = std::lower_bound(
-		    keyHistory.second.begin(), keyHistory.second.end(), ts, comparator);
-		if (it == keyHistory.second.begin())
-		    continue;
-		--it;
-		base::CleanVector(it, keyHistory.second.end(), &keyHistory.second);
-	}
-
-	for (auto& keyHistory : _uLongHistory)
-	{
-        if (keyHistory.second.empty())
-            continue;
+    _uIntegerHistory.Cleanup(ts);
+    _uLongHistory.Cleanup(ts);
+}
 
-        EntryComparator comparator;
-        auto it = std::lower_bound(
-            keyHistory.second.begin(), keyHistory.second.end(), ts, comparator);
-        if (it == keyHistory.second.begin())
-            continue;
-        --it;
-        base::CleanVector(it, keyHistory.second.end(), &keyHistory.second);
-	}
+size_t StateHistory::ApproximateMemoryUsage() const
+{
+    return _uIntegerHistory.ApproximateMemoryUsage() +
+           _uLongHistory.ApproximateMemoryUsage();
 }
 
 void StateHistory::SetUIntegerValue(AttributeKey key, uint32_t value)
 {
-    auto& keyHistory = _uIntegerHistory[key];
-    if (!keyHistory.empty() && keyHistory.back().value == value)
-        return;
-
-    UIntegerEntry entry;
-    entry.ts = _ts;
-    entry.value = value;
-    keyHistory.push_back(entry);
+    _uIntegerHistory.Append(_uIntegerHistory.GetOrCreateSlot(key), _ts, value);
 }
 
 bool StateHistory::GetUIntegerValue(AttributeKey key, timestamp_t ts, uint32_t* value) const
 {
-    auto look = _uIntegerHistory.find(key);
-    if (look == _uIntegerHistory.end())
-        return false;
-
-    const auto& keyHistory = look->second;
-
-    EntryComparator comparator;
-    auto it = std::upper_bound(
-        keyHistory.begin(), keyHistory.end(), ts, comparator);
-    if (it != keyHistory.begin())
-        --it;
-    if (it == keyHistory.end())
-        return false;
-
-    if (it->ts <= ts)
-    {
-        *value = it->value;
-        return true;
-    }
-    return false;
+    return _uIntegerHistory.GetValue(_uIntegerHistory.GetSlot(key), ts, value);
 }
 
-void StateHistory::EnumerateUIntegerValues(
-    AttributeKey key, timestamp_t start, timestamp_t end,
-    const EnumerateUIntegerValuesCallback& callback) const
+StateHistory::UIntegerCursor StateHistory::GetUIntegerCursor(AttributeKey key) const
 {
-    auto look = _uIntegerHistory.find(key);
-    if (look == _uIntegerHistory.end())
-        return;
-
-    const auto& keyHistory = look->second;
-
-    EntryComparator comparator;
-    auto it = std::upper_bound(keyHistory.begin(), keyHistory.end(), start,
-            comparator);
-    if (it != keyHistory.begin())
-        --it;
-    while (it != keyHistory.end())
-    {
-        if (it->ts >= end)
-            return;
-
-        timestamp_t intervalStart = std::max(it->ts, start);
-        timestamp_t intervalEnd = end;
-        auto next = it + 1;
-        if (next != keyHistory.end())
-            intervalEnd = std::min(next->ts, end);
-
-        callback(it->value, intervalStart, intervalEnd);
-
-        ++it;
-    }
+    return _uIntegerHistory.GetCursor(_uIntegerHistory.GetSlot(key));
 }
 
-void StateHistory::SetULongValue(AttributeKey key, uint64_t value)
+bool StateHistory::GetUIntegerValue(UIntegerCursor* cursor, timestamp_t ts, uint32_t* value) const
 {
-    auto& keyHistory = _uLongHistory[key];
-    if (!keyHistory.empty() && keyHistory.back().value == value)
-        return;
-
-    ULongEntry entry;
-    entry.ts = _ts;
-    entry.value = value;
-    keyHistory.push_back(entry);
+    return _uIntegerHistory.GetValue(cursor, ts, value);
 }
 
-bool StateHistory::GetULongValue(AttributeKey key, timestamp_t ts, uint64_t* value) const
+void StateHistory::GetUIntegerValues(const std::vector<Query>& queries, std::vector<UIntegerResult>* results) const
 {
-    auto look = _uLongHistory.find(key);
-    if (look == _uLongHistory.end())
-        return false;
-
-    const auto& keyHistory = look->second;
-
-    EntryComparator comparator;
-    auto it = std::upper_bound(
-        keyHistory.begin(), keyHistory.end(), ts, comparator);
-    if (it != keyHistory.begin())
-        --it;
-    if (it == keyHistory.end())
-        return false;
-
-    if (it->ts <= ts)
-    {
-        *value = it->value;
-        return true;
-    }
-    return false;
+    _uIntegerHistory.GetValues(queries, results);
 }
 
-void StateHistory::SetPerfCounterCpuBaseValue(AttributeKey key, uint64_t value)
+void StateHistory::SetULongValue(AttributeKey key, uint64_t value)
 {
-    auto& state = _perfCounterStates[key];
-    state.cpuAbsolute = value;
-    state.cpuReal = GetULongLastValue(key);
-
-    auto look = _uLongHistory.find(key);
-    if (look == _uLongHistory.end())
-        SetPerfCounterCpuValue(key, value);
+    _uLongHistory.Append(_uLongHistory.GetOrCreateSlot(key), _ts, value);
 }
 
-void StateHistory::SetPerfCounterCpuValue(AttributeKey key, uint64_t value)
+bool StateHistory::GetULongValue(AttributeKey key, timestamp_t ts, uint64_t* value) const
 {
-    // Make sure that this is not the first value we get for this attribute.
-    auto& state = _perfCounterStates[key];
-    if (state.cpuAbsolute == kInvalid || state.cpuAbsolute > value)
-    {
-        SetPerfCounterCpuBaseValue(key, value);
-        return;
-    }
-
-    // Compute the minimum value that the thread perf counter must have now.
-    auto minDiff = value - state.cpuAbsolute;
-    auto minReal = state.cpuReal + minDiff;
-
-    // Find the current value of the performance counter.
-    uint64_t last = GetULongLastValue(key);
-
-    // Set the new value of the performance counter.
-    auto real = std::max(last, minReal);
-    SetULongValue(key, real);
-
-    // Keep track of the state.
-    state.cpuAbsolute = value;
-    state.cpuReal = real;
+    return _uLongHistory.GetValue(_uLongHistory.GetSlot(key), ts, value);
 }
 
-void StateHistory::SetPerfCounterThreadValue(AttributeKey key, uint64_t value)
+StateHistory::ULongCursor StateHistory::GetULongCursor(AttributeKey key) const
 {
-    auto& state = _perfCounterStates[key];
-
-    if (state.threadAbsolute == kInvalid)
-    {
-        // This is the first thread value we got. Keep track of it.
-        state.threadAbsolute = value;
-        state.threadReal = GetULongLastValue(key);
-
-        // If there is no value for the thread yet, set it to zero.
-        auto look = _uLongHistory.find(key);
-        if (look == _uLongHistory.end())
-            SetULongValue(key, 0);
-
-        return;
-    }
-
-    // Compute the minimum value that the thread perf counter must have now.
-    auto minDiff = value - state.threadAbsolute;
-    auto minReal = state.threadReal + minDiff;
-
-    // Find the current value of the performance counter.
-    uint64_t last = GetULongLastValue(key);
-
-    // Set the new value of the performance counter.
-    auto real = std::max(last, minReal);
-    SetULongValue(key, real);
-
-    // Keep track of the state.
-    state.threadAbsolute = value;
-    state.threadReal = real;
+    return _uLongHistory.GetCursor(_uLongHistory.GetSlot(key));
 }
 
-uint64_t StateHistory::GetULongLastValue(AttributeKey key) const
+bool StateHistory::GetULongValue(ULongCursor* cursor, timestamp_t ts, uint64_t* value) const
 {
-    uint64_t last = 0;
-    auto look = _uLongHistory.find(key);
-    if (look != _uLongHistory.end() && !look->second.empty()) {
-        last = look->second.back().value;
-    }
-    return last;
+    return _uLongHistory.GetValue(cursor, ts, value);
 }
 
 }  // namespace state
@@ -24,6 +24,7 @@
 
 #include "base/BasicTypes.hpp"
 #include "state/AttributeKey.hpp"
+#include "state/ChunkedHistory.hpp"
 
 namespace tibee
 {
@@ -31,10 +32,22 @@ namespace state
 {
 
 class StateHistory {
+private:
+    typedef ChunkedHistory<uint32_t> UIntegerHistory;
+    typedef ChunkedHistory<uint64_t> ULongHistory;
+
 public:
     typedef std::function<void (
         uint32_t value, timestamp_t start, timestamp_t end)> EnumerateUIntegerValuesCallback;
 
+    // Batched queries and their results.
+    typedef HistoryQuery Query;
+    typedef UIntegerHistory::Result UIntegerResult;
+
+    // Cursors for sequential queries on the history of an entry.
+    typedef UIntegerHistory::Cursor UIntegerCursor;
+    typedef ULongHistory::Cursor ULongCursor;
+
     StateHistory();
     ~StateHistory();
 
@@ -44,77 +57,42 @@ public:
     // Removes everything that is before the specified timestamp.
     void Cleanup(timestamp_t ts);
 
+    // Approximate number of bytes used by the history.
+    size_t ApproximateMemoryUsage() const;
+
     // Set/get the current value for an unsigned integer entry.
     void SetUIntegerValue(AttributeKey key, uint32_t value);
     bool GetUIntegerValue(AttributeKey key, timestamp_t ts, uint32_t* value) const;
+    UIntegerCursor GetUIntegerCursor(AttributeKey key) const;
+    bool GetUIntegerValue(UIntegerCursor* cursor, timestamp_t ts, uint32_t* value) const;
+    void GetUIntegerValues(const std::vector<Query>& queries, std::vector<UIntegerResult>* results) const;
 
-    // Enumerate the values of a state in the specified interval.
+    // Enumerate the values of a state in the specified interval. The
+    // visitor receives (uint32_t value, timestamp_t start, timestamp_t end).
+    template <typename Visitor>
     void EnumerateUIntegerValues(
         AttributeKey key, timestamp_t start, timestamp_t end,
-        const EnumerateUIntegerValuesCallback& callback) const;
+        Visitor&& visitor) const
+    {
+        _uIntegerHistory.EnumerateValues(
+            _uIntegerHistory.GetSlot(key), start, end, visitor);
+    }
 
     // Set/get the current value for an unsigned integer entry.
     void SetULongValue(AttributeKey key, uint64_t value);
     bool GetULongValue(AttributeKey key, timestamp_t ts, uint64_t* value) const;
-
-    // Helpers for performance counters.
-    void SetPerfCounterCpuBaseValue(AttributeKey key, uint64_t value);
-    void SetPerfCounterCpuValue(AttributeKey key, uint64_t value);
-    void SetPerfCounterThreadValue(AttributeKey key, uint64_t value);
+    ULongCursor GetULongCursor(AttributeKey key) const;
+    bool GetULongValue(ULongCursor* cursor, timestamp_t ts, uint64_t* value) const;
 
 private:
-    uint64_t GetULongLastValue(AttributeKey key) const;
-
     // Current timestamp.
     timestamp_t _ts;
 
-    // Entry.
-    struct Entry
-    {
-        Entry() : ts(0) {}
-        timestamp_t ts;
-    };
-    class EntryComparator {
-    public:
-        bool operator()(const Entry& stack, timestamp_t ts) const {
-            return stack.ts < ts;
-        }
-        bool operator()(timestamp_t ts, const Entry& stack) const {
-            return ts < stack.ts;
-        }
-    };
-
     // History of unsigned integer values.
-    struct UIntegerEntry : Entry
-    {
-        UIntegerEntry() : value(0) {}
-        uint32_t value;
-    };
-    typedef std::unordered_map<AttributeKey, std::vector<UIntegerEntry>> UIntegerHistory;
     UIntegerHistory _uIntegerHistory;
 
     // History of long unsigned values.
-    struct ULongEntry : Entry {
-        ULongEntry() : value(0) {}
-        uint64_t value;
-    };
-    typedef std::unordered_map<AttributeKey, std::vector<ULongEntry>> ULongHistory;
     ULongHistory _uLongHistory;
-
-    // Previous values for performance counters.
-    static const uint64_t kInvalid = -1;
-    struct PerfCounterState
-    {
-        PerfCounterState()
-            : cpuAbsolute(kInvalid), cpuReal(kInvalid),
-              threadAbsolute(kInvalid), threadReal(kInvalid) {}
-        uint64_t cpuAbsolute;
-        uint64_t cpuReal;
-        uint64_t threadAbsolute;
-        uint64_t threadReal;
-    };
-    typedef std::unordered_map<AttributeKey, PerfCounterState> PerfCounterStates;
-    PerfCounterStates _perfCounterStates;
 };
 
 }  // namespace state
@@ -17,6 +17,8 @@
  */
 #include "gtest/gtest.h"
 
+#include <chrono>
+#include <iostream>
 #include <vector>
 
 #include "state/StateHistory.hpp"
@@ -50,6 +52,11 @@ void Callback(uint32_t value, timestamp_t start, timestamp_t end, std::vector<V>
     vec->push_back(V(value, start, end));
 }
 
+void SumCallback(uint32_t value, timestamp_t start, timestamp_t end, uint64_t* total)
+{
+    *total += value * (end - start);
+}
+
 }  // namespace
 
 TEST(StateHistory, StateHistory)
@@ -186,67 +193,193 @@ TEST(StateHistory, Clean)
 	EXPECT_EQ(5u, val);
 }
 
-TEST(StateHistory, PerfCounters)
+TEST(StateHistory, LongGaps)
+{
+    namespace pl = std::placeholders;
+
+    // Gaps longer than 2^32 ns split the history in multiple chunks.
+    const timestamp_t kGap = 5000000000ull;
+
+    StateHistory history;
+
+    history.SetTimestamp(10);
+    history.SetUIntegerValue(AttributeKey(1), 1);
+    history.SetTimestamp(20);
+    history.SetUIntegerValue(AttributeKey(1), 2);
+    history.SetTimestamp(kGap);
+    history.SetUIntegerValue(AttributeKey(1), 3);
+    history.SetTimestamp(kGap + 10);
+    history.SetUIntegerValue(AttributeKey(1), 4);
+    history.SetTimestamp(3 * kGap);
+    history.SetUIntegerValue(AttributeKey(1), 5);
+
+    uint32_t val = 0;
+    EXPECT_FALSE(history.GetUIntegerValue(1, 5, &val));
+    EXPECT_TRUE(history.GetUIntegerValue(1, 15, &val));
+    EXPECT_EQ(1u, val);
+    EXPECT_TRUE(history.GetUIntegerValue(1, kGap - 1, &val));
+    EXPECT_EQ(2u, val);
+    EXPECT_TRUE(history.GetUIntegerValue(1, kGap, &val));
+    EXPECT_EQ(3u, val);
+    EXPECT_TRUE(history.GetUIntegerValue(1, 2 * kGap, &val));
+    EXPECT_EQ(4u, val);
+    EXPECT_TRUE(history.GetUIntegerValue(1, 4 * kGap, &val));
+    EXPECT_EQ(5u, val);
+
+    std::vector<V> vec;
+    history.EnumerateUIntegerValues(1, 15, 4 * kGap, std::bind(&Callback, pl::_1, pl::_2, pl::_3, &vec));
+    std::vector<V> expectedVec({
+        {1, 15, 20}, {2, 20, kGap}, {3, kGap, kGap + 10},
+        {4, kGap + 10, 3 * kGap}, {5, 3 * kGap, 4 * kGap}});
+    EXPECT_EQ(expectedVec, vec);
+
+    // Keep the value that is valid at the cleanup timestamp.
+    history.Cleanup(kGap + 5);
+    EXPECT_FALSE(history.GetUIntegerValue(1, kGap - 1, &val));
+    EXPECT_TRUE(history.GetUIntegerValue(1, kGap + 5, &val));
+    EXPECT_EQ(3u, val);
+
+    vec.clear();
+    history.EnumerateUIntegerValues(1, 0, 2 * kGap, std::bind(&Callback, pl::_1, pl::_2, pl::_3, &vec));
+    expectedVec = {{3, kGap, kGap + 10}, {4, kGap + 10, 2 * kGap}};
+    EXPECT_EQ(expectedVec, vec);
+
+    history.Cleanup(4 * kGap);
+    EXPECT_FALSE(history.GetUIntegerValue(1, 2 * kGap, &val));
+    EXPECT_TRUE(history.GetUIntegerValue(1, 4 * kGap, &val));
+    EXPECT_EQ(5u, val);
+}
+
+TEST(StateHistory, Cursor)
 {
-    uint64_t val1 = 0;
-    uint64_t val2 = 0;
-    uint64_t val3 = 0;
-    uint64_t val4 = 0;
-
-    AttributeKey key1(1);
-
-    // History 1.
-    StateHistory history1;
-    history1.SetTimestamp(10);
-    history1.SetPerfCounterCpuBaseValue(key1, 1000);
-    history1.SetTimestamp(20);
-    history1.SetPerfCounterCpuValue(key1, 2000);
-    history1.SetTimestamp(30);
-    history1.SetPerfCounterCpuBaseValue(key1, 10000);
-    history1.SetTimestamp(40);
-    history1.SetPerfCounterCpuValue(key1, 11000);
-
-    EXPECT_TRUE(history1.GetULongValue(key1, 10, &val1));
-    EXPECT_TRUE(history1.GetULongValue(key1, 20, &val2));
-    EXPECT_EQ(1000u, val2 - val1);
-
-    EXPECT_TRUE(history1.GetULongValue(key1, 40, &val2));
-    EXPECT_EQ(2000u, val2 - val1);
-
-    // History 2.
-    StateHistory history2;
-    history2.SetTimestamp(10);
-    history2.SetPerfCounterThreadValue(key1, 1000);
-    history2.SetTimestamp(20);
-    history2.SetPerfCounterThreadValue(key1, 2200);
-    history2.SetTimestamp(30);
-    history2.SetPerfCounterThreadValue(key1, 3000);
-
-    EXPECT_TRUE(history2.GetULongValue(key1, 10, &val1));
-    EXPECT_TRUE(history2.GetULongValue(key1, 20, &val2));
-    EXPECT_TRUE(history2.GetULongValue(key1, 30, &val3));
-    EXPECT_EQ(1200u, val2 - val1);
-    EXPECT_EQ(800u, val3 - val2);
-
-    // History 3.
-    StateHistory history3;
-    history3.SetTimestamp(10);
-    history3.SetPerfCounterCpuBaseValue(key1, 1000);
-    history3.SetTimestamp(20);
-    history3.SetPerfCounterThreadValue(key1, 500);
-    history3.SetTimestamp(30);
-    history3.SetPerfCounterCpuValue(key1, 2000);
-    history3.SetTimestamp(40);
-    history3.SetPerfCounterThreadValue(key1, 3000);
-
-    EXPECT_TRUE(history3.GetULongValue(key1, 10, &val1));
-    EXPECT_TRUE(history3.GetULongValue(key1, 20, &val2));
-    EXPECT_TRUE(history3.GetULongValue(key1, 30, &val3));
-    EXPECT_TRUE(history3.GetULongValue(key1, 40, &val4));
-
-    EXPECT_EQ(0u, val2 - val1);
-    EXPECT_EQ(1000u, val3 - val2);
-    EXPECT_EQ(1500u, val4 - val3);
+    const timestamp_t kGap = 5000000000ull;
+
+    StateHistory history;
+
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        history.SetTimestamp(10 * i + (i >= 50 ? kGap : 0));
+        history.SetUIntegerValue(AttributeKey(1), i);
+        history.SetULongValue(AttributeKey(2), i + kGap);
+    }
+
+    // Queries with a cursor return the same values as independent
+    // queries, in any order.
+    std::vector<timestamp_t> timestamps;
+    for (timestamp_t ts = 0; ts < 1000; ts += 3)
+        timestamps.push_back(ts);
+    for (timestamp_t ts = kGap + 1000; ts > kGap; ts -= 7)
+        timestamps.push_back(ts);
+    timestamps.push_back(5);
+    timestamps.push_back(kGap + 995);
+
+    auto uIntegerCursor = history.GetUIntegerCursor(AttributeKey(1));
+    auto uLongCursor = history.GetULongCursor(AttributeKey(2));
+    for (timestamp_t ts : timestamps)
+    {
+        uint32_t expected = 0;
+        uint32_t actual = 0;
+        EXPECT_EQ(history.GetUIntegerValue(1, ts, &expected),
+                  history.GetUIntegerValue(&uIntegerCursor, ts, &actual));
+        EXPECT_EQ(expected, actual);
+
+        uint64_t expectedLong = 0;
+        uint64_t actualLong = 0;
+        EXPECT_EQ(history.GetULongValue(2, ts, &expectedLong),
+                  history.GetULongValue(&uLongCursor, ts, &actualLong));
+        EXPECT_EQ(expectedLong, actualLong);
+    }
+
+    uint32_t val = 0;
+    auto missingCursor = history.GetUIntegerCursor(AttributeKey(3));
+    EXPECT_FALSE(history.GetUIntegerValue(&missingCursor, 10, &val));
+}
+
+TEST(StateHistory, GetValues)
+{
+    StateHistory history;
+
+    for (uint32_t i = 0; i < 20; ++i)
+    {
+        history.SetTimestamp(10 * i);
+        history.SetUIntegerValue(AttributeKey(i % 3), i);
+    }
+
+    // Queries are not sorted by key or by timestamp.
+    std::vector<StateHistory::Query> queries {
+        {AttributeKey(2), 150}, {AttributeKey(0), 5}, {AttributeKey(1), 42},
+        {AttributeKey(0), 0}, {AttributeKey(5), 50}, {AttributeKey(2), 15},
+        {AttributeKey(0), 185},
+    };
+
+    std::vector<StateHistory::UIntegerResult> results;
+    history.GetUIntegerValues(queries, &results);
+    ASSERT_EQ(queries.size(), results.size());
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        uint32_t expected = 0;
+        EXPECT_EQ(history.GetUIntegerValue(queries[i].key, queries[i].ts, &expected),
+                  results[i].found);
+        if (results[i].found)
+        {
+            EXPECT_EQ(expected, results[i].value);
+        }
+    }
+    EXPECT_FALSE(results[4].found);
+    EXPECT_EQ(18u, results[6].value);
+}
+
+// Compares the cost of enumerating the values of a state for each segment
+// of a critical path with a std::function built by std::bind, as callers
+// used to do, and with a lambda visitor.
+TEST(StateHistory, DISABLED_EnumerateBenchmark)
+{
+    namespace pl = std::placeholders;
+    typedef std::chrono::steady_clock Clock;
+
+    const uint32_t kNumValues = 1000000;
+    const timestamp_t kSegmentDuration = 50;
+
+    StateHistory history;
+    for (uint32_t i = 0; i < kNumValues; ++i)
+    {
+        history.SetTimestamp(10 * i);
+        history.SetUIntegerValue(AttributeKey(1), i);
+    }
+
+    uint64_t functionTotal = 0;
+    auto start = Clock::now();
+    for (timestamp_t ts = 0; ts < 10 * kNumValues; ts += kSegmentDuration)
+    {
+        StateHistory::EnumerateUIntegerValuesCallback callback = std::bind(
+            &SumCallback, pl::_1, pl::_2, pl::_3, &functionTotal);
+        history.EnumerateUIntegerValues(1, ts, ts + kSegmentDuration, callback);
+    }
+    auto functionDuration = Clock::now() - start;
+
+    uint64_t visitorTotal = 0;
+    start = Clock::now();
+    for (timestamp_t ts = 0; ts < 10 * kNumValues; ts += kSegmentDuration)
+    {
+        history.EnumerateUIntegerValues(
+            1, ts, ts + kSegmentDuration,
+            [&](uint32_t value, timestamp_t start, timestamp_t end) {
+                SumCallback(value, start, end, &visitorTotal);
+            });
+    }
+    auto visitorDuration = Clock::now() - start;
+
+    auto numSegments = 10 * kNumValues / kSegmentDuration;
+    std::cout << "std::function: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     functionDuration).count() / numSegments
+              << " ns/segment" << std::endl;
+    std::cout << "visitor: "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     visitorDuration).count() / numSegments
+              << " ns/segment" << std::endl;
+
+    EXPECT_EQ(functionTotal, visitorTotal);
 }
 
 }  // namespace stacks
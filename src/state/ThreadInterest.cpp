@@ -0,0 +1,55 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "state/ThreadInterest.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+ThreadInterest::ThreadInterest()
+    : _selective(false)
+{
+}
+
+ThreadInterest::~ThreadInterest()
+{
+}
+
+bool ThreadInterest::IsInteresting(thread_t thread) const
+{
+    if (!_selective)
+        return true;
+    return Contains(thread);
+}
+
+bool ThreadInterest::Contains(thread_t thread) const
+{
+    return _threadSet.find(thread) != _threadSet.end();
+}
+
+bool ThreadInterest::AddThread(thread_t thread)
+{
+    if (!_threadSet.insert(thread).second)
+        return false;
+    _threads.push_back(thread);
+    return true;
+}
+
+}  // namespace state
+}  // namespace tibee
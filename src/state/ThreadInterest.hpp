@@ -0,0 +1,77 @@
+/* Copyright (c) 2015 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tibeecompare.
+ *
+ * tibeecompare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tibeecompare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tibeecompare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIBEE_STATE_THREADINTEREST_HPP_
+#define TIBEE_STATE_THREADINTEREST_HPP_
+
+#include <unordered_set>
+#include <vector>
+
+#include "base/BasicTypes.hpp"
+
+namespace tibee
+{
+namespace state
+{
+
+/**
+ * Set of threads that analyses may query.
+ *
+ * When the set is not selective, all threads are interesting. Otherwise,
+ * only the threads that were added explicitly are interesting: the threads
+ * that run analyzed executions and the threads that wake them up.
+ *
+ * @author Francois Doray
+ */
+class ThreadInterest {
+public:
+    ThreadInterest();
+    ~ThreadInterest();
+
+    // Restrict the interest to the threads that are added explicitly.
+    void SetSelective(bool selective) { _selective = selective; }
+    bool selective() const { return _selective; }
+
+    // Indicates whether a thread is interesting.
+    bool IsInteresting(thread_t thread) const;
+
+    // Indicates whether a thread was added explicitly, even when the set
+    // is not selective.
+    bool Contains(thread_t thread) const;
+
+    // Add an interesting thread. Returns true if the thread was not
+    // already in the set.
+    bool AddThread(thread_t thread);
+
+    // Threads added to the set, in the order in which they were added.
+    const std::vector<thread_t>& threads() const { return _threads; }
+
+private:
+    // Indicates whether only the added threads are interesting.
+    bool _selective;
+
+    // Threads added to the set.
+    std::unordered_set<thread_t> _threadSet;
+
+    // Threads added to the set, in order.
+    std::vector<thread_t> _threads;
+};
+
+}  // namespace state
+}  // namespace tibee
+
+#endif  // TIBEE_STATE_THREADINTEREST_HPP_
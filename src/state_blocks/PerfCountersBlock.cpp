@@ -17,9 +17,10 @@
  */
 #include "state_blocks/PerfCountersBlock.hpp"
 
+#include <algorithm>
+
 #include "base/BindObject.hpp"
 #include "base/CompareConstants.hpp"
-#include "base/Constants.hpp"
 #include "notification/NotificationCenter.hpp"
 #include "notification/Token.hpp"
 
@@ -42,10 +43,22 @@ std::string GetPerfFieldName(const std::string& type, const std::string& str)
     return std::string("perf_") + type + "_" + cleaned;
 }
 
+bool LayoutMatches(const std::vector<std::string>& fieldNames,
+                   const value::Value* context)
+{
+    if (context->Length() != fieldNames.size())
+        return false;
+    for (size_t index = 0; index < fieldNames.size(); ++index)
+    {
+        if (context->GetFieldName(index) != fieldNames[index])
+            return false;
+    }
+    return true;
+}
+
 }  // namespace
 
 PerfCountersBlock::PerfCountersBlock()
-    : _ustInitialized(false), _kernelInitialized(false)
 {
 }
 
@@ -53,17 +66,6 @@ PerfCountersBlock::~PerfCountersBlock()
 {
 }
 
-void PerfCountersBlock::LoadServices(const block::ServiceList& serviceList)
-{
-    using notification::Token;
-
-    AbstractBuildBlock::LoadServices(serviceList);
-
-    // Get path for thread states.
-    state::AttributePathStr threadStatePath {kStateLinux, kStateThreads};
-    _threadStateKey = State()->GetAttributeKeyStr(threadStatePath);
-}
-
 void PerfCountersBlock::AddObservers(notification::NotificationCenter* notificationCenter)
 {
     using notification::AnyToken;
@@ -80,102 +82,112 @@ void PerfCountersBlock::AddObservers(notification::NotificationCenter* notificat
                    base::BindObject(&PerfCountersBlock::OnUstEvent, this));
 }
 
-void PerfCountersBlock::InitializeKernel(const trace::EventValue& event)
+const PerfCountersBlock::ContextLayout& PerfCountersBlock::GetContextLayout(
+    const trace::EventValue& event,
+    const value::Value* context,
+    const std::string& type,
+    ContextLayouts* layouts)
 {
-    if (_kernelInitialized)
-        return;
+    // Consecutive events usually belong to the same event class.
+    EventClassKey key(EventNamePointer(event), context->Length());
+    if (key == layouts->lastKey)
+        return layouts->layouts[layouts->last];
 
-    for (size_t i = 0; i < kNumPerformanceCounters; ++i) {
-        PerfCounter counter;
-        counter.name = GetPerfFieldName("cpu", kPerformanceCounters[i]);
-        auto* value = event.getStreamEventContext()->GetField(counter.name);
-        if (value != nullptr) {
-            counter.quark = Quarks()->StrQuark(kPerformanceCounters[i]);
-            _kernelCounters.push_back(counter);
-        }
+    auto look = layouts->eventClasses.find(key);
+    if (look == layouts->eventClasses.end())
+    {
+        look = layouts->eventClasses.insert(std::make_pair(
+            key, AddContextLayout(context, type, layouts))).first;
     }
 
-    _kernelInitialized = true;
+    layouts->lastKey = key;
+    layouts->last = look->second;
+    return layouts->layouts[layouts->last];
 }
 
-void PerfCountersBlock::InitializeUst(const trace::EventValue& event)
+size_t PerfCountersBlock::AddContextLayout(const value::Value* context,
+                                           const std::string& type,
+                                           ContextLayouts* layouts)
 {
-    if (_ustInitialized)
-        return;
+    // Stream classes of a trace rarely have more than a few distinct
+    // contexts: event classes of the same stream class share a layout.
+    auto& known = layouts->layouts;
+    for (size_t i = 0; i < known.size(); ++i)
+    {
+        if (LayoutMatches(known[i].fieldNames, context))
+            return i;
+    }
 
-    for (size_t i = 0; i < kNumPerformanceCounters; ++i) {
-        PerfCounter counter;
-        counter.name = GetPerfFieldName("thread", kPerformanceCounters[i]);
-        auto* value = event.getStreamEventContext()->GetField(counter.name);
+    ContextLayout layout;
+    size_t numFields = context->Length();
+    for (size_t index = 0; index < numFields; ++index)
+        layout.fieldNames.push_back(context->GetFieldName(index));
 
-        if (value != nullptr) {
-            counter.quark = Quarks()->StrQuark(kPerformanceCounters[i]);
-            _ustCounters.push_back(counter);
-        }
+    for (size_t i = 0; i < kNumPerformanceCounters; ++i)
+    {
+        std::string name = GetPerfFieldName(type, kPerformanceCounters[i]);
+        auto look = std::find(
+            layout.fieldNames.begin(), layout.fieldNames.end(), name);
+        if (look == layout.fieldNames.end())
+            continue;
+        layout.counters.push_back(CounterField(
+            look - layout.fieldNames.begin(),
+            PerfCountersHistory()->AddCounter(i)));
     }
 
-    _ustInitialized = true;
+    known.push_back(layout);
+    return known.size() - 1;
 }
 
 void PerfCountersBlock::OnSchedSwitchEvent(const trace::EventValue& event)
 {
-    InitializeKernel(event);
+    const auto* context = event.getStreamEventContext();
+    const auto& layout = GetContextLayout(event, context, "cpu", &_kernelLayouts);
+    if (layout.counters.empty())
+        return;
 
     auto prevTid = event.getFields()->GetField("prev_tid")->AsInteger();
     auto nextTid = event.getFields()->GetField("next_tid")->AsInteger();
+    auto prevSlot = PerfCountersHistory()->GetThreadSlot(prevTid);
+    auto nextSlot = PerfCountersHistory()->GetThreadSlot(nextTid);
 
-    for (const auto& counter : _kernelCounters)
+    for (const auto& counter : layout.counters)
     {
-        auto* value = event.getStreamEventContext()->GetField(counter.name);
-        if (value == nullptr)
-            continue;
-        uint64_t uLongValue = value->AsULong();
-
-        auto prevCounterKey = State()->GetAttributeKey(
-            _threadStateKey, {Quarks()->IntQuark(prevTid), counter.quark});
-        StateHistory()->SetPerfCounterCpuValue(prevCounterKey, uLongValue);
-
-        auto nextCounterKey = State()->GetAttributeKey(
-            _threadStateKey, {Quarks()->IntQuark(nextTid), counter.quark});
-        StateHistory()->SetPerfCounterCpuBaseValue(nextCounterKey, uLongValue);
+        uint64_t value = context->GetField(counter.index)->AsULong();
+        PerfCountersHistory()->SetCpuValue(prevSlot, counter.column, value);
+        PerfCountersHistory()->SetCpuBaseValue(nextSlot, counter.column, value);
     }
 }
 
 void PerfCountersBlock::OnTTWUEvent(const trace::EventValue& event)
 {
-    InitializeKernel(event);
+    const auto* context = event.getStreamEventContext();
+    const auto& layout = GetContextLayout(event, context, "cpu", &_kernelLayouts);
+    if (layout.counters.empty())
+        return;
 
-    auto thread = ThreadForEvent(event);
+    auto slot = PerfCountersHistory()->GetThreadSlot(ThreadForEvent(event));
 
-    for (const auto& counter : _kernelCounters)
+    for (const auto& counter : layout.counters)
     {
-        auto* value = event.getStreamEventContext()->GetField(counter.name);
-        if (value == nullptr)
-            continue;
-        uint64_t uLongValue = value->AsULong();
-
-        auto counterKey = State()->GetAttributeKey(
-            _threadStateKey, {Quarks()->IntQuark(thread), counter.quark});
-        StateHistory()->SetPerfCounterCpuValue(counterKey, uLongValue);
+        uint64_t value = context->GetField(counter.index)->AsULong();
+        PerfCountersHistory()->SetCpuValue(slot, counter.column, value);
     }
 }
 
 void PerfCountersBlock::OnUstEvent(const trace::EventValue& event)
 {
-    InitializeUst(event);
+    const auto* context = event.getStreamEventContext();
+    const auto& layout = GetContextLayout(event, context, "thread", &_ustLayouts);
+    if (layout.counters.empty())
+        return;
 
-    auto thread = ThreadForEvent(event);
+    auto slot = PerfCountersHistory()->GetThreadSlot(ThreadForEvent(event));
 
-    for (const auto& counter : _ustCounters)
+    for (const auto& counter : layout.counters)
     {
-        auto* value = event.getStreamEventContext()->GetField(counter.name);
-        if (value == nullptr)
-            continue;
-        uint64_t uLongValue = value->AsULong();
-
-        auto counterKey = State()->GetAttributeKey(_threadStateKey,
-                { Quarks()->IntQuark(thread), counter.quark });
-        StateHistory()->SetPerfCounterThreadValue(counterKey, uLongValue);
+        uint64_t value = context->GetField(counter.index)->AsULong();
+        PerfCountersHistory()->SetThreadValue(slot, counter.column, value);
     }
 }
 
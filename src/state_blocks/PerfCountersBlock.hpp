@@ -19,11 +19,13 @@
 #define TIBEE_SRC_STATE_BLOCKS_PERFCOUNTERBLOCK_HPP_
 
 #include <string>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "build_blocks/AbstractBuildBlock.hpp"
-#include "quark/Quark.hpp"
-#include "state/AttributeKey.hpp"
+#include "state/PerfCountersHistory.hpp"
+#include "value/Value.hpp"
 
 namespace tibee {
 namespace state_blocks {
@@ -39,37 +41,75 @@ public:
     PerfCountersBlock();
     ~PerfCountersBlock();
 
-    virtual void LoadServices(const block::ServiceList& serviceList) override;
     virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
 
 private:
-    void InitializeKernel(const trace::EventValue& event);
-    void InitializeUst(const trace::EventValue& event);
+    // Position of a counter in a stream event context.
+    struct CounterField
+    {
+        CounterField() : index(0), column(0) {}
+        CounterField(size_t index, state::PerfCountersHistory::Column column)
+            : index(index), column(column) {}
+        size_t index;
+        state::PerfCountersHistory::Column column;
+    };
 
-    void OnSchedSwitchEvent(const trace::EventValue& event);
-    void OnTTWUEvent(const trace::EventValue& event);
-    void OnUstEvent(const trace::EventValue& event);
+    // Counter fields of a stream event context layout. Layouts are told
+    // apart by the names of all their fields: stream classes with the same
+    // number of fields can have different counters.
+    struct ContextLayout
+    {
+        std::vector<std::string> fieldNames;
+        std::vector<CounterField> counters;
+    };
 
-    struct PerfCounter
+    // Identifies the context layout of an event class: its name, which the
+    // trace reader interns, and the number of fields of its context. An
+    // event class belongs to a single stream class, so its name identifies
+    // its layout within a trace. The number of fields tells apart the
+    // events with the same name in traces that have different contexts.
+    typedef std::pair<const char*, size_t> EventClassKey;
+
+    struct EventClassKeyHash
+    {
+        size_t operator()(const EventClassKey& key) const
+        {
+            return std::hash<const char*>()(key.first) ^ key.second;
+        }
+    };
+
+    // Known layouts, the layout of each event class, and the event class
+    // seen last.
+    struct ContextLayouts
     {
-        std::string name;
-        quark::Quark quark;
+        ContextLayouts() : lastKey(nullptr, 0), last(0) {}
+        std::vector<ContextLayout> layouts;
+        std::unordered_map<EventClassKey, size_t, EventClassKeyHash> eventClasses;
+        EventClassKey lastKey;
+        size_t last;
     };
 
-    // Path for thread states.
-    state::AttributeKey _threadStateKey;
+    // Get the counter fields of the stream event context of an event. They
+    // are resolved by name the first time an event class is seen.
+    const ContextLayout& GetContextLayout(const trace::EventValue& event,
+                                          const value::Value* context,
+                                          const std::string& type,
+                                          ContextLayouts* layouts);
 
-    // Indicates whether ust perf counters have been initialized.
-    bool _ustInitialized;
+    // Find or add the layout with the fields of |context|.
+    size_t AddContextLayout(const value::Value* context,
+                            const std::string& type,
+                            ContextLayouts* layouts);
 
-    // Enabled ust perf counters.
-    std::vector<PerfCounter> _ustCounters;
+    void OnSchedSwitchEvent(const trace::EventValue& event);
+    void OnTTWUEvent(const trace::EventValue& event);
+    void OnUstEvent(const trace::EventValue& event);
 
-    // Indicates whether kernel perf counters have been initialized.
-    bool _kernelInitialized;
+    // Known layouts of kernel stream event contexts.
+    ContextLayouts _kernelLayouts;
 
-    // Enabled ust perf counters.
-    std::vector<PerfCounter> _kernelCounters;
+    // Known layouts of ust stream event contexts.
+    ContextLayouts _ustLayouts;
 };
 
 }  // namespace state_blocks
@@ -20,13 +20,20 @@
 #include "base/BindObject.hpp"
 #include "base/Constants.hpp"
 #include "notification/NotificationCenter.hpp"
+#include "notification/Token.hpp"
 
 namespace tibee
 {
 namespace state_blocks
 {
 
+namespace
+{
+const uint32_t kInvalidValue = -1;
+}  // namespace
+
 StateHistoryBlock::StateHistoryBlock()
+    : _numInterestingThreads(0)
 {
 }
 
@@ -34,38 +41,152 @@ StateHistoryBlock::~StateHistoryBlock()
 {
 }
 
+void StateHistoryBlock::LoadServices(const block::ServiceList& serviceList)
+{
+    AbstractBuildBlock::LoadServices(serviceList);
+
+    state::AttributePathStr threadsPath {kStateLinux, kStateThreads};
+    _threadsPathKey = State()->GetAttributeKeyStr(threadsPath);
+    _currentCpuQuark = State()->Quark(kStateCurCpu);
+
+    state::AttributePathStr cpusPath {kStateLinux, kStateCpus};
+    _cpusPathKey = State()->GetAttributeKeyStr(cpusPath);
+    _currentThreadQuark = State()->Quark(kStateCurThread);
+}
+
 void StateHistoryBlock::AddObservers(notification::NotificationCenter* notificationCenter)
 {
-    using notification::AnyToken;
     using notification::Token;
 
-    // Notification for the CPU property of a thread.
-    notification::Path threadCpuPath {
-        Token(kCurrentStateNotificationPrefix),
-        Token(kStateLinux),
-        Token(kStateThreads),
-        AnyToken(),
-        Token(kStateCurCpu)};
-    notificationCenter->AddObserver(threadCpuPath, base::BindObject(&StateHistoryBlock::OnState, this));
-
-    // Notification for the thread property of a CPU.
-    notification::Path cpuThreadPath {
-        Token(kCurrentStateNotificationPrefix),
-        Token(kStateLinux),
-        Token(kStateCpus),
-        AnyToken(),
-        Token(kStateCurThread)};
-    notificationCenter->AddObserver(cpuThreadPath, base::BindObject(&StateHistoryBlock::OnState, this));
+    // Changes of the CPU property of a thread.
+    AddThreadStateChangeObserver(notificationCenter,
+                                 kStateCurCpu,
+                                 base::BindObject(&StateHistoryBlock::OnState, this));
+
+    // Changes of the thread property of a CPU.
+    AddCpuStateChangeObserver(notificationCenter,
+                              kStateCurThread,
+                              base::BindObject(&StateHistoryBlock::OnState, this));
+
+    // Wake ups widen the set of interesting threads.
+    AddKernelObserver(notificationCenter,
+                      Token("sched_ttwu"),
+                      base::BindObject(&StateHistoryBlock::OnTTWU, this));
 }
 
-void StateHistoryBlock::OnState(const notification::Path& path, const value::Value* value)
+void StateHistoryBlock::OnState(const state::StateChange& change)
 {
-    auto valuePtr = value->GetField(kCurrentStateAttributeValueField);
-    uint32_t valueUInt = -1;
-    if (valuePtr != nullptr)
-        valueUInt = valuePtr->AsUInteger();
-    auto key = value->GetField(kCurrentStateAttributeKeyField)->AsUInteger();
-    StateHistory()->SetUIntegerValue(state::AttributeKey(key), valueUInt);
+    uint32_t valueUInt = change.hasValue ? change.value : kInvalidValue;
+    state::AttributeKey key = change.key;
+
+    if (!ThreadInterest()->selective())
+    {
+        StateHistory()->SetUIntegerValue(key, valueUInt);
+        return;
+    }
+
+    UpdateInterestingThreads();
+    _lastValues[key] = valueUInt;
+
+    // CPU of an interesting thread.
+    auto threadLook = _threadCpus.find(key);
+    if (threadLook != _threadCpus.end())
+    {
+        if (threadLook->second != valueUInt)
+        {
+            ReleaseCpu(threadLook->second);
+            AcquireCpu(valueUInt);
+            threadLook->second = valueUInt;
+        }
+        StateHistory()->SetUIntegerValue(key, valueUInt);
+        return;
+    }
+
+    // Thread of a CPU on which an interesting thread last ran.
+    auto cpuLook = _cpuInterest.find(key);
+    if (cpuLook != _cpuInterest.end() && cpuLook->second != 0)
+        StateHistory()->SetUIntegerValue(key, valueUInt);
+}
+
+void StateHistoryBlock::OnTTWU(const trace::EventValue& event)
+{
+    if (!ThreadInterest()->selective())
+        return;
+
+    // The thread that wakes up an interesting thread is interesting.
+    thread_t target = event.getFields()->GetField("tid")->AsInteger();
+    if (!ThreadInterest()->IsInteresting(target))
+        return;
+
+    thread_t source = ThreadForEvent(event);
+    if (source == 0 || source == kInvalidThread)
+        return;
+    ThreadInterest()->AddThread(source);
+}
+
+void StateHistoryBlock::UpdateInterestingThreads()
+{
+    const auto& threads = ThreadInterest()->threads();
+    for (; _numInterestingThreads < threads.size(); ++_numInterestingThreads)
+    {
+        thread_t thread = threads[_numInterestingThreads];
+        auto key = State()->GetAttributeKey(
+            _threadsPathKey, {State()->IntQuark(thread), _currentCpuQuark});
+
+        uint32_t cpu = kInvalidValue;
+        auto look = _lastValues.find(key);
+        if (look != _lastValues.end())
+            cpu = look->second;
+
+        _threadCpus[key] = cpu;
+        if (cpu != kInvalidValue)
+        {
+            StateHistory()->SetUIntegerValue(key, cpu);
+            AcquireCpu(cpu);
+        }
+    }
+}
+
+void StateHistoryBlock::AcquireCpu(uint32_t cpu)
+{
+    if (cpu == kInvalidValue)
+        return;
+
+    auto key = CpuThreadKey(cpu);
+    auto& count = _cpuInterest[key];
+    if (count++ != 0)
+        return;
+
+    // Start recording the thread of the CPU from its current value.
+    auto look = _lastValues.find(key);
+    if (look != _lastValues.end())
+        StateHistory()->SetUIntegerValue(key, look->second);
+}
+
+void StateHistoryBlock::ReleaseCpu(uint32_t cpu)
+{
+    if (cpu == kInvalidValue)
+        return;
+
+    auto key = CpuThreadKey(cpu);
+    auto& count = _cpuInterest[key];
+    if (count == 0 || --count != 0)
+        return;
+
+    // The thread of the CPU is unknown until it becomes interesting again.
+    StateHistory()->SetUIntegerValue(key, kInvalidValue);
+}
+
+state::AttributeKey StateHistoryBlock::CpuThreadKey(uint32_t cpu)
+{
+    auto look = _cpuThreadKeys.find(cpu);
+    if (look != _cpuThreadKeys.end())
+        return look->second;
+
+    auto key = State()->GetAttributeKey(
+        _cpusPathKey, {State()->IntQuark(cpu), _currentThreadQuark});
+    _cpuThreadKeys[cpu] = key;
+    return key;
 }
 
 }  // namespace state_blocks
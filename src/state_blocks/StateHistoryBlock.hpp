@@ -18,7 +18,11 @@
 #ifndef TIBEE_SRC_STATE_BLOCKS_STATEHISTORYBLOCK_HPP_
 #define TIBEE_SRC_STATE_BLOCKS_STATEHISTORYBLOCK_HPP_
 
+#include <unordered_map>
+
 #include "build_blocks/AbstractBuildBlock.hpp"
+#include "quark/Quark.hpp"
+#include "state/AttributeKey.hpp"
 
 namespace tibee {
 namespace state_blocks {
@@ -26,6 +30,10 @@ namespace state_blocks {
 /**
  * Blocks that keeps track of the state history.
  *
+ * When the thread interest is selective, the CPU of a thread is only
+ * recorded for interesting threads, and the thread of a CPU is only
+ * recorded while an interesting thread last ran on that CPU.
+ *
  * @author Francois Doray
  */
 class StateHistoryBlock : public build_blocks::AbstractBuildBlock
@@ -34,10 +42,47 @@ public:
     StateHistoryBlock();
     ~StateHistoryBlock();
 
+    virtual void LoadServices(const block::ServiceList& serviceList) override;
     virtual void AddObservers(notification::NotificationCenter* notificationCenter) override;
 
 private:
-    void OnState(const notification::Path& path, const value::Value* value);
+    void OnState(const state::StateChange& change);
+    void OnTTWU(const trace::EventValue& event);
+
+    // Start recording the history of the threads that became interesting.
+    void UpdateInterestingThreads();
+
+    // Add/remove an interesting thread that last ran on a CPU.
+    void AcquireCpu(uint32_t cpu);
+    void ReleaseCpu(uint32_t cpu);
+
+    // Key of the current thread attribute of a CPU.
+    state::AttributeKey CpuThreadKey(uint32_t cpu);
+
+    // Path for thread states.
+    state::AttributeKey _threadsPathKey;
+    quark::Quark _currentCpuQuark;
+
+    // Path for CPU states.
+    state::AttributeKey _cpusPathKey;
+    quark::Quark _currentThreadQuark;
+
+    // Last value of each observed attribute, used to initialize the
+    // history of an attribute when it becomes interesting.
+    std::unordered_map<state::AttributeKey, uint32_t> _lastValues;
+
+    // Number of interesting threads that were processed.
+    size_t _numInterestingThreads;
+
+    // Current CPU attribute of interesting threads -> current CPU.
+    std::unordered_map<state::AttributeKey, uint32_t> _threadCpus;
+
+    // Current thread attribute of CPUs -> number of interesting threads
+    // that last ran on the CPU.
+    std::unordered_map<state::AttributeKey, size_t> _cpuInterest;
+
+    // CPU -> current thread attribute.
+    std::unordered_map<uint32_t, state::AttributeKey> _cpuThreadKeys;
 };
 
 }  // namespace state_blocks
@@ -41,43 +41,13 @@ bool SymbolLookup::LookupSymbol(uint64_t address,
                                 const ImageVector& images,
                                 Symbol* symbol,
                                 uint64_t* offset) {
-  assert(symbol);
-  assert(offset);
-
   // Find the image for the symbol.
   for (size_t i = 0; i < images.size(); ++i) {
     const Image& image = images[i];
 
     if (address >= image.base_address() &&
         address < image.base_address() + image.size()) {
-
-      // Load a symbol cache for the image.
-      auto image_cache_it = cache_.find(image.path());
-      if (image_cache_it == cache_.end()) {
-        if (!ReadImageSymbols(image, &cache_[image.path()])) {
-            base::tberror() << "Unable to load symbols for " << image.path()
-                            << base::tbendl();
-            return false;
-        }
-        image_cache_it = cache_.find(image.path());
-      }
-
-      // Find the symbol in the cache.
-      uint64_t relative_address = address - image.base_address() + image.offset();
-      const auto& image_cache = image_cache_it->second;
-
-      auto symbol_it = image_cache.upper_bound(relative_address);
-
-      if (symbol_it == image_cache.begin()) {
-        symbol->set_name(image.path() + "+" + std::to_string(relative_address));
-        return true;
-      }
-
-      --symbol_it;
-      *symbol = symbol_it->second;
-      *offset = address - symbol->address() - image.base_address();
-
-      return true;
+      return LookupSymbol(address, image, symbol, offset);
     }
   }
 
@@ -88,5 +58,41 @@ bool SymbolLookup::LookupSymbol(uint64_t address,
   return false;
 }
 
+bool SymbolLookup::LookupSymbol(uint64_t address,
+                                const Image& image,
+                                Symbol* symbol,
+                                uint64_t* offset) {
+  assert(symbol);
+  assert(offset);
+
+  // Load a symbol cache for the image.
+  auto image_cache_it = cache_.find(image.path());
+  if (image_cache_it == cache_.end()) {
+    if (!ReadImageSymbols(image, &cache_[image.path()])) {
+        base::tberror() << "Unable to load symbols for " << image.path()
+                        << base::tbendl();
+        return false;
+    }
+    image_cache_it = cache_.find(image.path());
+  }
+
+  // Find the symbol in the cache.
+  uint64_t relative_address = address - image.base_address() + image.offset();
+  const auto& image_cache = image_cache_it->second;
+
+  auto symbol_it = image_cache.upper_bound(relative_address);
+
+  if (symbol_it == image_cache.begin()) {
+    symbol->set_name(image.path() + "+" + std::to_string(relative_address));
+    return true;
+  }
+
+  --symbol_it;
+  *symbol = symbol_it->second;
+  *offset = address - symbol->address() - image.base_address();
+
+  return true;
+}
+
 }  // namespace symbols
 }  // namespace tibee
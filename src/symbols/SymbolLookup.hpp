@@ -42,6 +42,12 @@ class SymbolLookup {
                     Symbol* symbol,
                     uint64_t* offset);
 
+  // Looks up a symbol in an image that contains |address|.
+  bool LookupSymbol(uint64_t address,
+                    const Image& image,
+                    Symbol* symbol,
+                    uint64_t* offset);
+
  private:
   // Symbol cache.
   SymbolCache cache_;